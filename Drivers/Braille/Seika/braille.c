@@ -530,39 +530,26 @@ static void
 ntkInitializeData (void) {
 }
 
-static BraillePacketVerifierResult
-ntkVerifyPacket (
-  BrailleDisplay *brl,
-  const unsigned char *bytes, size_t size,
-  size_t *length, void *data
-) {
-  unsigned char byte = bytes[size-1];
+static const unsigned char ntkPacketHeader[] = {0XFF, 0XFF};
 
-  switch (size) {
-    case 1:
-      *length = 4;
-    case 2:
-      if (byte != 0XFF) return BRL_PVR_INVALID;
-      break;
+static const BraillePacketFraming ntkPacketFraming = {
+  .header = ntkPacketHeader,
+  .headerSize = sizeof(ntkPacketHeader),
 
-    case 4:
-      *length += byte;
-      break;
-
-    default:
-      break;
+  .method = BRL_PFM_LENGTH,
+  .rule.length = {
+    .offset = 3,
+    .adjustment = 4
   }
-
-  return BRL_PVR_INCLUDE;
-}
+};
 
 static int
 ntkReadPacket (BrailleDisplay *brl, InputPacket *packet) {
   size_t length;
 
-  while ((length = readBraillePacket(brl, NULL,
-                                     packet->bytes, sizeof(packet->bytes),
-                                     ntkVerifyPacket, NULL))) {
+  while ((length = readFramedBraillePacket(brl, NULL,
+                                           packet->bytes, sizeof(packet->bytes),
+                                           &ntkPacketFraming, NULL))) {
     unsigned char type = packet->bytes[2];
 
     switch (type) {
@@ -93,8 +93,14 @@ static char *curSender;
 static char *curPath;
 
 static long curNumRows, curNumCols;
+static long curRowsAllocated;
 static wchar_t **curRows;
 static long *curRowLengths;
+
+/* character offset of the start of each row, valid for the first
+ * curRowOffsetsValid rows only */
+static long *curRowOffsets;
+static long curRowOffsetsValid;
 static long curCaret,curPosX,curPosY;
 
 static DBusConnection *bus = NULL;
@@ -226,12 +232,43 @@ static size_t my_mbslen(const char *s, size_t n) {
   return ret;
 }
 
+static void invalidateRowOffsets(long row) {
+  if (row < curRowOffsetsValid) curRowOffsetsValid = row;
+}
+
+static void allocateRows(long count) {
+  if (count > curRowsAllocated) {
+    long size = curRowsAllocated? curRowsAllocated: 0X10;
+    while (size < count) size <<= 1;
+
+    curRows = realloc(curRows,size*sizeof(*curRows));
+    curRowLengths = realloc(curRowLengths,size*sizeof(*curRowLengths));
+    curRowOffsets = realloc(curRowOffsets,size*sizeof(*curRowOffsets));
+    curRowsAllocated = size;
+  }
+}
+
+static void freeRows(void) {
+  long y;
+  for (y=0;y<curNumRows;y++)
+    free(curRows[y]);
+  free(curRows);
+  curRows = NULL;
+  free(curRowLengths);
+  curRowLengths = NULL;
+  free(curRowOffsets);
+  curRowOffsets = NULL;
+  curRowsAllocated = 0;
+  curRowOffsetsValid = 0;
+  curNumRows = 0;
+}
+
 static void addRows(long pos, long num) {
+  allocateRows(curNumRows+num);
   curNumRows += num;
-  curRows = realloc(curRows,curNumRows*sizeof(*curRows));
-  curRowLengths = realloc(curRowLengths,curNumRows*sizeof(*curRowLengths));
   memmove(curRows      +pos+num,curRows      +pos,(curNumRows-(pos+num))*sizeof(*curRows));
   memmove(curRowLengths+pos+num,curRowLengths+pos,(curNumRows-(pos+num))*sizeof(*curRowLengths));
+  invalidateRowOffsets(pos);
 }
 
 static void delRows(long pos, long num) {
@@ -241,8 +278,21 @@ static void delRows(long pos, long num) {
   memmove(curRows      +pos,curRows      +pos+num,(curNumRows-(pos+num))*sizeof(*curRows));
   memmove(curRowLengths+pos,curRowLengths+pos+num,(curNumRows-(pos+num))*sizeof(*curRowLengths));
   curNumRows -= num;
-  curRows = realloc(curRows,curNumRows*sizeof(*curRows));
-  curRowLengths = realloc(curRowLengths,curNumRows*sizeof(*curRowLengths));
+  invalidateRowOffsets(pos);
+}
+
+/* Extend the valid part of the row offset index until it covers the given
+ * character position (or all of the rows). Edits usually happen near the
+ * end of a terminal, so this only walks the few rows which have changed. */
+static void validateRowOffsets(long position) {
+  while (curRowOffsetsValid < curNumRows) {
+    long y = curRowOffsetsValid;
+    long offset = y? curRowOffsets[y-1] + curRowLengths[y-1]: 0;
+
+    if (offset > position) break;
+    curRowOffsets[y] = offset;
+    curRowOffsetsValid += 1;
+  }
 }
 
 static int
@@ -360,13 +410,29 @@ send_with_reply_and_block(DBusConnection *bus, DBusMessage *msg, int timeout_ms,
 }
 
 static void findPosition(long position, long *px, long *py) {
-  long offset=0, newoffset, x, y;
+  long x, y;
   /* XXX: I don't know what they do with necessary combining accents */
-  for (y=0; y<curNumRows; y++) {
-    if ((newoffset = offset + curRowLengths[y]) > position)
-      break;
-    offset = newoffset;
+  validateRowOffsets(position);
+
+  {
+    long first = 0;
+    long last = curRowOffsetsValid - 1;
+
+    y = curNumRows;
+    while (first <= last) {
+      long current = (first + last) / 2;
+
+      if (position < curRowOffsets[current]) {
+        last = current - 1;
+      } else if (position >= curRowOffsets[current] + curRowLengths[current]) {
+        first = current + 1;
+      } else {
+        y = current;
+        break;
+      }
+    }
   }
+
   if (y==curNumRows) {
     if (!curNumRows) {
       y = 0;
@@ -379,7 +445,7 @@ static void findPosition(long position, long *px, long *py) {
       x = curRowLengths[y];
     }
   } else
-    x = position-offset;
+    x = position-curRowOffsets[y];
   *px = x;
   *py = y;
 }
@@ -397,9 +463,8 @@ static void finiTerm(void) {
   free(curPath);
   curPath = NULL;
   curPosX = curPosY = 0;
-  free(curRows);
-  curRows = NULL;
-  curNumCols = curNumRows = 0;
+  freeRows();
+  curNumCols = 0;
 }
 
 /* Get the role of an AT-SPI2 object */
@@ -517,13 +582,7 @@ static void restartTerm(const char *sender, const char *path) {
   logMessage(LOG_CATEGORY(SCREEN_DRIVER),
              "new term %s:%s with text %s",curSender,curPath, text);
 
-  if (curRows) {
-    for (i=0;i<curNumRows;i++)
-      free(curRows[i]);
-    free(curRows);
-  }
-  curNumRows = 0;
-  free(curRowLengths);
+  freeRows();
   c = text;
   while (*c) {
     curNumRows++;
@@ -533,8 +592,7 @@ static void restartTerm(const char *sender, const char *path) {
   }
   logMessage(LOG_CATEGORY(SCREEN_DRIVER),
              "%ld rows",curNumRows);
-  curRows = malloc(curNumRows * sizeof(*curRows));
-  curRowLengths = malloc(curNumRows * sizeof(*curRowLengths));
+  allocateRows(curNumRows);
   i = 0;
   curNumCols = 0;
   for (c = text; *c; c = d+1) {
@@ -841,6 +899,7 @@ static void AtSpi2HandleEvent(const char *interface, DBusMessage *message)
     logMessage(LOG_CATEGORY(SCREEN_DRIVER),
                "delete %d from %d",detail2,detail1);
     findPosition(detail1,&x,&y);
+    invalidateRowOffsets(y+1);
     if (dbus_message_iter_get_arg_type(&iter_variant) != DBUS_TYPE_STRING) {
       logMessage(LOG_CATEGORY(SCREEN_DRIVER),
                  "ergl, not string but '%c'", dbus_message_iter_get_arg_type(&iter_variant));
@@ -895,6 +954,7 @@ static void AtSpi2HandleEvent(const char *interface, DBusMessage *message)
     logMessage(LOG_CATEGORY(SCREEN_DRIVER),
                "insert %d from %d",detail2,detail1);
     findPosition(detail1,&x,&y);
+    invalidateRowOffsets(y+1);
     if (dbus_message_iter_get_arg_type(&iter_variant) != DBUS_TYPE_STRING) {
       logMessage(LOG_CATEGORY(SCREEN_DRIVER),
                  "ergl, not string but '%c'", dbus_message_iter_get_arg_type(&iter_variant));
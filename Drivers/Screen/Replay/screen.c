@@ -0,0 +1,278 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2017 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+/* This driver shows whatever is in a screen export segment (see scr_export.h).
+ * It's what replaytest drives when it plays back a screen recording, but it
+ * can also follow the segment exported by another brltty.
+ */
+
+#include "prologue.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_SHM_OPEN
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif /* HAVE_SHM_OPEN */
+
+#include "log.h"
+#include "scr_export.h"
+
+typedef enum {
+  PARM_SEGMENT
+} ScreenParameters;
+#define SCRPARMS "segment"
+
+#include "scr_driver.h"
+
+#define DEFAULT_SEGMENT_NAME "brltty-replay"
+#define SNAPSHOT_ATTEMPTS 10
+
+static char *segmentName = NULL;
+static int segmentFileDescriptor = -1;
+static const ScreenExportHeader *segmentHeader = NULL;
+static size_t segmentSize = 0;
+
+static ScreenExportHeader snapshotHeader;
+static ScreenCharacter *snapshotCharacters = NULL;
+static size_t snapshotSize = 0;
+static const char *problemText;
+
+#ifdef __GNUC__
+#define SNAPSHOT_BARRIER() __sync_synchronize()
+#else /* __GNUC__ */
+#define SNAPSHOT_BARRIER()
+#endif /* __GNUC__ */
+
+static int
+processParameters_ReplayScreen (char **parameters) {
+  const char *name = parameters[PARM_SEGMENT];
+
+  if (!name || !*name) name = DEFAULT_SEGMENT_NAME;
+
+  {
+    size_t size = strlen(name) + 2;
+    char path[size];
+
+    snprintf(path, size, "%s%s", ((*name == '/')? "": "/"), name);
+
+    if (!(segmentName = strdup(path))) {
+      logMallocError();
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+static void
+releaseParameters_ReplayScreen (void) {
+  if (segmentName) {
+    free(segmentName);
+    segmentName = NULL;
+  }
+}
+
+#ifdef HAVE_SHM_OPEN
+static void
+unmapSegment (void) {
+  if (segmentHeader) {
+    munmap((void *)segmentHeader, segmentSize);
+    segmentHeader = NULL;
+    segmentSize = 0;
+  }
+}
+
+static int
+mapSegment (size_t size) {
+  void *address = mmap(NULL, size, PROT_READ, MAP_SHARED, segmentFileDescriptor, 0);
+
+  if (address == MAP_FAILED) {
+    logSystemError("mmap");
+    return 0;
+  }
+
+  unmapSegment();
+  segmentHeader = address;
+  segmentSize = size;
+  return 1;
+}
+
+static void
+closeSegment (void) {
+  unmapSegment();
+
+  if (segmentFileDescriptor != -1) {
+    close(segmentFileDescriptor);
+    segmentFileDescriptor = -1;
+  }
+}
+
+static int
+openSegment (void) {
+  if (segmentFileDescriptor != -1) return 1;
+
+  if ((segmentFileDescriptor = shm_open(segmentName, O_RDONLY, 0)) == -1) {
+    if (errno != ENOENT) logSystemError("shm_open");
+    return 0;
+  }
+
+  if (mapSegment(sizeof(*segmentHeader))) {
+    const ScreenExportHeader *header = segmentHeader;
+
+    if ((header->magic == SCREEN_EXPORT_MAGIC) &&
+        (header->version == SCREEN_EXPORT_VERSION) &&
+        (header->characterSize == sizeof(ScreenCharacter))) {
+      logMessage(LOG_INFO, "replay segment: %s", segmentName);
+      return 1;
+    }
+
+    logMessage(LOG_WARNING, "not a screen export segment: %s", segmentName);
+  }
+
+  closeSegment();
+  return 0;
+}
+
+static int
+takeSnapshot (void) {
+  for (int attempt=0; attempt<SNAPSHOT_ATTEMPTS; attempt+=1) {
+    uint32_t generation = segmentHeader->generation;
+    if (generation & 1) continue;
+    SNAPSHOT_BARRIER();
+
+    if (segmentHeader->segmentSize > segmentSize) {
+      if (!mapSegment(segmentHeader->segmentSize)) return 0;
+      continue;
+    }
+
+    snapshotHeader = *segmentHeader;
+
+    {
+      size_t count = snapshotHeader.columns * snapshotHeader.rows;
+
+      if (count > snapshotSize) {
+        ScreenCharacter *characters = realloc(snapshotCharacters, ARRAY_SIZE(characters, count));
+
+        if (!characters) {
+          logMallocError();
+          return 0;
+        }
+
+        snapshotCharacters = characters;
+        snapshotSize = count;
+      }
+
+      if (snapshotHeader.charactersOffset + (count * sizeof(ScreenCharacter)) > segmentSize) continue;
+
+      memcpy(snapshotCharacters,
+             (const unsigned char *)segmentHeader + snapshotHeader.charactersOffset,
+             ARRAY_SIZE(snapshotCharacters, count));
+    }
+
+    SNAPSHOT_BARRIER();
+    if (segmentHeader->generation == generation) return 1;
+  }
+
+  return 0;
+}
+#endif /* HAVE_SHM_OPEN */
+
+static int
+construct_ReplayScreen (void) {
+  memset(&snapshotHeader, 0, sizeof(snapshotHeader));
+  problemText = NULL;
+  return 1;
+}
+
+static void
+destruct_ReplayScreen (void) {
+#ifdef HAVE_SHM_OPEN
+  closeSegment();
+#endif /* HAVE_SHM_OPEN */
+
+  if (snapshotCharacters) {
+    free(snapshotCharacters);
+    snapshotCharacters = NULL;
+    snapshotSize = 0;
+  }
+}
+
+static void
+describe_ReplayScreen (ScreenDescription *description) {
+#ifdef HAVE_SHM_OPEN
+  if (!openSegment()) {
+    problemText = "replay segment not available";
+  } else if (!takeSnapshot()) {
+    /* Keep showing the previous snapshot. */
+  } else if (snapshotHeader.unreadable || !snapshotHeader.columns || !snapshotHeader.rows) {
+    problemText = "replayed screen not readable";
+  } else {
+    problemText = NULL;
+  }
+#else /* HAVE_SHM_OPEN */
+  problemText = "screen export segments not supported";
+#endif /* HAVE_SHM_OPEN */
+
+  if ((description->unreadable = problemText)) {
+    description->cols = strlen(problemText);
+    description->rows = 1;
+    description->posx = 0;
+    description->posy = 0;
+  } else {
+    description->number = snapshotHeader.number;
+    description->cols = snapshotHeader.columns;
+    description->rows = snapshotHeader.rows;
+    description->posx = snapshotHeader.cursorColumn;
+    description->posy = snapshotHeader.cursorRow;
+    description->cursor = snapshotHeader.cursorVisible;
+  }
+}
+
+static int
+readCharacters_ReplayScreen (const ScreenBox *box, ScreenCharacter *buffer) {
+  if (problemText) {
+    if (!validateScreenBox(box, strlen(problemText), 1)) return 0;
+    setScreenMessage(box, buffer, problemText);
+    return 1;
+  }
+
+  if (!validateScreenBox(box, snapshotHeader.columns, snapshotHeader.rows)) return 0;
+
+  for (unsigned int row=0; row<box->height; row+=1) {
+    memcpy(&buffer[row * box->width],
+           &snapshotCharacters[((box->top + row) * snapshotHeader.columns) + box->left],
+           ARRAY_SIZE(buffer, box->width));
+  }
+
+  return 1;
+}
+
+static void
+scr_initialize (MainScreen *main) {
+  initializeRealScreen(main);
+  main->base.describe = describe_ReplayScreen;
+  main->base.readCharacters = readCharacters_ReplayScreen;
+  main->processParameters = processParameters_ReplayScreen;
+  main->releaseParameters = releaseParameters_ReplayScreen;
+  main->construct = construct_ReplayScreen;
+  main->destruct = destruct_ReplayScreen;
+}
@@ -115,6 +115,42 @@ extern size_t readBraillePacket (
   BraillePacketVerifier *verifyPacket, void *data
 );
 
+typedef enum {
+  BRL_PFM_FIXED,
+  BRL_PFM_LENGTH,
+  BRL_PFM_TERMINATOR
+} BraillePacketFramingMethod;
+
+typedef struct {
+  const unsigned char *header;
+  unsigned char headerSize;
+
+  BraillePacketFramingMethod method;
+  union {
+    struct {
+      size_t size;
+    } fixed;
+
+    struct {
+      unsigned char offset;
+      unsigned char adjustment;
+    } length;
+
+    struct {
+      unsigned char byte;
+    } terminator;
+  } rule;
+
+  BraillePacketVerifier *verifyPacket;
+} BraillePacketFraming;
+
+extern size_t readFramedBraillePacket (
+  BrailleDisplay *brl,
+  GioEndpoint *endpoint,
+  void *packet, size_t size,
+  const BraillePacketFraming *framing, void *data
+);
+
 extern int writeBraillePacket (
   BrailleDisplay *brl, GioEndpoint *endpoint,
   const void *packet, size_t size
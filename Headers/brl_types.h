@@ -25,6 +25,7 @@
 #include "gio_types.h"
 #include "queue.h"
 #include "async.h"
+#include "timing.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -106,6 +107,7 @@ struct BrailleDisplayStruct {
   struct {
     Queue *messages;
     AsyncHandle alarm;
+    TimeValue written;
 
     struct {
       int timeout;
@@ -26,9 +26,15 @@ extern "C" {
 #endif /* __cplusplus */
 
 typedef struct ContractionTableStruct ContractionTable;
+typedef struct ContractionCacheStruct ContractionCache;
 
 extern ContractionTable *compileContractionTable (const char *fileName);
 extern void destroyContractionTable (ContractionTable *table);
+
+extern ContractionCache *newContractionCache (void);
+extern void destroyContractionCache (ContractionCache *cache);
+extern void setContractionOptions (ContractionCache *cache, unsigned char expandCurrentWord, unsigned char capitalizationMode);
+
 extern void contractText (
   ContractionTable *contractionTable, /* Pointer to translation table */
   const wchar_t *inputBuffer, /* What is to be translated */
@@ -39,6 +45,18 @@ extern void contractText (
   int cursorOffset /* Position of coursor in source */
 );
 
+/* Reentrant: the table is only read, and all mutable state lives in the cache,
+ * so any number of threads may contract concurrently with their own caches.
+ * A cache remembers its table, and is emptied if used with a different one.
+ */
+extern void contractTextWithCache (
+  ContractionTable *contractionTable,
+  ContractionCache *contractionCache,
+  const wchar_t *inputBuffer, int *inputLength,
+  unsigned char *outputBuffer, int *outputLength,
+  int *offsetsMap, int cursorOffset
+);
+
 extern char *ensureContractionTableExtension (const char *path);
 extern char *makeContractionTablePath (const char *directory, const char *name);
 
@@ -49,6 +49,8 @@ typedef struct {
 
 extern int processDataFile (const char *name, const DataFileParameters *parameters);
 extern void reportDataError (DataFile *file, char *format, ...) PRINTF(2, 3);
+extern const char *getDataFileName (DataFile *file);
+extern int getDataFileLine (DataFile *file);
 
 extern int processDataStream (
   DataFile *includer,
@@ -0,0 +1,47 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2017 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+#ifndef BRLTTY_INCLUDED_DIFF
+#define BRLTTY_INCLUDED_DIFF
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+typedef struct {
+  unsigned int oldOffset;
+  unsigned int oldCount;
+
+  unsigned int newOffset;
+  unsigned int newCount;
+} DifferenceSpan;
+
+typedef int DifferenceItemTester (unsigned int oldIndex, unsigned int newIndex, void *data);
+typedef int DifferenceSpanHandler (const DifferenceSpan *span, void *data);
+
+extern int findDifferences (
+  unsigned int oldCount, unsigned int newCount,
+  DifferenceItemTester *isSameItem, unsigned int maximumEdits,
+  DifferenceSpanHandler *handleSpan, void *data
+);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* BRLTTY_INCLUDED_DIFF */
@@ -65,6 +65,13 @@ typedef void GioUsbSetConnectionPropertiesMethod (
 
 typedef struct {
   struct {
+    const SerialParameters *parameters; /* the nominal rate, if any */
+    unsigned int bytesPerSecond; /* how fast data really drains (0 for at once) */
+
+    const unsigned char *input; /* what's read back (nothing if NULL) */
+    size_t inputSize;
+    size_t inputChunk; /* the most a single read returns (0 for no limit) */
+
     GioOptions options;
   } null;
 
@@ -43,6 +43,8 @@ extern ssize_t gioWriteData (GioEndpoint *endpoint, const void *data, size_t siz
 extern int gioAwaitInput (GioEndpoint *endpoint, int timeout);
 extern ssize_t gioReadData (GioEndpoint *endpoint, void *buffer, size_t size, int wait);
 extern int gioReadByte (GioEndpoint *endpoint, unsigned char *byte, int wait);
+extern ssize_t gioPeekInput (GioEndpoint *endpoint, const unsigned char **bytes, int wait);
+extern void gioConsumeInput (GioEndpoint *endpoint, size_t count);
 extern int gioDiscardInput (GioEndpoint *endpoint);
 
 extern int gioReconfigureResource (
@@ -52,6 +54,34 @@ extern int gioReconfigureResource (
 
 extern unsigned int gioGetBytesPerSecond (GioEndpoint *endpoint);
 extern unsigned int gioGetMillisecondsToTransfer (GioEndpoint *endpoint, size_t bytes);
+extern unsigned int gioGetWritePacingDelay (GioEndpoint *endpoint);
+
+#define GIO_LATENCY_BUCKETS 8
+
+typedef struct {
+  unsigned long int bytesRead;
+  unsigned long int bytesWritten;
+  unsigned long int packetsRead;
+  unsigned long int packetsWritten;
+
+  unsigned long int readTimeouts;
+  unsigned long int retries;
+  unsigned long int acknowledgements;
+  unsigned long int missingAcknowledgements;
+
+  /* bucket n counts durations below 2^n milliseconds, the last one the rest */
+  unsigned long int readLatency[GIO_LATENCY_BUCKETS];
+  unsigned long int writeLatency[GIO_LATENCY_BUCKETS];
+  unsigned long int acknowledgementLatency[GIO_LATENCY_BUCKETS];
+} GioStatistics;
+
+extern void gioLogStatistics (GioEndpoint *endpoint);
+
+extern void gioCountInputPacket (GioEndpoint *endpoint);
+extern void gioCountOutputPacket (GioEndpoint *endpoint);
+extern void gioCountRetry (GioEndpoint *endpoint);
+extern void gioCountAcknowledgement (GioEndpoint *endpoint, long int milliseconds);
+extern void gioCountMissingAcknowledgement (GioEndpoint *endpoint);
 
 extern ssize_t gioTellResource (
   GioEndpoint *endpoint,
@@ -33,6 +33,25 @@ typedef float NoteFrequency;
 #define PRIfreq "f"
 #endif /* NO_FLOAT */
 
+typedef struct {
+  unsigned char note;     /* standard MIDI values (0 means silence) */
+                          /* 1 through 127 are semitones, 60 is middle C */
+  unsigned char duration; /* milliseconds (0 means stop) */
+} NoteElement;
+
+#define NOTE_PLAY(duration,note) {note, duration}
+#define NOTE_REST(duration) NOTE_PLAY(duration, 0)
+#define NOTE_STOP() NOTE_REST(0)
+
+typedef struct {
+  NoteFrequency frequency; /* Herz (0 means silence) */
+  int duration;        /* milliseconds (0 means stop) */
+} ToneElement;
+
+#define TONE_PLAY(duration,frequency) {frequency, duration}
+#define TONE_REST(duration) TONE_PLAY(duration, 0)
+#define TONE_STOP() TONE_REST(0)
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
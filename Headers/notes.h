@@ -49,6 +49,7 @@ typedef struct {
 
   int (*tone) (NoteDevice *device, unsigned int duration, NoteFrequency frequency);
   int (*note) (NoteDevice *device, unsigned int duration, unsigned char note);
+  int (*tune) (NoteDevice *device, const ToneElement *tune);
 
   int (*flush) (NoteDevice *device);
 } NoteMethods;
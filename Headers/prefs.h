@@ -47,6 +47,12 @@ typedef enum {
   sayEnqueue
 } SayMode;
 
+typedef enum {
+  arLine,
+  arWindow,
+  arScreen
+} AutospeakRegion;
+
 typedef enum {
   sucNone,
   sucSayCap,
@@ -190,6 +196,7 @@ typedef struct {
   unsigned char autospeakDeletedCharacters;
   unsigned char autospeakReplacedCharacters;
   unsigned char autospeakCompletedWords;
+  unsigned char autospeakRegion;
 
   unsigned char showSpeechCursor;
   unsigned char speechCursorStyle;
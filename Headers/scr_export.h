@@ -0,0 +1,72 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2017 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+#ifndef BRLTTY_INCLUDED_SCR_EXPORT
+#define BRLTTY_INCLUDED_SCR_EXPORT
+
+#include "scr_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * The screen export segment is a POSIX shared memory object which starts
+ * with a ScreenExportHeader followed by the rows*columns ScreenCharacter grid.
+ *
+ * A reader should:
+ *   1) read the generation and retry if it's odd (an update is in progress),
+ *   2) remap the segment if segmentSize is larger than its current mapping,
+ *   3) copy (or examine) whatever it needs,
+ *   4) reread the generation and start again if it has changed.
+ *
+ * The generation only changes when something within the segment does.
+ */
+
+#define SCREEN_EXPORT_MAGIC 0X58455342 /* "BSEX" when little-endian */
+#define SCREEN_EXPORT_VERSION 1
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t headerSize;
+
+  volatile uint32_t generation;
+  uint32_t segmentSize;
+
+  int32_t number;
+  uint16_t columns;
+  uint16_t rows;
+  uint16_t cursorColumn;
+  uint16_t cursorRow;
+  uint8_t cursorVisible;
+  uint8_t unreadable;
+  uint16_t characterSize;
+  uint32_t charactersOffset;
+} ScreenExportHeader;
+
+extern int startScreenExport (const char *name);
+extern void stopScreenExport (void);
+extern void exportScreen (const ScreenDescription *description);
+extern void exportScreenCharacters (const ScreenDescription *description, const ScreenCharacter *characters);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* BRLTTY_INCLUDED_SCR_EXPORT */
@@ -0,0 +1,57 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2017 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+#ifndef BRLTTY_INCLUDED_SCR_RECORD
+#define BRLTTY_INCLUDED_SCR_RECORD
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * A screen recording is a text file which starts with SCREEN_RECORDING_HEADER
+ * and then has one line per event. Each event starts with a keyword and the
+ * number of milliseconds since the recording was started:
+ *
+ *   screen msecs number columns rows cursor-column cursor-row cursor-visible
+ *     The main screen has changed. It's followed by a row line for each row
+ *     which differs from the previous snapshot (all of them if the size has
+ *     changed):
+ *       row index attributes "text"
+ *     The attributes are two hexadecimal digits per character. The text is
+ *     UTF-8, with a backslash (\) before each backslash and double quote ("),
+ *     \Xxx for each control character, and \Uxxxxxxxx for anything else
+ *     which can't be encoded (e.g. the filler after a wide character).
+ *
+ *   command msecs code
+ *     A command (in hexadecimal) has been executed.
+ */
+
+#define SCREEN_RECORDING_HEADER "# BRLTTY screen recording 1"
+
+extern int startScreenRecording (const char *path);
+extern void stopScreenRecording (void);
+
+extern void recordScreen (void);
+extern void recordScreenCommand (int command);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* BRLTTY_INCLUDED_SCR_RECORD */
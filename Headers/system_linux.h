@@ -36,6 +36,9 @@ extern int createUinputDevice (UinputObject *uinput);
 
 extern int enableUinputEventType (UinputObject *uinput, int type);
 extern int writeInputEvent (UinputObject *uinput, uint16_t type, uint16_t code, int32_t value);
+extern void beginUinputBatch (UinputObject *uinput);
+extern int flushUinputBatch (UinputObject *uinput);
+extern int endUinputBatch (UinputObject *uinput);
 
 extern int enableUinputKey (UinputObject *uinput, int key);
 extern int writeKeyEvent (UinputObject *uinput, int key, int press);
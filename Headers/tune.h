@@ -26,25 +26,6 @@
 extern "C" {
 #endif /* __cplusplus */
 
-typedef struct {
-  unsigned char note;     /* standard MIDI values (0 means silence) */
-                          /* 1 through 127 are semitones, 60 is middle C */
-  unsigned char duration; /* milliseconds (0 means stop) */
-} NoteElement;
-
-#define NOTE_PLAY(duration,note) {note, duration}
-#define NOTE_REST(duration) NOTE_PLAY(duration, 0)
-#define NOTE_STOP() NOTE_REST(0)
-
-typedef struct {
-  NoteFrequency frequency; /* Herz (0 means silence) */
-  int duration;        /* milliseconds (0 means stop) */
-} ToneElement;
-
-#define TONE_PLAY(duration,frequency) {frequency, duration}
-#define TONE_REST(duration) TONE_PLAY(duration, 0)
-#define TONE_STOP() TONE_REST(0)
-
 extern void suppressTuneDeviceOpenErrors (void);
 
 extern int tuneSetDevice (TuneDevice device);
@@ -0,0 +1,66 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2017 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+#ifndef BRLTTY_INCLUDED_UPDATE_CELLS
+#define BRLTTY_INCLUDED_UPDATE_CELLS
+
+#include "scr_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Each of these is only called when its blinking state is actually needed. */
+typedef int CellsBlinkTester (void);
+
+typedef struct {
+  CellsBlinkTester *uppercaseLetters;
+  CellsBlinkTester *attributesUnderline;
+} CellsBlinkTesters;
+
+extern void overlayAttributesUnderline (
+  unsigned char *cell, unsigned char attributes,
+  const CellsBlinkTesters *blink
+);
+
+extern void translateScreenText (
+  unsigned char *cells, wchar_t *text,
+  const ScreenCharacter *characters, unsigned int count,
+  const CellsBlinkTesters *blink
+);
+
+extern void translateScreenAttributes (
+  unsigned char *cells, wchar_t *text,
+  const ScreenCharacter *characters, unsigned int count
+);
+
+extern void mergeContractedAttributes (
+  unsigned char *attributes, unsigned int outputLength,
+  const ScreenCharacter *characters, const int *offsets, unsigned int inputLength
+);
+
+extern void overlayContractedAttributes (
+  unsigned char *cells, const unsigned char *attributes, unsigned int count,
+  const CellsBlinkTesters *blink
+);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* BRLTTY_INCLUDED_UPDATE_CELLS */
@@ -24,6 +24,7 @@
 #include "log.h"
 #include "queue.h"
 #include "async_alarm.h"
+#include "timing.h"
 #include "brl_base.h"
 #include "brl_utils.h"
 #include "brl_dots.h"
@@ -219,53 +220,211 @@ readBraillePacket (
   if (!endpoint) endpoint = brl->gioEndpoint;
 
   while (1) {
-    unsigned char byte;
+    const unsigned char *input;
+    ssize_t available = gioPeekInput(endpoint, &input, started);
 
-    if (!gioReadByte(endpoint, &byte, started)) {
+    if (available == -1) {
       if (count > 0) logPartialPacket(bytes, count);
       return 0;
     }
 
-  gotByte:
-    started = 1;
+    {
+      const unsigned char *next = input;
+      const unsigned char *end = next + available;
 
-    if (count < size) {
-      bytes[count++] = byte;
+      while (next < end) {
+        unsigned char byte = *next++;
 
-      {
-        BraillePacketVerifierResult result = verifyPacket(brl, bytes, count, &length, data);
+      gotByte:
+        started = 1;
 
-        switch (result) {
-          case BRL_PVR_EXCLUDE:
-            count -= 1;
-          case BRL_PVR_INCLUDE:
-            break;
+        if (count < size) {
+          bytes[count++] = byte;
 
-          default:
-            logMessage(LOG_WARNING, "unimplemented braille packet verifier result: %u", result);
-            /* fall through */
-          case BRL_PVR_INVALID:
-            started = 0;
-
-            if (--count) {
-              logShortPacket(bytes, count);
-              count = 0;
-              length = 1;
-              goto gotByte;
+          {
+            BraillePacketVerifierResult result = verifyPacket(brl, bytes, count, &length, data);
+
+            switch (result) {
+              case BRL_PVR_EXCLUDE:
+                count -= 1;
+              case BRL_PVR_INCLUDE:
+                break;
+
+              default:
+                logMessage(LOG_WARNING, "unimplemented braille packet verifier result: %u", result);
+                /* fall through */
+              case BRL_PVR_INVALID:
+                started = 0;
+
+                if (--count) {
+                  logShortPacket(bytes, count);
+                  count = 0;
+                  length = 1;
+                  goto gotByte;
+                }
+
+                logIgnoredByte(byte);
+                continue;
             }
+          }
+
+          if (count >= length) {
+            gioConsumeInput(endpoint, (next - input));
+            gioCountInputPacket(endpoint);
+            logInputPacket(bytes, length);
+            return length;
+          }
+        } else {
+          if (count++ == size) logTruncatedPacket(bytes, size);
+          logDiscardedByte(byte);
+        }
+      }
+    }
+
+    gioConsumeInput(endpoint, available);
+  }
+}
+
+static size_t
+getFramedPacketLength (
+  const BraillePacketFraming *framing,
+  const unsigned char *bytes, size_t count
+) {
+  switch (framing->method) {
+    case BRL_PFM_FIXED:
+      return framing->rule.fixed.size;
+
+    case BRL_PFM_LENGTH: {
+      size_t offset = framing->rule.length.offset;
+
+      if (count <= offset) return offset + 1;
+      return bytes[offset] + framing->rule.length.adjustment;
+    }
+
+    default:
+      return 0;
+  }
+}
+
+size_t
+readFramedBraillePacket (
+  BrailleDisplay *brl,
+  GioEndpoint *endpoint,
+  void *packet, size_t size,
+  const BraillePacketFraming *framing, void *data
+) {
+  unsigned char *bytes = packet;
+  size_t count = 0;
+  int started = 0;
+  int terminated = 0;
+  int discarding = 0;
+
+  const unsigned char *input = NULL;
+  ssize_t available = 0;
+
+  if (!endpoint) endpoint = brl->gioEndpoint;
+
+  while (1) {
+    size_t length = 0;
+
+    if (count >= framing->headerSize) {
+      if (framing->method == BRL_PFM_TERMINATOR) {
+        if (terminated) length = count;
+      } else {
+        size_t wanted = getFramedPacketLength(framing, bytes, count);
+
+        if ((wanted < count) || (wanted > size)) {
+          logCorruptPacket(bytes, count);
+          count = 0;
+          started = 0;
+          continue;
+        }
 
-            logIgnoredByte(byte);
-            continue;
+        if (count == wanted) length = count;
+      }
+    }
+
+    if (length) {
+      if (framing->verifyPacket) {
+        size_t verifiedLength = length;
+
+        if (framing->verifyPacket(brl, bytes, length, &verifiedLength, data) != BRL_PVR_INCLUDE) {
+          logCorruptPacket(bytes, length);
+          count = 0;
+          started = 0;
+          terminated = 0;
+          continue;
         }
       }
 
-      if (count >= length) {
-        logInputPacket(bytes, length);
-        return length;
+      gioCountInputPacket(endpoint);
+      logInputPacket(bytes, length);
+      return length;
+    }
+
+    if (!available) {
+      if ((available = gioPeekInput(endpoint, &input, started)) == -1) {
+        if (count > 0) logPartialPacket(bytes, count);
+        return 0;
       }
-    } else {
-      if (count++ == size) logTruncatedPacket(bytes, size);
-      logDiscardedByte(byte);
+    }
+
+    {
+      size_t span;
+
+      if (discarding) {
+        const unsigned char *terminator = memchr(input, framing->rule.terminator.byte, available);
+
+        span = terminator? (terminator - input + 1): available;
+        logDiscardedBytes(input, span);
+        discarding = !terminator;
+      } else if (count < framing->headerSize) {
+        if (!count) {
+          const unsigned char *start = memchr(input, framing->header[0], available);
+
+          if (start != input) {
+            span = start? (start - input): available;
+            logDiscardedBytes(input, span);
+            goto consume;
+          }
+        } else if (*input != framing->header[count]) {
+          logShortPacket(bytes, count);
+          count = 0;
+          started = 0;
+          continue;
+        }
+
+        bytes[count++] = *input;
+        span = 1;
+      } else if (framing->method == BRL_PFM_TERMINATOR) {
+        const unsigned char *terminator = memchr(input, framing->rule.terminator.byte, available);
+
+        span = terminator? (terminator - input + 1): available;
+
+        if (span > (size - count)) {
+          logTruncatedPacket(bytes, count);
+          logDiscardedBytes(input, span);
+
+          discarding = !terminator;
+          count = 0;
+        } else {
+          memcpy(&bytes[count], input, span);
+          count += span;
+          terminated = !!terminator;
+        }
+      } else {
+        span = MIN((getFramedPacketLength(framing, bytes, count) - count), available);
+        memcpy(&bytes[count], input, span);
+        count += span;
+      }
+
+      /* only wait for more input once part of a packet has been accepted */
+      started = count > 0;
+
+    consume:
+      gioConsumeInput(endpoint, span);
+      input += span;
+      available -= span;
     }
   }
 }
@@ -278,9 +437,10 @@ writeBraillePacket (
   if (!endpoint) endpoint = brl->gioEndpoint;
   logOutputPacket(packet, size);
   if (gioWriteData(endpoint, packet, size) == -1) return 0;
+  gioCountOutputPacket(endpoint);
 
   if (endpoint == brl->gioEndpoint) {
-    brl->writeDelay += gioGetMillisecondsToTransfer(endpoint, size);
+    brl->writeDelay += gioGetWritePacingDelay(endpoint);
   }
 
   return 1;
@@ -342,6 +502,12 @@ int
 acknowledgeBrailleMessage (BrailleDisplay *brl) {
   logMessage(LOG_CATEGORY(OUTPUT_PACKETS), "acknowledged");
   brl->acknowledgements.missing.count = 0;
+
+  /* only an acknowledgement of an outstanding message is a round trip */
+  if (brl->gioEndpoint && brl->acknowledgements.alarm) {
+    gioCountAcknowledgement(brl->gioEndpoint, getMonotonicElapsed(&brl->acknowledgements.written));
+  }
+
   return writeNextBrailleMessage(brl);
 }
 
@@ -350,6 +516,7 @@ ASYNC_ALARM_CALLBACK(handleBrailleMessageTimeout) {
 
   asyncDiscardHandle(brl->acknowledgements.alarm);
   brl->acknowledgements.alarm = NULL;
+  if (brl->gioEndpoint) gioCountMissingAcknowledgement(brl->gioEndpoint);
 
   if ((brl->acknowledgements.missing.count += 1) < brl->acknowledgements.missing.limit) {
     logMessage(LOG_WARNING, "missing braille message acknowledgement");
@@ -362,6 +529,8 @@ ASYNC_ALARM_CALLBACK(handleBrailleMessageTimeout) {
 
 static void
 setBrailleMessageAlarm (BrailleDisplay *brl) {
+  getMonotonicTime(&brl->acknowledgements.written);
+
   if (brl->acknowledgements.alarm) {
     asyncResetAlarmIn(brl->acknowledgements.alarm, brl->acknowledgements.missing.timeout);
   } else {
@@ -481,6 +650,7 @@ probeBrailleDisplay (
 
     if (retryCount == retryLimit) break;
     retryCount += 1;
+    gioCountRetry(endpoint);
   }
 
   return 0;
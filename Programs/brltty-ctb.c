@@ -32,6 +32,8 @@
 #include "charset.h"
 #include "unicode.h"
 #include "ascii.h"
+#include "timing.h"
+#include "thread.h"
 #include "ttb.h"
 #include "ctb.h"
 
@@ -42,6 +44,8 @@ static char *opt_verificationTable;
 static int opt_reformatText;
 static char *opt_outputWidth;
 static int opt_forceOutput;
+static int opt_batchMode;
+static char *opt_threadCount;
 
 BEGIN_OPTION_TABLE(programOptions)
   { .letter = 'T',
@@ -95,6 +99,20 @@ BEGIN_OPTION_TABLE(programOptions)
     .setting.flag = &opt_forceOutput,
     .description = strtext("Force immediate output.")
   },
+
+  { .letter = 'b',
+    .word = "batch",
+    .setting.flag = &opt_batchMode,
+    .description = strtext("Translate a stream of documents, each ending with a file separator line.")
+  },
+
+  { .letter = 'j',
+    .word = "threads",
+    .argument = "count",
+    .setting.string = &opt_threadCount,
+    .internal.setting = "",
+    .description = strtext("Number of threads to translate or verify with (default is one per processor).")
+  },
 END_OPTION_TABLE
 
 static wchar_t *inputBuffer;
@@ -113,8 +131,18 @@ static ContractionTable *contractionTable;
 static char *verificationTablePath;
 static FILE *verificationTableStream;
 
+static unsigned int threadCount;
+
 static int (*processInputCharacters) (const wchar_t *characters, size_t length, void *data);
-static int (*putCell) (unsigned char cell, void *data);
+static int (*putTranslation) (const wchar_t *characters, size_t length, wchar_t end, void *data);
+static size_t (*convertCell) (unsigned char cell, Utf8Buffer bytes);
+
+static struct {
+  TimeValue started;
+  unsigned long documents;
+  unsigned long characters;
+  unsigned long cells;
+} translationStatistics;
 
 typedef struct {
   ProgramExitStatus exitStatus;
@@ -153,18 +181,23 @@ putCharacter (unsigned char character, void *data) {
   return checkOutputStream(data);
 }
 
-static int
-putMappedCharacter (unsigned char cell, void *data) {
-  fputc(convertDotsToCharacter(textTable, cell), outputStream);
-  return checkOutputStream(data);
+static size_t
+convertCellToMappedCharacter (unsigned char cell, Utf8Buffer bytes) {
+  bytes[0] = convertDotsToCharacter(textTable, cell);
+  return 1;
+}
+
+static size_t
+convertCellToUnicodeBraille (unsigned char cell, Utf8Buffer bytes) {
+  return convertWcharToUtf8(cell|UNICODE_BRAILLE_ROW, bytes);
 }
 
 static int
-putUnicodeBraille (unsigned char cell, void *data) {
-  Utf8Buffer utf8;
-  size_t utfs = convertWcharToUtf8(cell|UNICODE_BRAILLE_ROW, utf8);
+putCell (unsigned char cell, void *data) {
+  Utf8Buffer bytes;
+  size_t count = convertCell(cell, bytes);
 
-  fprintf(outputStream, "%.*s", (int)utfs, utf8);
+  fwrite(bytes, 1, count, outputStream);
   return checkOutputStream(data);
 }
 
@@ -193,6 +226,9 @@ writeCharacters (const wchar_t *inputLine, size_t inputLength, void *data) {
       outputBuffer = NULL;
       outputWidth <<= 1;
     } else {
+      translationStatistics.characters += inputCount;
+      translationStatistics.cells += outputCount;
+
       {
         int index;
 
@@ -213,15 +249,22 @@ writeCharacters (const wchar_t *inputLine, size_t inputLength, void *data) {
   return 1;
 }
 
+static int
+writeTranslation (const wchar_t *characters, size_t length, wchar_t end, void *data) {
+  if (!writeCharacters(characters, length, data)) return 0;
+
+  if (end)
+    if (!putCharacter(end, data))
+      return 0;
+
+  return 1;
+}
+
 static int
 flushCharacters (wchar_t end, void *data) {
   if (inputLength) {
-    if (!writeCharacters(inputBuffer, inputLength, data)) return 0;
+    if (!putTranslation(inputBuffer, inputLength, end, data)) return 0;
     inputLength = 0;
-
-    if (end)
-      if (!putCharacter(end, data))
-        return 0;
   }
 
   return 1;
@@ -265,12 +308,11 @@ processCharacters (const wchar_t *characters, size_t count, wchar_t end, void *d
 
     if (end != '\n') {
       if (!flushCharacters(0, data)) return 0;
-      if (!putCharacter(end, data)) return 0;
+      if (!putTranslation(characters, 0, end, data)) return 0;
     }
   } else {
     if (!flushCharacters('\n', data)) return 0;
-    if (!writeCharacters(characters, count, data)) return 0;
-    if (!putCharacter(end, data)) return 0;
+    if (!putTranslation(characters, count, end, data)) return 0;
   }
 
   return 1;
@@ -301,6 +343,345 @@ writeContractedBraille (const wchar_t *characters, size_t length, void *data) {
   return 1;
 }
 
+typedef void WorkItemHandler (ContractionCache *cache, unsigned int index);
+#define WORK_SHARD_LIMIT 0X40
+
+static struct {
+  WorkItemHandler *handleItem;
+  unsigned int count;
+  unsigned int next;
+  unsigned int shardSize;
+
+#ifdef GOT_PTHREADS
+  pthread_mutex_t mutex;
+#endif /* GOT_PTHREADS */
+} workItems;
+
+static int
+getWorkShard (unsigned int *first, unsigned int *end) {
+  int found = 0;
+
+#ifdef GOT_PTHREADS
+  lockMutex(&workItems.mutex);
+#endif /* GOT_PTHREADS */
+
+  if (workItems.next < workItems.count) {
+    *first = workItems.next;
+    *end = MIN(*first + workItems.shardSize, workItems.count);
+    workItems.next = *end;
+    found = 1;
+  }
+
+#ifdef GOT_PTHREADS
+  unlockMutex(&workItems.mutex);
+#endif /* GOT_PTHREADS */
+
+  return found;
+}
+
+static void
+processWorkItems (void) {
+  ContractionCache *cache;
+
+  /* Each thread has its own cache so that they can share the table. */
+  if ((cache = newContractionCache())) {
+    unsigned int first;
+    unsigned int end;
+
+    setContractionOptions(cache, prefs.expandCurrentWord, prefs.capitalizationMode);
+
+    while (getWorkShard(&first, &end)) {
+      while (first < end) workItems.handleItem(cache, first++);
+    }
+
+    destroyContractionCache(cache);
+  }
+}
+
+#ifdef GOT_PTHREADS
+THREAD_FUNCTION(runWorkThread) {
+  processWorkItems();
+  return NULL;
+}
+#endif /* GOT_PTHREADS */
+
+static unsigned int
+getThreadCount (void) {
+  int count = 1;
+
+  if (*opt_threadCount) {
+    static const int minimum = 1;
+
+    if (!validateInteger(&count, opt_threadCount, &minimum, NULL)) {
+      logMessage(LOG_WARNING, "%s: %s", "invalid thread count", opt_threadCount);
+      count = 1;
+    }
+  } else {
+#ifdef _SC_NPROCESSORS_ONLN
+    long int processors = sysconf(_SC_NPROCESSORS_ONLN);
+    if (processors > 0) count = processors;
+#endif /* _SC_NPROCESSORS_ONLN */
+  }
+
+  return count;
+}
+
+static void
+runWorkThreads (unsigned int count, WorkItemHandler *handleItem) {
+  unsigned int threads = MIN(threadCount, count);
+
+  if (!count) return;
+  workItems.handleItem = handleItem;
+  workItems.count = count;
+  workItems.next = 0;
+
+  /* Small shards balance the load; large ones reduce the locking. */
+  workItems.shardSize = MAX(1, MIN(WORK_SHARD_LIMIT, count / (threads * 8)));
+
+#ifdef GOT_PTHREADS
+  if (threads > 1) {
+    pthread_t workers[threads - 1];
+    unsigned int started = 0;
+
+    pthread_mutex_init(&workItems.mutex, NULL);
+
+    while (started < ARRAY_COUNT(workers)) {
+      char name[0X20];
+      snprintf(name, sizeof(name), "ctb-worker-%u", started+1);
+
+      if (createThread(name, &workers[started], NULL, runWorkThread, NULL) != 0) {
+        logMessage(LOG_WARNING, "worker thread not created: %s", strerror(errno));
+        break;
+      }
+
+      started += 1;
+    }
+
+    processWorkItems();
+    while (started) pthread_join(workers[--started], NULL);
+
+    pthread_mutex_destroy(&workItems.mutex);
+    return;
+  }
+#endif /* GOT_PTHREADS */
+
+  processWorkItems();
+}
+
+typedef struct {
+  char *bytes;
+  size_t size;
+  size_t length;
+} BatchOutput;
+
+typedef struct {
+  wchar_t *characters;
+  size_t length;
+  wchar_t end;
+
+  BatchOutput output;
+  unsigned long cells;
+  unsigned translated:1;
+} BatchUnit;
+
+static struct {
+  BatchUnit *array;
+  unsigned int size;
+  unsigned int count;
+} batchUnits;
+
+static int
+queueBatchUnit (const wchar_t *characters, size_t length, wchar_t end, void *data) {
+  if (batchUnits.count == batchUnits.size) {
+    unsigned int newSize = batchUnits.size? batchUnits.size<<1: 0X40;
+    BatchUnit *newArray = realloc(batchUnits.array, ARRAY_SIZE(newArray, newSize));
+
+    if (!newArray) {
+      noMemory(data);
+      return 0;
+    }
+
+    batchUnits.array = newArray;
+    batchUnits.size = newSize;
+  }
+
+  {
+    BatchUnit *unit = &batchUnits.array[batchUnits.count];
+
+    memset(unit, 0, sizeof(*unit));
+    unit->length = length;
+    unit->end = end;
+
+    if (length) {
+      if (!(unit->characters = malloc(ARRAY_SIZE(unit->characters, length)))) {
+        noMemory(data);
+        return 0;
+      }
+
+      wmemcpy(unit->characters, characters, length);
+    }
+  }
+
+  batchUnits.count += 1;
+  return 1;
+}
+
+static int
+appendBatchOutput (BatchOutput *output, const char *bytes, size_t count) {
+  size_t newLength = output->length + count;
+
+  if (newLength > output->size) {
+    size_t newSize = newLength | 0XFF;
+    char *newBytes = realloc(output->bytes, newSize);
+
+    if (!newBytes) return 0;
+    output->bytes = newBytes;
+    output->size = newSize;
+  }
+
+  memcpy(&output->bytes[output->length], bytes, count);
+  output->length = newLength;
+  return 1;
+}
+
+static int
+translateBatchUnit (ContractionCache *cache, BatchUnit *unit) {
+  const wchar_t *input = unit->characters;
+  size_t inputLength = unit->length;
+  int width = outputWidth;
+  unsigned char *cells = NULL;
+
+  while (inputLength) {
+    int inputCount = inputLength;
+    int outputCount = width;
+
+    if (!cells) {
+      if (!(cells = malloc(width))) return 0;
+    }
+
+    contractTextWithCache(contractionTable, cache,
+                          input, &inputCount,
+                          cells, &outputCount,
+                          NULL, CTB_NO_CURSOR);
+
+    if ((inputCount < inputLength) && outputExtend) {
+      free(cells);
+      cells = NULL;
+      width <<= 1;
+    } else {
+      for (int index=0; index<outputCount; index+=1) {
+        Utf8Buffer bytes;
+        size_t count = convertCell(cells[index], bytes);
+
+        if (!appendBatchOutput(&unit->output, bytes, count)) goto noMemory;
+      }
+
+      unit->cells += outputCount;
+      input += inputCount;
+      inputLength -= inputCount;
+
+      if (inputLength)
+        if (!appendBatchOutput(&unit->output, "\n", 1))
+          goto noMemory;
+    }
+  }
+
+  if (cells) free(cells);
+
+  if (unit->end) {
+    char end = unit->end;
+    if (!appendBatchOutput(&unit->output, &end, 1)) return 0;
+  }
+
+  return 1;
+
+noMemory:
+  free(cells);
+  return 0;
+}
+
+static void
+handleBatchUnit (ContractionCache *cache, unsigned int index) {
+  BatchUnit *unit = &batchUnits.array[index];
+
+  unit->translated = translateBatchUnit(cache, unit);
+}
+
+static int
+writeBatchUnits (void *data) {
+  int ok = 1;
+
+  runWorkThreads(batchUnits.count, handleBatchUnit);
+
+  for (unsigned int index=0; index<batchUnits.count; index+=1) {
+    BatchUnit *unit = &batchUnits.array[index];
+
+    if (ok) {
+      if (!unit->translated) {
+        noMemory(data);
+        ok = 0;
+      } else {
+        fwrite(unit->output.bytes, 1, unit->output.length, outputStream);
+
+        if (!checkOutputStream(data)) {
+          ok = 0;
+        } else {
+          translationStatistics.characters += unit->length;
+          translationStatistics.cells += unit->cells;
+        }
+      }
+    }
+
+    if (unit->output.bytes) free(unit->output.bytes);
+    if (unit->characters) free(unit->characters);
+  }
+
+  batchUnits.count = 0;
+  return ok;
+}
+
+static void
+deallocateBatchUnits (void) {
+  if (batchUnits.array) {
+    free(batchUnits.array);
+    batchUnits.array = NULL;
+  }
+
+  batchUnits.size = 0;
+}
+
+static int
+endDocument (void *data) {
+  if (!flushCharacters('\n', data)) return 0;
+  if (!writeBatchUnits(data)) return 0;
+  if (!putCharacter(FS, data)) return 0;
+  if (!putCharacter('\n', data)) return 0;
+  if (!flushOutputStream(data)) return 0;
+
+  translationStatistics.documents += 1;
+  return 1;
+}
+
+static int
+writeBatchDocuments (const wchar_t *characters, size_t length, void *data) {
+  if ((length == 1) && (characters[0] == FS)) return endDocument(data);
+  return writeContractedBraille(characters, length, data);
+}
+
+static void
+logTranslationStatistics (void) {
+  long int elapsed = getMonotonicElapsed(&translationStatistics.started);
+  unsigned long rate = elapsed? (translationStatistics.characters * MSECS_PER_SEC / elapsed): 0;
+
+  logMessage(LOG_NOTICE,
+             "translation statistics: Threads:%u Docs:%lu Chars:%lu Cells:%lu Time:%ldms Rate:%lu/s",
+             threadCount,
+             translationStatistics.documents,
+             translationStatistics.characters,
+             translationStatistics.cells,
+             elapsed, rate);
+}
+
 static char *
 makeUtf8FromCells (unsigned char *cells, size_t count) {
   char *text = malloc((count * UTF8_LEN_MAX) + 1);
@@ -355,6 +736,209 @@ outputError:
   return 0;
 }
 
+typedef struct {
+  const char *fileName;
+  int lineNumber;
+
+  const wchar_t *text;
+  const unsigned char *expected;
+  unsigned char textLength;
+  unsigned char expectedCount;
+
+  unsigned char *actual;
+  int actualCount;
+} VerificationEntry;
+
+static struct {
+  VerificationEntry **array;
+  unsigned int size;
+  unsigned int count;
+
+  char **fileNames;
+  unsigned int fileNameCount;
+} verificationEntries;
+
+static const char *
+getVerificationFileName (DataFile *file) {
+  const char *name = getDataFileName(file);
+  unsigned int count = verificationEntries.fileNameCount;
+
+  if (count) {
+    char *last = verificationEntries.fileNames[count - 1];
+    if (strcmp(last, name) == 0) return last;
+  }
+
+  {
+    char **newNames = realloc(verificationEntries.fileNames, ARRAY_SIZE(newNames, count+1));
+
+    if (!newNames) {
+      logMallocError();
+      return NULL;
+    }
+
+    verificationEntries.fileNames = newNames;
+  }
+
+  if (!(verificationEntries.fileNames[count] = strdup(name))) {
+    logMallocError();
+    return NULL;
+  }
+
+  verificationEntries.fileNameCount += 1;
+  return verificationEntries.fileNames[count];
+}
+
+static int
+addVerificationEntry (DataFile *file, const DataString *text, const ByteOperand *cells) {
+  if (verificationEntries.count == verificationEntries.size) {
+    unsigned int newSize = verificationEntries.size? verificationEntries.size<<1: 0X100;
+    VerificationEntry **newArray = realloc(verificationEntries.array, ARRAY_SIZE(newArray, newSize));
+
+    if (!newArray) {
+      logMallocError();
+      return 0;
+    }
+
+    verificationEntries.array = newArray;
+    verificationEntries.size = newSize;
+  }
+
+  {
+    VerificationEntry *entry;
+    size_t textSize = ARRAY_SIZE(text->characters, text->length+1);
+    size_t size = sizeof(*entry) + textSize + cells->length;
+
+    if (!(entry = malloc(size))) {
+      logMallocError();
+      return 0;
+    }
+
+    memset(entry, 0, sizeof(*entry));
+    if (!(entry->fileName = getVerificationFileName(file))) {
+      free(entry);
+      return 0;
+    }
+
+    entry->lineNumber = getDataFileLine(file);
+
+    {
+      wchar_t *characters = (wchar_t *)(entry + 1);
+      unsigned char *expected = (unsigned char *)(characters + text->length + 1);
+
+      wmemcpy(characters, text->characters, text->length);
+      characters[text->length] = 0;
+      memcpy(expected, cells->bytes, cells->length);
+
+      entry->text = characters;
+      entry->textLength = text->length;
+      entry->expected = expected;
+      entry->expectedCount = cells->length;
+    }
+
+    verificationEntries.array[verificationEntries.count++] = entry;
+  }
+
+  return 1;
+}
+
+static void
+deallocateVerificationEntries (void) {
+  while (verificationEntries.count) {
+    VerificationEntry *entry = verificationEntries.array[--verificationEntries.count];
+
+    if (entry->actual) free(entry->actual);
+    free(entry);
+  }
+
+  if (verificationEntries.array) {
+    free(verificationEntries.array);
+    verificationEntries.array = NULL;
+  }
+
+  verificationEntries.size = 0;
+
+  while (verificationEntries.fileNameCount) {
+    free(verificationEntries.fileNames[--verificationEntries.fileNameCount]);
+  }
+
+  if (verificationEntries.fileNames) {
+    free(verificationEntries.fileNames);
+    verificationEntries.fileNames = NULL;
+  }
+}
+
+static int
+verifyEntry (ContractionCache *cache, VerificationEntry *entry) {
+  int inputCount = entry->textLength;
+  int outputCount = inputCount << 3;
+  unsigned char outputBuffer[outputCount];
+
+  contractTextWithCache(contractionTable, cache,
+                        entry->text, &inputCount,
+                        outputBuffer, &outputCount,
+                        NULL, CTB_NO_CURSOR);
+
+  if ((outputCount == entry->expectedCount) &&
+      (memcmp(entry->expected, outputBuffer, outputCount) == 0)) {
+    return 1;
+  }
+
+  if ((entry->actual = malloc(outputCount + 1))) {
+    memcpy(entry->actual, outputBuffer, outputCount);
+    entry->actualCount = outputCount;
+  } else {
+    logMallocError();
+  }
+
+  return 0;
+}
+
+static void
+handleVerificationEntry (ContractionCache *cache, unsigned int index) {
+  verifyEntry(cache, verificationEntries.array[index]);
+}
+
+static void
+reportVerificationError (const VerificationEntry *entry, const char *format, ...) {
+  char message[0X400];
+  va_list args;
+
+  va_start(args, format);
+  formatInputError(message, sizeof(message), entry->fileName, &entry->lineNumber, format, args);
+  va_end(args);
+
+  logMessage(LOG_WARNING, "%s", message);
+}
+
+static unsigned int
+reportVerificationMismatches (void) {
+  unsigned int mismatches = 0;
+
+  for (unsigned int index=0; index<verificationEntries.count; index+=1) {
+    const VerificationEntry *entry = verificationEntries.array[index];
+
+    if (entry->actual) {
+      char *expected;
+
+      if ((expected = makeUtf8FromCells((unsigned char *)entry->expected, entry->expectedCount))) {
+        char *actual;
+
+        if ((actual = makeUtf8FromCells(entry->actual, entry->actualCount))) {
+          reportVerificationError(entry, "%" PRIws ": expected %s, got %s",
+                                  entry->text, expected, actual);
+          free(actual);
+        }
+
+        free(expected);
+      }
+
+      mismatches += 1;
+    }
+  }
+
+  return mismatches;
+}
+
 static DATA_OPERANDS_PROCESSOR(processContractsOperands) {
   DataString text;
 
@@ -362,34 +946,7 @@ static DATA_OPERANDS_PROCESSOR(processContractsOperands) {
     ByteOperand cells;
 
     if (getCellsOperand(file, &cells, "contracted braille")) {
-      int inputCount = text.length;
-      int outputCount = inputCount << 3;
-      unsigned char outputBuffer[outputCount];
-
-      contractText(contractionTable,
-		   text.characters, &inputCount,
-		   outputBuffer, &outputCount,
-		   NULL, CTB_NO_CURSOR);
-
-      if ((outputCount != cells.length) ||
-	  (memcmp(cells.bytes, outputBuffer, outputCount) != 0)) {
-	char *expected;
-
-	if ((expected = makeUtf8FromCells(cells.bytes, cells.length))) {
-           char *actual;
-
-           if ((actual = makeUtf8FromCells(outputBuffer, outputCount))) {
-              reportDataError(file,
-                              "%" PRIws ": expected %s, got %s",
-                              text.characters, expected, actual); 
-              free(actual);
-           }
-
-           free(expected);
-        }
-      }
-
-      return 1;
+      return addVerificationEntry(file, &text, &cells);
     }
   }
 
@@ -406,6 +963,10 @@ static  DATA_OPERANDS_PROCESSOR(processVerificationOperands) {
 
 static ProgramExitStatus
 processVerificationTable (void) {
+  ProgramExitStatus exitStatus = PROG_EXIT_FATAL;
+
+  memset(&verificationEntries, 0, sizeof(verificationEntries));
+
   if (setTableDataVariables(VERIFICATION_TABLE_EXTENSION, VERIFICATION_SUBTABLE_EXTENSION)) {
     const DataFileParameters parameters = {
       .processOperands = processVerificationOperands,
@@ -413,11 +974,33 @@ processVerificationTable (void) {
     };
 
     if (processDataStream(NULL, verificationTableStream, verificationTablePath, &parameters)) {
-      return PROG_EXIT_SUCCESS;
+      unsigned int mismatches;
+      unsigned long int characters = 0;
+      TimeValue start;
+      long int elapsed;
+
+      getMonotonicTime(&start);
+      runWorkThreads(verificationEntries.count, handleVerificationEntry);
+      elapsed = getMonotonicElapsed(&start);
+
+      for (unsigned int index=0; index<verificationEntries.count; index+=1) {
+        characters += verificationEntries.array[index]->textLength;
+      }
+
+      mismatches = reportVerificationMismatches();
+
+      logMessage(LOG_NOTICE,
+                 "verification statistics: %s: Threads:%u Entries:%u Mismatches:%u Chars:%lu Time:%ldms Rate:%lu/s",
+                 verificationTablePath, MIN(threadCount, verificationEntries.count),
+                 verificationEntries.count, mismatches, characters,
+                 elapsed, (elapsed? (characters * MSECS_PER_SEC / elapsed): 0));
+
+      exitStatus = mismatches? PROG_EXIT_SEMANTIC: PROG_EXIT_SUCCESS;
     }
   }
 
-  return PROG_EXIT_FATAL;
+  deallocateVerificationEntries();
+  return exitStatus;
 }
 
 static DATA_OPERANDS_PROCESSOR(processInputLine) {
@@ -450,6 +1033,21 @@ main (int argc, char *argv[]) {
   inputSize = 0;
   inputLength = 0;
 
+  if (opt_batchMode && opt_verificationTable && *opt_verificationTable) {
+    logMessage(LOG_ERR, "batch mode can't be used with a verification table");
+    return PROG_EXIT_SYNTAX;
+  }
+
+  threadCount = getThreadCount();
+  memset(&translationStatistics, 0, sizeof(translationStatistics));
+  memset(&batchUnits, 0, sizeof(batchUnits));
+  putTranslation = writeTranslation;
+
+  if (opt_batchMode) {
+    processInputCharacters = writeBatchDocuments;
+    putTranslation = queueBatchUnit;
+  }
+
   outputStream = stdout;
   outputBuffer = NULL;
 
@@ -472,7 +1070,7 @@ main (int argc, char *argv[]) {
         if (*opt_textTable) {
           char *textTablePath;
 
-          putCell = putMappedCharacter;
+          convertCell = convertCellToMappedCharacter;
 
           if ((textTablePath = makeTextTablePath(opt_tablesDirectory, opt_textTable))) {
             exitStatus = (textTable = compileTextTable(textTablePath))? PROG_EXIT_SUCCESS: PROG_EXIT_FATAL;
@@ -481,7 +1079,7 @@ main (int argc, char *argv[]) {
             exitStatus = PROG_EXIT_FATAL;
           }
         } else {
-          putCell = putUnicodeBraille;
+          convertCell = convertCellToUnicodeBraille;
           exitStatus = PROG_EXIT_SUCCESS;
         }
 
@@ -517,11 +1115,20 @@ main (int argc, char *argv[]) {
               }
             };
 
+            getMonotonicTime(&translationStatistics.started);
+
             if ((exitStatus = processInputFiles(argv, argc, &parameters)) == PROG_EXIT_SUCCESS) {
-              if (!(flushCharacters('\n', &lpd) && flushOutputStream(&lpd))) {
+              if (!(flushCharacters('\n', &lpd) &&
+                    (!opt_batchMode || writeBatchUnits(&lpd)) &&
+                    flushOutputStream(&lpd))) {
                 exitStatus = lpd.exitStatus;
               }
             }
+
+            if (opt_batchMode) {
+              logTranslationStatistics();
+              deallocateBatchUnits();
+            }
           }
 
           if (textTable) destroyTextTable(textTable);
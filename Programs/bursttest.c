@@ -0,0 +1,365 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2017 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+/* This program passes bursts of key events through uinput keyboards the way
+ * the Linux keyboard monitor does (see handleLinuxKeyboardEvent), and reads
+ * them back from the corresponding evdev nodes. Each scenario checks that
+ * a batch isn't seen before it's ended (or flushed), that every key arrives
+ * once and in order, and that a flush makes the keys which were passed
+ * through visible before a bound key's command would run.
+ */
+
+#include "prologue.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_LINUX_UINPUT_H
+#include <fcntl.h>
+#include <poll.h>
+#include <dirent.h>
+#include <sys/ioctl.h>
+#include <linux/input.h>
+#endif /* HAVE_LINUX_UINPUT_H */
+
+#include "program.h"
+#include "options.h"
+#include "log.h"
+#include "timing.h"
+#include "parameters.h"
+
+#ifdef HAVE_LINUX_UINPUT_H
+#include "system_linux.h"
+#endif /* HAVE_LINUX_UINPUT_H */
+
+static char *opt_scenarioName;
+
+BEGIN_OPTION_TABLE(programOptions)
+  { .letter = 's',
+    .word = "scenario",
+    .argument = "name",
+    .setting.string = &opt_scenarioName,
+    .description = "Only run this scenario."
+  },
+END_OPTION_TABLE
+
+/* One read of LINUX_INPUT_EVENT_READ_COUNT events holds at most this many
+ * key transitions, since every one of them is followed by a SYN_REPORT.
+ */
+#define BURST_LIMIT (LINUX_INPUT_EVENT_READ_COUNT / 2)
+
+#define DEVICE_WAIT 2000
+#define EVENT_WAIT 200
+
+typedef struct {
+  const char *name;
+  unsigned int before; /* keys passed through before the bound one */
+  unsigned int after; /* keys passed through after it */
+  unsigned batched:1;
+  unsigned bound:1;
+} BurstScenario;
+
+static const BurstScenario burstScenarios[] = {
+  { .name = "single",
+    .before = 8
+  },
+
+  { .name = "burst",
+    .before = BURST_LIMIT, .batched = 1
+  },
+
+  { .name = "bound",
+    .before = 6, .after = 6, .batched = 1, .bound = 1
+  },
+};
+
+#ifdef HAVE_LINUX_UINPUT_H
+typedef struct {
+  const char *name;
+  UinputObject *uinput;
+  int descriptor;
+} TestKeyboard;
+
+static int
+openEventDevice (const char *name) {
+  char wanted[0X100];
+  long int elapsed = 0;
+
+  snprintf(wanted, sizeof(wanted), "%s %s %s", PACKAGE_NAME, PACKAGE_VERSION, name);
+
+  /* the node is created asynchronously (by udev) */
+  while (1) {
+    static const char root[] = "/dev/input";
+    DIR *directory;
+
+    if ((directory = opendir(root))) {
+      struct dirent *entry;
+
+      while ((entry = readdir(directory))) {
+        char path[0X100];
+        int descriptor;
+
+        if (strncmp(entry->d_name, "event", 5) != 0) continue;
+        snprintf(path, sizeof(path), "%s/%s", root, entry->d_name);
+
+        if ((descriptor = open(path, O_RDONLY | O_NONBLOCK)) != -1) {
+          char actual[0X100];
+
+          if (ioctl(descriptor, EVIOCGNAME(sizeof(actual)), actual) != -1) {
+            if (strcmp(actual, wanted) == 0) {
+              closedir(directory);
+              return descriptor;
+            }
+          }
+
+          close(descriptor);
+        }
+      }
+
+      closedir(directory);
+    }
+
+    if (elapsed >= DEVICE_WAIT) break;
+    approximateDelay(50);
+    elapsed += 50;
+  }
+
+  logMessage(LOG_ERR, "event device not found: %s", wanted);
+  return -1;
+}
+
+static int
+openTestKeyboard (TestKeyboard *keyboard, const char *name) {
+  keyboard->name = name;
+
+  if ((keyboard->uinput = newUinputKeyboard(name))) {
+    if ((keyboard->descriptor = openEventDevice(name)) != -1) return 1;
+    destroyUinputObject(keyboard->uinput);
+  }
+
+  return 0;
+}
+
+static void
+closeTestKeyboard (TestKeyboard *keyboard) {
+  close(keyboard->descriptor);
+  destroyUinputObject(keyboard->uinput);
+}
+
+static int
+getTestKey (unsigned int index) {
+  return KEY_1 + (index % (KEY_SPACE - KEY_1));
+}
+
+static int
+writeTestKeys (TestKeyboard *keyboard, unsigned int from, unsigned int count) {
+  for (unsigned int index=from; index<(from + count); index+=1) {
+    int key = getTestKey(index);
+
+    if (!writeKeyEvent(keyboard->uinput, key, 1)) return 0;
+    if (!writeKeyEvent(keyboard->uinput, key, 0)) return 0;
+  }
+
+  return 1;
+}
+
+/* Returns the number of key transitions read, or -1 if any were lost or
+ * arrived out of order.
+ */
+static int
+readTestKeys (TestKeyboard *keyboard, unsigned int from, int wait) {
+  unsigned int count = 0;
+
+  while (1) {
+    struct pollfd pfd = {
+      .fd = keyboard->descriptor,
+      .events = POLLIN
+    };
+
+    int result = poll(&pfd, 1, wait);
+
+    if (result == -1) {
+      if (errno == EINTR) continue;
+      logSystemError("poll");
+      return -1;
+    }
+
+    if (!result) break;
+
+    {
+      struct input_event events[LINUX_INPUT_EVENT_READ_COUNT];
+      ssize_t length = read(keyboard->descriptor, events, sizeof(events));
+
+      if (length == -1) {
+        if (errno == EAGAIN) break;
+        logSystemError("read");
+        return -1;
+      }
+
+      {
+        const struct input_event *event = events;
+        const struct input_event *end = event + (length / sizeof(*event));
+
+        while (event < end) {
+          if ((event->type == EV_SYN) && (event->code == SYN_DROPPED)) {
+            logMessage(LOG_ERR, "%s: events dropped", keyboard->name);
+            return -1;
+          }
+
+          if ((event->type == EV_KEY) && (event->value != 2)) {
+            unsigned int index = from + (count / 2);
+            int press = !(count % 2);
+
+            if ((event->code != getTestKey(index)) || (!event->value != !press)) {
+              logMessage(LOG_ERR, "%s: unexpected key: %u %s",
+                         keyboard->name, event->code, (event->value? "press": "release"));
+              return -1;
+            }
+
+            count += 1;
+          }
+
+          event += 1;
+        }
+      }
+    }
+  }
+
+  return count / 2;
+}
+
+static int
+runScenario (const BurstScenario *scenario, TestKeyboard *keyboard, TestKeyboard *commands) {
+  int early = 0;
+  int before;
+  int command = 0;
+  int after = 0;
+  long int time;
+  TimeValue start;
+
+  getMonotonicTime(&start);
+  if (scenario->batched) beginUinputBatch(keyboard->uinput);
+  if (!writeTestKeys(keyboard, 0, scenario->before)) return 0;
+
+  if (scenario->batched) {
+    /* nothing may be seen until the batch is flushed */
+    early = readTestKeys(keyboard, 0, 0);
+
+    if (scenario->bound) {
+      flushUinputBatch(keyboard->uinput);
+    } else {
+      endUinputBatch(keyboard->uinput);
+    }
+  }
+
+  before = readTestKeys(keyboard, 0, EVENT_WAIT);
+
+  if (scenario->bound) {
+    /* what the bound key's command writes */
+    if (!writeTestKeys(commands, 0, 1)) return 0;
+    command = readTestKeys(commands, 0, EVENT_WAIT);
+
+    if (!writeTestKeys(keyboard, scenario->before, scenario->after)) return 0;
+    if (readTestKeys(keyboard, scenario->before, 0)) early = -1;
+    endUinputBatch(keyboard->uinput);
+    after = readTestKeys(keyboard, scenario->before, EVENT_WAIT);
+  }
+
+  time = getMonotonicElapsed(&start);
+
+  {
+    int ok = !early &&
+             (before == scenario->before) &&
+             (command == !!scenario->bound) &&
+             (after == scenario->after);
+
+    printf("%-8s before:%2d command:%d after:%2d early:%2d %4ldms %s\n",
+           scenario->name, before, command, after, early, time, (ok? "ok": "FAILED"));
+
+    return ok;
+  }
+}
+#endif /* HAVE_LINUX_UINPUT_H */
+
+int
+main (int argc, char *argv[]) {
+  {
+    static const OptionsDescriptor descriptor = {
+      OPTION_TABLE(programOptions),
+      .applicationName = "bursttest"
+    };
+
+    PROCESS_OPTIONS(descriptor, argc, argv);
+  }
+
+  if (argc) {
+    logMessage(LOG_ERR, "too many parameters");
+    return PROG_EXIT_SYNTAX;
+  }
+
+#ifdef HAVE_LINUX_UINPUT_H
+  {
+    ProgramExitStatus exitStatus = PROG_EXIT_FATAL;
+    TestKeyboard keyboard;
+
+    if (!openTestKeyboard(&keyboard, "bursttest keyboard")) {
+      logMessage(LOG_WARNING, "uinput keyboards not available");
+      return PROG_EXIT_SUCCESS;
+    }
+
+    {
+      TestKeyboard commands;
+
+      if (openTestKeyboard(&commands, "bursttest commands")) {
+        unsigned int failures = 0;
+        unsigned int count = 0;
+
+        for (unsigned int index=0; index<ARRAY_COUNT(burstScenarios); index+=1) {
+          const BurstScenario *scenario = &burstScenarios[index];
+
+          if (opt_scenarioName && *opt_scenarioName) {
+            if (strcmp(scenario->name, opt_scenarioName) != 0) continue;
+          }
+
+          if (!runScenario(scenario, &keyboard, &commands)) failures += 1;
+          count += 1;
+        }
+
+        if (!count) {
+          logMessage(LOG_ERR, "unknown scenario: %s", opt_scenarioName);
+          exitStatus = PROG_EXIT_SYNTAX;
+        } else if (failures) {
+          logMessage(LOG_ERR, "key burst scenarios failed: %u", failures);
+          exitStatus = PROG_EXIT_SEMANTIC;
+        } else {
+          exitStatus = PROG_EXIT_SUCCESS;
+        }
+
+        closeTestKeyboard(&commands);
+      }
+    }
+
+    closeTestKeyboard(&keyboard);
+    return exitStatus;
+  }
+#else /* HAVE_LINUX_UINPUT_H */
+  logMessage(LOG_WARNING, "uinput not supported");
+  return PROG_EXIT_SUCCESS;
+#endif /* HAVE_LINUX_UINPUT_H */
+}
@@ -40,6 +40,8 @@
 #include "spk_input.h"
 #include "scr.h"
 #include "scr_special.h"
+#include "scr_export.h"
+#include "scr_record.h"
 #include "status.h"
 #include "blink.h"
 #include "variables.h"
@@ -230,6 +232,8 @@ static char **screenDrivers = NULL;
 static const ScreenDriver *screenDriver = NULL;
 static void *screenObject = NULL;
 static char *opt_screenParameters;
+static char *opt_screenExport;
+static char *opt_screenRecording;
 static char *screenParameters = NULL;
 static char **screenDriverParameters = NULL;
 
@@ -537,6 +541,22 @@ BEGIN_OPTION_TABLE(programOptions)
     .description = strtext("Parameters for the screen driver.")
   },
 
+  { .letter = 'Z',
+    .word = "screen-export",
+    .flags = OPT_Hidden | OPT_Config | OPT_Environ,
+    .argument = strtext("name"),
+    .setting.string = &opt_screenExport,
+    .description = strtext("Name of shared memory object to which the screen is to be exported.")
+  },
+
+  { .letter = 'Y',
+    .word = "screen-recording",
+    .flags = OPT_Hidden | OPT_Config | OPT_Environ,
+    .argument = strtext("file"),
+    .setting.string = &opt_screenRecording,
+    .description = strtext("Path to file into which screen changes and commands are to be recorded.")
+  },
+
 #ifdef HAVE_PCM_SUPPORT
   { .letter = 'p',
     .word = "pcm-device",
@@ -964,6 +984,18 @@ makeBrailleKeyTablePath (void) {
   return makeInputTablePath(opt_tablesDirectory, braille->definition.code, brl.keyBindings);
 }
 
+static int
+generateBrailleHelpPage (void *data UNUSED) {
+  int listed = listKeyTable(brl.keyTable, NULL, handleWcharHelpLine, NULL);
+
+  if (!getHelpLineCount()) {
+    logMessage(LOG_WARNING, "%s", gettext("no key bindings"));
+    addHelpLine(WS_C("help not available"));
+  }
+
+  return listed;
+}
+
 static void
 makeBrailleHelpPage (const char *keyTablePath) {
   if (!brl.keyTable) {
@@ -987,7 +1019,8 @@ makeBrailleHelpPage (const char *keyTablePath) {
       free(keyHelpPath);
     }
   } else if (enableBrailleHelpPage()) {
-    listKeyTable(brl.keyTable, NULL, handleWcharHelpLine, NULL);
+    setHelpPageGenerator(generateBrailleHelpPage, NULL);
+    return;
   }
 
   if (!getHelpLineCount()) {
@@ -996,10 +1029,15 @@ makeBrailleHelpPage (const char *keyTablePath) {
   }
 }
 
+static int
+generateKeyboardHelpPage (void *data UNUSED) {
+  return listKeyTable(keyboardTable, NULL, handleWcharHelpLine, NULL);
+}
+
 static void
 makeKeyboardHelpPage (void) {
   if (enableKeyboardHelpPage()) {
-    listKeyTable(keyboardTable, NULL, handleWcharHelpLine, NULL);
+    setHelpPageGenerator(generateKeyboardHelpPage, NULL);
   }
 }
 
@@ -2265,6 +2303,16 @@ exitScreenData (void *data) {
   }
 }
 
+static void
+exitScreenExport (void *data) {
+  stopScreenExport();
+}
+
+static void
+exitScreenRecording (void *data) {
+  stopScreenRecording();
+}
+
 int
 changeScreenDriver (const char *driver) {
   char **newDrivers = splitString(driver, ',', NULL);
@@ -2604,6 +2652,18 @@ brlttyStart (void) {
   beginSpecialScreens();
   onProgramExit("screen-data", exitScreenData, NULL);
 
+  if (*opt_screenExport) {
+    if (startScreenExport(opt_screenExport)) {
+      onProgramExit("screen-export", exitScreenExport, NULL);
+    }
+  }
+
+  if (*opt_screenRecording) {
+    if (startScreenRecording(opt_screenRecording)) {
+      onProgramExit("screen-recording", exitScreenRecording, NULL);
+    }
+  }
+
   suppressTuneDeviceOpenErrors();
 
   {
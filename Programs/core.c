@@ -59,6 +59,7 @@
 #include "routing.h"
 #include "charset.h"
 #include "scr.h"
+#include "scr_record.h"
 #include "update.h"
 #include "ses.h"
 #include "brl.h"
@@ -134,9 +135,14 @@ static void
 postprocessCommand (void *state, int command, int handled) {
   PrecommandState *pre = state;
 
+  recordScreenCommand(command);
+
   if (pre) {
     resumeUpdates(0);
-    if (handled) scheduleUpdate("command executed");
+    if (handled) {
+      markUpdateLatency(UPDATE_LATENCY_COMMAND);
+      scheduleUpdate("command executed");
+    }
 
     if ((ses->winx != pre->motionColumn) || (ses->winy != pre->motionRow)) {
       /* The braille window has been manually moved. */
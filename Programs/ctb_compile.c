@@ -561,23 +561,89 @@ stopContractionCommand (ContractionTable *table) {
   }
 }
 
-static void
-initializeCommonFields (ContractionTable *table) {
-  table->characters.array = NULL;
-  table->characters.size = 0;
-  table->characters.count = 0;
+void
+initializeContractionCache (ContractionCache *cache) {
+  cache->table = NULL;
+
+  cache->characters.array = NULL;
+  cache->characters.size = 0;
+  cache->characters.count = 0;
+
+  cache->translation.input.characters = NULL;
+  cache->translation.input.size = 0;
+  cache->translation.input.count = 0;
 
-  table->cache.input.characters = NULL;
-  table->cache.input.size = 0;
-  table->cache.input.count = 0;
+  cache->translation.output.cells = NULL;
+  cache->translation.output.size = 0;
+  cache->translation.output.count = 0;
 
-  table->cache.output.cells = NULL;
-  table->cache.output.size = 0;
-  table->cache.output.count = 0;
+  cache->translation.offsets.array = NULL;
+  cache->translation.offsets.size = 0;
+  cache->translation.offsets.count = 0;
+
+  cache->options.expandCurrentWord = 0;
+  cache->options.capitalizationMode = CTB_CAP_NONE;
+}
+
+void
+clearContractionCache (ContractionCache *cache) {
+  if (cache->characters.array) {
+    free(cache->characters.array);
+    cache->characters.array = NULL;
+  }
+
+  cache->characters.size = 0;
+  cache->characters.count = 0;
+
+  if (cache->translation.input.characters) {
+    free(cache->translation.input.characters);
+    cache->translation.input.characters = NULL;
+  }
+
+  cache->translation.input.size = 0;
+  cache->translation.input.count = 0;
+
+  if (cache->translation.output.cells) {
+    free(cache->translation.output.cells);
+    cache->translation.output.cells = NULL;
+  }
+
+  cache->translation.output.size = 0;
+  cache->translation.output.count = 0;
+
+  if (cache->translation.offsets.array) {
+    free(cache->translation.offsets.array);
+    cache->translation.offsets.array = NULL;
+  }
 
-  table->cache.offsets.array = NULL;
-  table->cache.offsets.size = 0;
-  table->cache.offsets.count = 0;
+  cache->translation.offsets.size = 0;
+  cache->translation.offsets.count = 0;
+}
+
+ContractionCache *
+newContractionCache (void) {
+  ContractionCache *cache;
+
+  if ((cache = malloc(sizeof(*cache)))) {
+    memset(cache, 0, sizeof(*cache));
+    initializeContractionCache(cache);
+  } else {
+    logMallocError();
+  }
+
+  return cache;
+}
+
+void
+destroyContractionCache (ContractionCache *cache) {
+  clearContractionCache(cache);
+  free(cache);
+}
+
+static void
+initializeCommonFields (ContractionTable *table) {
+  initializeContractionCache(&table->cache);
+  table->commandLock = NULL;
 }
 
 ContractionTable *
@@ -590,6 +656,7 @@ compileContractionTable (const char *fileName) {
 
       if ((table->command = strdup(fileName))) {
         initializeCommonFields(table);
+        table->commandLock = newLockDescriptor();
         table->data.external.commandStarted = 0;
 
         table->data.external.input.buffer = NULL;
@@ -668,24 +735,11 @@ compileContractionTable (const char *fileName) {
 
 void
 destroyContractionTable (ContractionTable *table) {
-  if (table->characters.array) {
-    free(table->characters.array);
-    table->characters.array = NULL;
-  }
-
-  if (table->cache.input.characters) {
-    free(table->cache.input.characters);
-    table->cache.input.characters = NULL;
-  }
-
-  if (table->cache.output.cells) {
-    free(table->cache.output.cells);
-    table->cache.output.cells = NULL;
-  }
+  clearContractionCache(&table->cache);
 
-  if (table->cache.offsets.array) {
-    free(table->cache.offsets.array);
-    table->cache.offsets.array = NULL;
+  if (table->commandLock) {
+    freeLockDescriptor(table->commandLock);
+    table->commandLock = NULL;
   }
 
   if (table->command) {
@@ -21,6 +21,8 @@
 
 #include <stdio.h>
 
+#include "lock.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -119,7 +121,9 @@ typedef struct {
   const ContractionTableRule *always;
 } CharacterEntry;
 
-struct ContractionTableStruct {
+struct ContractionCacheStruct {
+  const ContractionTable *table; /* what the entries and the translation came from */
+
   struct {
     CharacterEntry *array;
     int size;
@@ -150,7 +154,17 @@ struct ContractionTableStruct {
     int cursorOffset;
     unsigned char expandCurrentWord;
     unsigned char capitalizationMode;
-  } cache;
+  } translation;
+
+  struct {
+    unsigned char expandCurrentWord;
+    unsigned char capitalizationMode;
+  } options;
+};
+
+struct ContractionTableStruct {
+  ContractionCache cache;
+  LockDescriptor *commandLock;
 
   char *command;
 
@@ -180,6 +194,9 @@ struct ContractionTableStruct {
 extern int startContractionCommand (ContractionTable *table);
 extern void stopContractionCommand (ContractionTable *table);
 
+extern void initializeContractionCache (ContractionCache *cache);
+extern void clearContractionCache (ContractionCache *cache);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -40,6 +40,7 @@
 
 typedef struct {
   ContractionTable *const table;
+  ContractionCache *const cache;
 
   struct {
     const wchar_t *begin;
@@ -170,11 +171,11 @@ setAlwaysRule (wchar_t character, void *data) {
 static CharacterEntry *
 getCharacterEntry (BrailleContractionData *bcd, wchar_t character) {
   int first = 0;
-  int last = bcd->table->characters.count - 1;
+  int last = bcd->cache->characters.count - 1;
 
   while (first <= last) {
     int current = (first + last) / 2;
-    CharacterEntry *entry = &bcd->table->characters.array[current];
+    CharacterEntry *entry = &bcd->cache->characters.array[current];
 
     if (entry->value < character) {
       first = current + 1;
@@ -185,30 +186,30 @@ getCharacterEntry (BrailleContractionData *bcd, wchar_t character) {
     }
   }
 
-  if (bcd->table->characters.count == bcd->table->characters.size) {
-    int newSize = bcd->table->characters.size;
+  if (bcd->cache->characters.count == bcd->cache->characters.size) {
+    int newSize = bcd->cache->characters.size;
     newSize = newSize? newSize<<1: 0X80;
 
     {
-      CharacterEntry *newArray = realloc(bcd->table->characters.array, (newSize * sizeof(*newArray)));
+      CharacterEntry *newArray = realloc(bcd->cache->characters.array, (newSize * sizeof(*newArray)));
 
       if (!newArray) {
         logMallocError();
         return NULL;
       }
 
-      bcd->table->characters.array = newArray;
-      bcd->table->characters.size = newSize;
+      bcd->cache->characters.array = newArray;
+      bcd->cache->characters.size = newSize;
     }
   }
 
-  memmove(&bcd->table->characters.array[first+1],
-          &bcd->table->characters.array[first],
-          (bcd->table->characters.count - first) * sizeof(*bcd->table->characters.array));
-  bcd->table->characters.count += 1;
+  memmove(&bcd->cache->characters.array[first+1],
+          &bcd->cache->characters.array[first],
+          (bcd->cache->characters.count - first) * sizeof(*bcd->cache->characters.array));
+  bcd->cache->characters.count += 1;
 
   {
-    CharacterEntry *entry = &bcd->table->characters.array[first];
+    CharacterEntry *entry = &bcd->cache->characters.array[first];
     memset(entry, 0, sizeof(*entry));
     entry->value = entry->uppercase = entry->lowercase = character;
 
@@ -402,7 +403,7 @@ selectRule (BrailleContractionData *bcd, int length) {
       if (!maximumLength) {
         maximumLength = bcd->current.length;
 
-        if (prefs.capitalizationMode != CTB_CAP_NONE) {
+        if (bcd->cache->options.capitalizationMode != CTB_CAP_NONE) {
           typedef enum {CS_Any, CS_Lower, CS_UpperSingle, CS_UpperMultiple} CapitalizationState;
 #define STATE(c) (testCharacter(bcd, (c), CTC_UpperCase)? CS_UpperSingle: testCharacter(bcd, (c), CTC_LowerCase)? CS_Lower: CS_Any)
 
@@ -420,14 +421,14 @@ selectRule (BrailleContractionData *bcd, int length) {
                 break;
               }
 
-              if ((prefs.capitalizationMode != CTB_CAP_SIGN) &&
+              if ((bcd->cache->options.capitalizationMode != CTB_CAP_SIGN) &&
                   (next == CS_UpperSingle)) {
                 maximumLength = i;
                 break;
               }
             }
 
-            if ((prefs.capitalizationMode == CTB_CAP_SIGN) && (current > CS_Lower) && (next == CS_UpperSingle)) {
+            if ((bcd->cache->options.capitalizationMode == CTB_CAP_SIGN) && (current > CS_Lower) && (next == CS_UpperSingle)) {
               current = CS_UpperMultiple;
             } else if (next != CS_Any) {
               current = next;
@@ -586,7 +587,7 @@ putReplace (BrailleContractionData *bcd, const ContractionTableRule *rule, wchar
   const BYTE *cells = (BYTE *)&rule->findrep[rule->findlen];
   int count = rule->replen;
 
-  if ((prefs.capitalizationMode == CTB_CAP_DOT7) &&
+  if ((bcd->cache->options.capitalizationMode == CTB_CAP_DOT7) &&
       testCharacter(bcd, character, CTC_UpperCase)) {
     if (!putCell(bcd, *cells++ | BRL_DOT_7)) return 0;
     if (!(count -= 1)) return 1;
@@ -1174,7 +1175,7 @@ contractTextInternally (BrailleContractionData *bcd) {
     if ((!literal && selectRule(bcd, getInputUnconsumed(bcd))) || selectRule(bcd, 1)) {
       if (!literal &&
           ((bcd->current.opcode == CTO_Literal) ||
-           (prefs.expandCurrentWord &&
+           (bcd->cache->options.expandCurrentWord &&
             (bcd->input.cursor >= bcd->input.current) &&
             (bcd->input.cursor < (bcd->input.current + bcd->current.length))))) {
         literal = bcd->input.current + bcd->current.length;
@@ -1211,7 +1212,7 @@ contractTextInternally (BrailleContractionData *bcd) {
         }
       }
 
-      if (prefs.capitalizationMode == CTB_CAP_SIGN) {
+      if (bcd->cache->options.capitalizationMode == CTB_CAP_SIGN) {
         if (testCurrent(bcd, CTC_UpperCase)) {
           if (!testBefore(bcd, CTC_UpperCase)) {
             if (getContractionTableHeader(bcd)->beginCapitalSign &&
@@ -1382,12 +1383,12 @@ putExternalRequests (BrailleContractionData *bcd) {
 
     { .name = "expand-current-word",
       .type = REQ_NUMBER,
-      .value.number = prefs.expandCurrentWord
+      .value.number = bcd->cache->options.expandCurrentWord
     },
 
     { .name = "capitalization-mode",
       .type = REQ_NUMBER,
-      .value.number = prefs.capitalizationMode
+      .value.number = bcd->cache->options.capitalizationMode
     },
 
     { .name = "maximum-length",
@@ -1519,7 +1520,7 @@ static const unsigned char brfTable[0X40] = {
 
 static int
 handleExternalResponse_brf (BrailleContractionData *bcd, const char *value) {
-  int useDot7 = prefs.capitalizationMode == CTB_CAP_DOT7;
+  int useDot7 = bcd->cache->options.capitalizationMode == CTB_CAP_DOT7;
 
   while (*value && (bcd->output.current < bcd->output.end)) {
     unsigned char brf = *value++ & 0XFF;
@@ -1678,18 +1679,18 @@ makeCachedCursorOffset (BrailleContractionData *bcd) {
 
 static int
 checkCache (BrailleContractionData *bcd) {
-  if (!bcd->table->cache.input.characters) return 0;
-  if (!bcd->table->cache.output.cells) return 0;
-  if (bcd->input.offsets && !bcd->table->cache.offsets.count) return 0;
-  if (bcd->table->cache.output.maximum != getOutputCount(bcd)) return 0;
-  if (bcd->table->cache.cursorOffset != makeCachedCursorOffset(bcd)) return 0;
-  if (bcd->table->cache.expandCurrentWord != prefs.expandCurrentWord) return 0;
-  if (bcd->table->cache.capitalizationMode != prefs.capitalizationMode) return 0;
+  if (!bcd->cache->translation.input.characters) return 0;
+  if (!bcd->cache->translation.output.cells) return 0;
+  if (bcd->input.offsets && !bcd->cache->translation.offsets.count) return 0;
+  if (bcd->cache->translation.output.maximum != getOutputCount(bcd)) return 0;
+  if (bcd->cache->translation.cursorOffset != makeCachedCursorOffset(bcd)) return 0;
+  if (bcd->cache->translation.expandCurrentWord != bcd->cache->options.expandCurrentWord) return 0;
+  if (bcd->cache->translation.capitalizationMode != bcd->cache->options.capitalizationMode) return 0;
 
   {
     unsigned int count = getInputCount(bcd);
-    if (bcd->table->cache.input.count != count) return 0;
-    if (wmemcmp(bcd->input.begin, bcd->table->cache.input.characters, count) != 0) return 0;
+    if (bcd->cache->translation.input.count != count) return 0;
+    if (wmemcmp(bcd->input.begin, bcd->cache->translation.input.characters, count) != 0) return 0;
   }
 
   return 1;
@@ -1700,90 +1701,111 @@ updateCache (BrailleContractionData *bcd) {
   {
     unsigned int count = getInputCount(bcd);
 
-    if (count > bcd->table->cache.input.size) {
+    if (count > bcd->cache->translation.input.size) {
       unsigned int newSize = count | 0X7F;
       wchar_t *newCharacters = malloc(ARRAY_SIZE(newCharacters, newSize));
 
       if (!newCharacters) {
         logMallocError();
-        bcd->table->cache.input.count = 0;
+        bcd->cache->translation.input.count = 0;
         goto inputDone;
       }
 
-      if (bcd->table->cache.input.characters) free(bcd->table->cache.input.characters);
-      bcd->table->cache.input.characters = newCharacters;
-      bcd->table->cache.input.size = newSize;
+      if (bcd->cache->translation.input.characters) free(bcd->cache->translation.input.characters);
+      bcd->cache->translation.input.characters = newCharacters;
+      bcd->cache->translation.input.size = newSize;
     }
 
-    wmemcpy(bcd->table->cache.input.characters, bcd->input.begin, count);
-    bcd->table->cache.input.count = count;
-    bcd->table->cache.input.consumed = getInputConsumed(bcd);
+    wmemcpy(bcd->cache->translation.input.characters, bcd->input.begin, count);
+    bcd->cache->translation.input.count = count;
+    bcd->cache->translation.input.consumed = getInputConsumed(bcd);
   }
 inputDone:
 
   {
     unsigned int count = getOutputConsumed(bcd);
 
-    if (count > bcd->table->cache.output.size) {
+    if (count > bcd->cache->translation.output.size) {
       unsigned int newSize = count | 0X7F;
       unsigned char *newCells = malloc(ARRAY_SIZE(newCells, newSize));
 
       if (!newCells) {
         logMallocError();
-        bcd->table->cache.output.count = 0;
+        bcd->cache->translation.output.count = 0;
         goto outputDone;
       }
 
-      if (bcd->table->cache.output.cells) free(bcd->table->cache.output.cells);
-      bcd->table->cache.output.cells = newCells;
-      bcd->table->cache.output.size = newSize;
+      if (bcd->cache->translation.output.cells) free(bcd->cache->translation.output.cells);
+      bcd->cache->translation.output.cells = newCells;
+      bcd->cache->translation.output.size = newSize;
     }
 
-    memcpy(bcd->table->cache.output.cells, bcd->output.begin, count);
-    bcd->table->cache.output.count = count;
-    bcd->table->cache.output.maximum = getOutputCount(bcd);
+    memcpy(bcd->cache->translation.output.cells, bcd->output.begin, count);
+    bcd->cache->translation.output.count = count;
+    bcd->cache->translation.output.maximum = getOutputCount(bcd);
   }
 outputDone:
 
   if (bcd->input.offsets) {
     unsigned int count = getInputCount(bcd);
 
-    if (count > bcd->table->cache.offsets.size) {
+    if (count > bcd->cache->translation.offsets.size) {
       unsigned int newSize = count | 0X7F;
       int *newArray = malloc(ARRAY_SIZE(newArray, newSize));
 
       if (!newArray) {
         logMallocError();
-        bcd->table->cache.offsets.count = 0;
+        bcd->cache->translation.offsets.count = 0;
         goto offsetsDone;
       }
 
-      if (bcd->table->cache.offsets.array) free(bcd->table->cache.offsets.array);
-      bcd->table->cache.offsets.array = newArray;
-      bcd->table->cache.offsets.size = newSize;
+      if (bcd->cache->translation.offsets.array) free(bcd->cache->translation.offsets.array);
+      bcd->cache->translation.offsets.array = newArray;
+      bcd->cache->translation.offsets.size = newSize;
     }
 
-    memcpy(bcd->table->cache.offsets.array, bcd->input.offsets, ARRAY_SIZE(bcd->input.offsets, count));
-    bcd->table->cache.offsets.count = count;
+    memcpy(bcd->cache->translation.offsets.array, bcd->input.offsets, ARRAY_SIZE(bcd->input.offsets, count));
+    bcd->cache->translation.offsets.count = count;
   } else {
-    bcd->table->cache.offsets.count = 0;
+    bcd->cache->translation.offsets.count = 0;
   }
 offsetsDone:
 
-  bcd->table->cache.cursorOffset = makeCachedCursorOffset(bcd);
-  bcd->table->cache.expandCurrentWord = prefs.expandCurrentWord;
-  bcd->table->cache.capitalizationMode = prefs.capitalizationMode;
+  bcd->cache->translation.cursorOffset = makeCachedCursorOffset(bcd);
+  bcd->cache->translation.expandCurrentWord = bcd->cache->options.expandCurrentWord;
+  bcd->cache->translation.capitalizationMode = bcd->cache->options.capitalizationMode;
 }
 
 void
-contractText (
+setContractionOptions (ContractionCache *cache, unsigned char expandCurrentWord, unsigned char capitalizationMode) {
+  cache->options.expandCurrentWord = expandCurrentWord;
+  cache->options.capitalizationMode = capitalizationMode;
+}
+
+static int
+contractTextWithCommand (BrailleContractionData *bcd) {
+  LockDescriptor *lock = bcd->table->commandLock;
+  int contracted;
+
+  /* There's only one external process per table, so its pipes are shared. */
+  if (lock) obtainExclusiveLock(lock);
+  contracted = contractTextExternally(bcd);
+  if (lock) releaseLock(lock);
+
+  return contracted;
+}
+
+void
+contractTextWithCache (
   ContractionTable *contractionTable,
+  ContractionCache *contractionCache,
   const wchar_t *inputBuffer, int *inputLength,
   BYTE *outputBuffer, int *outputLength,
   int *offsetsMap, const int cursorOffset
 ) {
   BrailleContractionData bcd = {
     .table = contractionTable,
+    .cache = contractionCache,
 
     .input = {
       .begin = inputBuffer,
@@ -1800,22 +1822,28 @@ contractText (
     }
   };
 
+  if (bcd.cache->table != bcd.table) {
+    /* the character entries point to the rules of the table they came from */
+    clearContractionCache(bcd.cache);
+    bcd.cache->table = bcd.table;
+  }
+
   if (checkCache(&bcd)) {
-    bcd.input.current = bcd.input.begin + bcd.table->cache.input.consumed;
+    bcd.input.current = bcd.input.begin + bcd.cache->translation.input.consumed;
 
     if (bcd.input.offsets) {
-      memcpy(bcd.input.offsets, bcd.table->cache.offsets.array,
-             ARRAY_SIZE(bcd.input.offsets, bcd.table->cache.offsets.count));
+      memcpy(bcd.input.offsets, bcd.cache->translation.offsets.array,
+             ARRAY_SIZE(bcd.input.offsets, bcd.cache->translation.offsets.count));
     }
 
-    bcd.output.current = bcd.output.begin + bcd.table->cache.output.count;
-    memcpy(bcd.output.begin, bcd.table->cache.output.cells,
-           ARRAY_SIZE(bcd.output.begin, bcd.table->cache.output.count));
+    bcd.output.current = bcd.output.begin + bcd.cache->translation.output.count;
+    memcpy(bcd.output.begin, bcd.cache->translation.output.cells,
+           ARRAY_SIZE(bcd.output.begin, bcd.cache->translation.output.count));
   } else {
     int contracted;
 
     {
-      int (*const contract) (BrailleContractionData *bcd) = bcd.table->command? contractTextExternally: contractTextInternally;
+      int (*const contract) (BrailleContractionData *bcd) = bcd.table->command? contractTextWithCommand: contractTextInternally;
       const size_t size = getInputCount(&bcd);
       wchar_t buffer[size];
       unsigned int map[size + 1];
@@ -1908,3 +1936,19 @@ contractText (
   *inputLength = getInputConsumed(&bcd);
   *outputLength = getOutputConsumed(&bcd);
 }
+
+void
+contractText (
+  ContractionTable *contractionTable,
+  const wchar_t *inputBuffer, int *inputLength,
+  BYTE *outputBuffer, int *outputLength,
+  int *offsetsMap, const int cursorOffset
+) {
+  ContractionCache *cache = &contractionTable->cache;
+
+  setContractionOptions(cache, prefs.expandCurrentWord, prefs.capitalizationMode);
+  contractTextWithCache(contractionTable, cache,
+                        inputBuffer, inputLength,
+                        outputBuffer, outputLength,
+                        offsetsMap, cursorOffset);
+}
@@ -99,6 +99,16 @@ reportDataError (DataFile *file, char *format, ...) {
   logMessage(LOG_WARNING, "%s", message);
 }
 
+const char *
+getDataFileName (DataFile *file) {
+  return file->name;
+}
+
+int
+getDataFileLine (DataFile *file) {
+  return file->line;
+}
+
 int
 compareKeyword (const wchar_t *keyword, const wchar_t *characters, size_t count) {
   while (count > 0) {
@@ -129,6 +129,7 @@ extern "C" {
 #define DEFAULT_AUTOSPEAK_DELETED_CHARACTERS 1
 #define DEFAULT_AUTOSPEAK_REPLACED_CHARACTERS 1
 #define DEFAULT_AUTOSPEAK_COMPLETED_WORDS 1
+#define DEFAULT_AUTOSPEAK_REGION arLine
 
 #define DEFAULT_SHOW_SPEECH_CURSOR 0
 #define DEFAULT_SPEECH_CURSOR_STYLE csLowerRightDot
@@ -0,0 +1,231 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2017 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+/* This is the O(ND) difference algorithm described by Eugene W. Myers in
+ * "An O(ND) Difference Algorithm and Its Variations" (Algorithmica, 1986).
+ * The furthest reaching path on each diagonal is recorded for every edit
+ * distance so that the edit script can be recovered by walking backward.
+ */
+
+#include "prologue.h"
+
+#include <string.h>
+
+#include "log.h"
+#include "diff.h"
+
+typedef struct {
+  DifferenceItemTester *isSameItem;
+  void *data;
+
+  unsigned int oldFirst;
+  unsigned int newFirst;
+  int oldCount;
+  int newCount;
+
+  int maximumEdits;
+  int *trace;
+
+  DifferenceSpan *spans;
+  unsigned int spanCount;
+} DifferenceData;
+
+static inline int
+isSameItem (DifferenceData *dd, int oldIndex, int newIndex) {
+  return dd->isSameItem(dd->oldFirst+oldIndex, dd->newFirst+newIndex, dd->data);
+}
+
+static inline int *
+getTraceRow (DifferenceData *dd, int edits) {
+  /* Diagonal k of a row is at index (k + maximumEdits + 1). */
+  return &dd->trace[edits * ((dd->maximumEdits * 2) + 3)];
+}
+
+static int
+findEditCount (DifferenceData *dd) {
+  int origin = dd->maximumEdits + 1;
+  int *previous = getTraceRow(dd, 0);
+
+  previous[origin+1] = 0;
+
+  for (int edits=0; edits<=dd->maximumEdits; edits+=1) {
+    int *row = getTraceRow(dd, edits);
+
+    for (int diagonal=-edits; diagonal<=edits; diagonal+=2) {
+      int oldIndex;
+
+      if ((diagonal == -edits) ||
+          ((diagonal != edits) &&
+           (previous[origin+diagonal-1] < previous[origin+diagonal+1]))) {
+        oldIndex = previous[origin+diagonal+1];
+      } else {
+        oldIndex = previous[origin+diagonal-1] + 1;
+      }
+
+      {
+        int newIndex = oldIndex - diagonal;
+
+        while ((oldIndex < dd->oldCount) && (newIndex < dd->newCount) &&
+               isSameItem(dd, oldIndex, newIndex)) {
+          oldIndex += 1;
+          newIndex += 1;
+        }
+
+        row[origin+diagonal] = oldIndex;
+
+        if ((oldIndex >= dd->oldCount) && (newIndex >= dd->newCount)) {
+          return edits;
+        }
+      }
+    }
+
+    previous = row;
+  }
+
+  return -1;
+}
+
+static void
+addEdit (DifferenceData *dd, int oldIndex, int newIndex, int isInsertion) {
+  unsigned int oldOffset = dd->oldFirst + oldIndex;
+  unsigned int newOffset = dd->newFirst + newIndex;
+
+  if (dd->spanCount) {
+    DifferenceSpan *span = &dd->spans[dd->spanCount - 1];
+
+    if (isInsertion) {
+      if ((span->oldOffset == oldOffset) && (span->newOffset == (newOffset + 1))) {
+        span->newOffset = newOffset;
+        span->newCount += 1;
+        return;
+      }
+    } else {
+      if ((span->oldOffset == (oldOffset + 1)) && (span->newOffset == newOffset)) {
+        span->oldOffset = oldOffset;
+        span->oldCount += 1;
+        return;
+      }
+    }
+  }
+
+  {
+    DifferenceSpan *span = &dd->spans[dd->spanCount++];
+
+    span->oldOffset = oldOffset;
+    span->newOffset = newOffset;
+    span->oldCount = isInsertion? 0: 1;
+    span->newCount = isInsertion? 1: 0;
+  }
+}
+
+static void
+findEdits (DifferenceData *dd, int edits) {
+  int origin = dd->maximumEdits + 1;
+  int oldIndex = dd->oldCount;
+  int newIndex = dd->newCount;
+
+  while (edits > 0) {
+    const int *previous = getTraceRow(dd, edits-1);
+    int diagonal = oldIndex - newIndex;
+    int isInsertion;
+
+    if ((diagonal == -edits) ||
+        ((diagonal != edits) &&
+         (previous[origin+diagonal-1] < previous[origin+diagonal+1]))) {
+      diagonal += 1;
+      isInsertion = 1;
+    } else {
+      diagonal -= 1;
+      isInsertion = 0;
+    }
+
+    oldIndex = previous[origin+diagonal];
+    newIndex = oldIndex - diagonal;
+    addEdit(dd, oldIndex, newIndex, isInsertion);
+
+    edits -= 1;
+  }
+}
+
+int
+findDifferences (
+  unsigned int oldCount, unsigned int newCount,
+  DifferenceItemTester *isSameItem, unsigned int maximumEdits,
+  DifferenceSpanHandler *handleSpan, void *data
+) {
+  DifferenceData dd = {
+    .isSameItem = isSameItem,
+    .data = data,
+
+    .oldFirst = 0,
+    .newFirst = 0,
+  };
+
+  while ((oldCount > 0) && (newCount > 0) &&
+         isSameItem(dd.oldFirst, dd.newFirst, data)) {
+    dd.oldFirst += 1;
+    dd.newFirst += 1;
+    oldCount -= 1;
+    newCount -= 1;
+  }
+
+  while ((oldCount > 0) && (newCount > 0) &&
+         isSameItem(dd.oldFirst+oldCount-1, dd.newFirst+newCount-1, data)) {
+    oldCount -= 1;
+    newCount -= 1;
+  }
+
+  if (!(oldCount || newCount)) return 1;
+
+  if (maximumEdits > (oldCount + newCount)) maximumEdits = oldCount + newCount;
+  dd.oldCount = oldCount;
+  dd.newCount = newCount;
+  dd.maximumEdits = maximumEdits;
+
+  {
+    int ok = 0;
+    size_t traceSize = ARRAY_SIZE(dd.trace, (maximumEdits + 1) * ((maximumEdits * 2) + 3));
+
+    if ((dd.trace = malloc(traceSize))) {
+      int edits = findEditCount(&dd);
+
+      if (edits >= 0) {
+        if ((dd.spans = malloc(ARRAY_SIZE(dd.spans, edits)))) {
+          dd.spanCount = 0;
+          findEdits(&dd, edits);
+          ok = 1;
+
+          /* The spans were found from the end backward. */
+          while (dd.spanCount > 0) {
+            if (!handleSpan(&dd.spans[--dd.spanCount], data)) break;
+          }
+
+          free(dd.spans);
+        } else {
+          logMallocError();
+        }
+      }
+
+      free(dd.trace);
+    } else {
+      logMallocError();
+    }
+
+    return ok;
+  }
+}
@@ -22,8 +22,11 @@
 #include <errno.h>
 
 #include "log.h"
+#include "parameters.h"
+#include "strfmt.h"
 #include "async_wait.h"
 #include "async_alarm.h"
+#include "timing.h"
 #include "io_generic.h"
 #include "gio_internal.h"
 #include "io_serial.h"
@@ -47,6 +50,11 @@ gioInitializeOptions (GioOptions *options) {
 
 void
 gioInitializeDescriptor (GioDescriptor *descriptor) {
+  descriptor->null.parameters = NULL;
+  descriptor->null.bytesPerSecond = 0;
+  descriptor->null.input = NULL;
+  descriptor->null.inputSize = 0;
+  descriptor->null.inputChunk = 0;
   gioInitializeOptions(&descriptor->null.options);
 
   descriptor->serial.parameters = NULL;
@@ -79,6 +87,9 @@ gioInitializeSerialParameters (SerialParameters *parameters) {
 void
 gioSetBytesPerSecond (GioEndpoint *endpoint, const SerialParameters *parameters) {
   endpoint->bytesPerSecond = parameters->baud / serialGetCharacterSize(parameters);
+
+  /* a baud rate is a ceiling - the link can't move data any faster */
+  endpoint->pacing.minimum = 100;
 }
 
 static int
@@ -143,6 +154,15 @@ gioConnectResource (
       endpoint->hidReportItems.address = NULL;
       endpoint->hidReportItems.size = 0;
 
+      memset(&endpoint->statistics, 0, sizeof(endpoint->statistics));
+
+      endpoint->pacing.deadline.seconds = 0;
+      endpoint->pacing.deadline.nanoseconds = 0;
+      endpoint->pacing.scale = 100;
+      endpoint->pacing.minimum = GIO_WRITE_PACING_SCALE_MINIMUM;
+      endpoint->pacing.delay = 0;
+      endpoint->pacing.size = 0;
+
       if (class->getOptions) {
         endpoint->options = *class->getOptions(descriptor);
       } else {
@@ -195,6 +215,7 @@ gioDisconnectResource (GioEndpoint *endpoint) {
     ok = 1;
   }
 
+  gioLogStatistics(endpoint);
   if (endpoint->hidReportItems.address) free(endpoint->hidReportItems.address);
   free(endpoint);
   return ok;
@@ -219,6 +240,73 @@ gioGetResourceName (GioEndpoint *endpoint) {
   return name;
 }
 
+static void
+gioCountLatency (unsigned long int *buckets, long int milliseconds) {
+  unsigned int bucket = 0;
+
+  while ((bucket < (GIO_LATENCY_BUCKETS - 1)) && (milliseconds >= (1 << bucket))) {
+    bucket += 1;
+  }
+
+  buckets[bucket] += 1;
+}
+
+static unsigned int
+gioGetPacedTransferTime (GioEndpoint *endpoint, size_t bytes) {
+  return (gioGetMillisecondsToTransfer(endpoint, bytes) * endpoint->pacing.scale) / 100;
+}
+
+static void
+gioAdaptPacing (GioEndpoint *endpoint, long int observed, size_t bytes) {
+  unsigned int nominal = gioGetMillisecondsToTransfer(endpoint, bytes);
+
+  if (nominal) {
+    unsigned int scale = (observed * 100) / nominal;
+
+    if (scale < endpoint->pacing.minimum) {
+      scale = endpoint->pacing.minimum;
+    } else if (scale > GIO_WRITE_PACING_SCALE_MAXIMUM) {
+      scale = GIO_WRITE_PACING_SCALE_MAXIMUM;
+    }
+
+    endpoint->pacing.scale = ((endpoint->pacing.scale * 3) + scale) / 4;
+  }
+}
+
+static void
+gioPaceOutput (GioEndpoint *endpoint, const TimeValue *start, long int duration, size_t bytes) {
+  unsigned int transfer = gioGetPacedTransferTime(endpoint, bytes);
+
+  endpoint->pacing.delay = 0;
+  endpoint->pacing.size += bytes;
+
+  if (transfer) {
+    TimeValue now;
+    long int pending;
+    long int remaining;
+
+    getMonotonicTime(&now);
+    pending = millisecondsBetween(&now, &endpoint->pacing.deadline);
+    if (pending < 0) pending = 0;
+
+    if (duration > transfer) {
+      /* the write blocked for longer than the link should have needed */
+      gioAdaptPacing(endpoint, duration, bytes);
+      transfer = gioGetPacedTransferTime(endpoint, bytes);
+    } else if (!pending && (endpoint->pacing.scale > 100)) {
+      endpoint->pacing.scale = ((endpoint->pacing.scale * 7) + 100) / 8;
+    }
+
+    if (compareTimeValues(start, &endpoint->pacing.deadline) > 0) {
+      endpoint->pacing.deadline = *start;
+    }
+
+    adjustTimeValue(&endpoint->pacing.deadline, transfer);
+    remaining = millisecondsBetween(&now, &endpoint->pacing.deadline);
+    if (remaining > pending) endpoint->pacing.delay = remaining - pending;
+  }
+}
+
 ssize_t
 gioWriteData (GioEndpoint *endpoint, const void *data, size_t size) {
   GioWriteDataMethod *method = endpoint->methods->writeData;
@@ -228,8 +316,44 @@ gioWriteData (GioEndpoint *endpoint, const void *data, size_t size) {
     return -1;
   }
 
-  return method(endpoint->handle, data, size,
-                endpoint->options.outputTimeout);
+  {
+    TimeValue start;
+    ssize_t result;
+
+    getMonotonicTime(&start);
+    result = method(endpoint->handle, data, size,
+                    endpoint->options.outputTimeout);
+
+    if (result > 0) {
+      long int duration = getMonotonicElapsed(&start);
+
+      endpoint->statistics.bytesWritten += result;
+      gioCountLatency(endpoint->statistics.writeLatency, duration);
+      gioPaceOutput(endpoint, &start, duration, result);
+    }
+
+    return result;
+  }
+}
+
+static ssize_t
+gioReadInput (GioEndpoint *endpoint, GioReadDataMethod *method, void *buffer, size_t size, int wait) {
+  int timeout = wait? endpoint->options.inputTimeout: 0;
+  TimeValue start;
+  ssize_t result;
+
+  getMonotonicTime(&start);
+  result = method(endpoint->handle, buffer, size, timeout, 0);
+
+  if (result > 0) {
+    endpoint->statistics.bytesRead += result;
+    gioCountLatency(endpoint->statistics.readLatency, getMonotonicElapsed(&start));
+    logBytes(LOG_CATEGORY(GENERIC_INPUT), NULL, buffer, result);
+  } else if (timeout && (!result || (errno == EAGAIN))) {
+    endpoint->statistics.readTimeouts += 1;
+  }
+
+  return result;
 }
 
 int
@@ -284,13 +408,12 @@ gioReadData (GioEndpoint *endpoint, void *buffer, size_t size, int wait) {
       }
 
       {
-        ssize_t result = method(endpoint->handle,
-                                &endpoint->input.buffer[endpoint->input.to],
-                                sizeof(endpoint->input.buffer) - endpoint->input.to,
-                                (wait? endpoint->options.inputTimeout: 0), 0);
+        ssize_t result = gioReadInput(endpoint, method,
+                                      &endpoint->input.buffer[endpoint->input.to],
+                                      sizeof(endpoint->input.buffer) - endpoint->input.to,
+                                      wait);
 
         if (result > 0) {
-          logBytes(LOG_CATEGORY(GENERIC_INPUT), NULL, &endpoint->input.buffer[endpoint->input.to], result);
           endpoint->input.to += result;
           wait = 1;
         } else {
@@ -314,6 +437,47 @@ gioReadByte (GioEndpoint *endpoint, unsigned char *byte, int wait) {
   return 0;
 }
 
+ssize_t
+gioPeekInput (GioEndpoint *endpoint, const unsigned char **bytes, int wait) {
+  if (endpoint->input.to == endpoint->input.from) {
+    GioReadDataMethod *method = endpoint->methods->readData;
+
+    if (!method) {
+      logUnsupportedOperation("readData");
+      return -1;
+    }
+
+    endpoint->input.from = endpoint->input.to = 0;
+
+    if (endpoint->input.error) {
+      errno = endpoint->input.error;
+      endpoint->input.error = 0;
+      return -1;
+    }
+
+    {
+      ssize_t result = gioReadInput(endpoint, method,
+                                    endpoint->input.buffer, sizeof(endpoint->input.buffer),
+                                    wait);
+
+      if (result > 0) {
+        endpoint->input.to = result;
+      } else {
+        if (!result) errno = EAGAIN;
+        return -1;
+      }
+    }
+  }
+
+  *bytes = &endpoint->input.buffer[endpoint->input.from];
+  return endpoint->input.to - endpoint->input.from;
+}
+
+void
+gioConsumeInput (GioEndpoint *endpoint, size_t count) {
+  endpoint->input.from += MIN(count, (endpoint->input.to - endpoint->input.from));
+}
+
 int
 gioDiscardInput (GioEndpoint *endpoint) {
   unsigned char byte;
@@ -350,6 +514,80 @@ gioGetMillisecondsToTransfer (GioEndpoint *endpoint, size_t bytes) {
   return endpoint->bytesPerSecond? (((bytes * 1000) / endpoint->bytesPerSecond) + 1): 0;
 }
 
+unsigned int
+gioGetWritePacingDelay (GioEndpoint *endpoint) {
+  return endpoint->pacing.delay;
+}
+
+static void
+gioLogLatency (const char *label, const unsigned long int *buckets) {
+  char buffer[0X100];
+  STR_BEGIN(buffer, sizeof(buffer));
+  unsigned int bucket;
+
+  for (bucket=0; bucket<GIO_LATENCY_BUCKETS; bucket+=1) {
+    STR_PRINTF(" %s%ums:%lu",
+               ((bucket < (GIO_LATENCY_BUCKETS - 1))? "<": ">="),
+               (1 << ((bucket < (GIO_LATENCY_BUCKETS - 1))? bucket: (bucket - 1))),
+               buckets[bucket]);
+  }
+
+  STR_END;
+  logMessage(LOG_DEBUG, "%s latency:%s", label, buffer);
+}
+
+void
+gioLogStatistics (GioEndpoint *endpoint) {
+  const GioStatistics *statistics = &endpoint->statistics;
+
+  logMessage(LOG_DEBUG,
+             "generic I/O statistics: read: %lu bytes, %lu packets, %lu timeouts; written: %lu bytes, %lu packets, %u%% pacing; retries: %lu; acknowledgements: %lu (%lu missing)",
+             statistics->bytesRead, statistics->packetsRead, statistics->readTimeouts,
+             statistics->bytesWritten, statistics->packetsWritten, endpoint->pacing.scale,
+             statistics->retries,
+             statistics->acknowledgements, statistics->missingAcknowledgements);
+
+  gioLogLatency("read", statistics->readLatency);
+  gioLogLatency("write", statistics->writeLatency);
+  gioLogLatency("acknowledgement", statistics->acknowledgementLatency);
+}
+
+void
+gioCountInputPacket (GioEndpoint *endpoint) {
+  endpoint->statistics.packetsRead += 1;
+}
+
+void
+gioCountOutputPacket (GioEndpoint *endpoint) {
+  endpoint->statistics.packetsWritten += 1;
+}
+
+void
+gioCountRetry (GioEndpoint *endpoint) {
+  endpoint->statistics.retries += 1;
+}
+
+void
+gioCountAcknowledgement (GioEndpoint *endpoint, long int milliseconds) {
+  endpoint->statistics.acknowledgements += 1;
+  gioCountLatency(endpoint->statistics.acknowledgementLatency, milliseconds);
+
+  if (milliseconds < gioGetPacedTransferTime(endpoint, endpoint->pacing.size)) {
+    /* the display received the whole message sooner than expected */
+    gioAdaptPacing(endpoint, milliseconds, endpoint->pacing.size);
+  }
+
+  endpoint->pacing.size = 0;
+}
+
+void
+gioCountMissingAcknowledgement (GioEndpoint *endpoint) {
+  endpoint->statistics.missingAcknowledgements += 1;
+
+  endpoint->pacing.scale = MIN((endpoint->pacing.scale * 2), GIO_WRITE_PACING_SCALE_MAXIMUM);
+  endpoint->pacing.size = 0;
+}
+
 ssize_t
 gioTellResource (
   GioEndpoint *endpoint,
@@ -120,6 +120,15 @@ struct GioEndpointStruct {
   GioResourceType resourceType;
   unsigned int bytesPerSecond;
   GioHidReportItemsData hidReportItems;
+  GioStatistics statistics;
+
+  struct {
+    TimeValue deadline;
+    unsigned int scale;
+    unsigned int minimum;
+    unsigned int delay;
+    size_t size; /* written since the last acknowledgement */
+  } pacing;
 
   struct {
     int error;
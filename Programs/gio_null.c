@@ -21,12 +21,29 @@
 #include <string.h>
 
 #include "log.h"
+#include "timing.h"
 #include "io_generic.h"
 #include "gio_internal.h"
 #include "device.h"
 
+/* When a link speed is given, written data drains at that rate through a
+ * buffer of this size, and a write blocks until what it adds fits.
+ */
+#define NULL_LINK_BUFFER_SIZE 0X20
+
 struct GioHandleStruct {
-  int place_holder;
+  unsigned int bytesPerSecond;
+  TimeValue drained;
+
+  unsigned hasParameters:1;
+  SerialParameters parameters;
+
+  struct {
+    const unsigned char *bytes;
+    size_t size;
+    size_t chunk;
+    size_t offset;
+  } input;
 };
 
 static int
@@ -35,6 +52,27 @@ disconnectNullResource (GioHandle *handle) {
   return 1;
 }
 
+static ssize_t
+writeNullData (GioHandle *handle, const void *data, size_t size, int timeout) {
+  unsigned int rate = handle->bytesPerSecond;
+
+  if (rate) {
+    long int buffered = (NULL_LINK_BUFFER_SIZE * 1000) / rate;
+    long int transfer = ((size * 1000) + (rate / 2)) / rate;
+    long int backlog;
+    TimeValue now;
+
+    getMonotonicTime(&now);
+    if (compareTimeValues(&now, &handle->drained) > 0) handle->drained = now;
+    backlog = millisecondsBetween(&now, &handle->drained);
+
+    if ((backlog + transfer) > buffered) approximateDelay(backlog + transfer - buffered);
+    adjustTimeValue(&handle->drained, transfer);
+  }
+
+  return size;
+}
+
 static int
 awaitNullInput (GioHandle *handle, int timeout) {
   return 1;
@@ -45,7 +83,20 @@ readNullData (
   GioHandle *handle, void *buffer, size_t size,
   int initialTimeout, int subsequentTimeout
 ) {
-  return 0;
+  size_t count = handle->input.size - handle->input.offset;
+
+  if (count > size) count = size;
+  if (handle->input.chunk && (count > handle->input.chunk)) count = handle->input.chunk;
+
+  if (count) {
+    memcpy(buffer, &handle->input.bytes[handle->input.offset], count);
+    handle->input.offset += count;
+  } else if (initialTimeout) {
+    /* like a quiet link, wait out the timeout once there's nothing left */
+    approximateDelay(initialTimeout);
+  }
+
+  return count;
 }
 
 static int
@@ -56,6 +107,7 @@ monitorNullInput (GioHandle *handle, AsyncMonitorCallback *callback, void *data)
 static const GioMethods gioNullMethods = {
   .disconnectResource = disconnectNullResource,
 
+  .writeData = writeNullData,
   .awaitInput = awaitNullInput,
   .readData = readNullData,
 
@@ -91,6 +143,18 @@ connectNullResource (
 
   if (handle) {
     memset(handle, 0, sizeof(*handle));
+    handle->bytesPerSecond = descriptor->null.bytesPerSecond;
+
+    if (descriptor->null.parameters) {
+      handle->parameters = *descriptor->null.parameters;
+      handle->hasParameters = 1;
+    }
+
+    if (descriptor->null.input) {
+      handle->input.bytes = descriptor->null.input;
+      handle->input.size = descriptor->null.inputSize;
+      handle->input.chunk = descriptor->null.inputChunk;
+    }
 
     return handle;
   } else {
@@ -100,6 +164,14 @@ connectNullResource (
   return NULL;
 }
 
+static int
+prepareNullEndpoint (GioEndpoint *endpoint) {
+  GioHandle *handle = endpoint->handle;
+
+  if (handle->hasParameters) gioSetBytesPerSecond(endpoint, &handle->parameters);
+  return 1;
+}
+
 const GioClass gioNullClass = {
   .isSupported = isNullSupported,
   .testIdentifier = testNullIdentifier,
@@ -108,6 +180,7 @@ const GioClass gioNullClass = {
   .getMethods = getNullMethods,
 
   .connectResource = connectNullResource,
+  .prepareEndpoint = prepareNullEndpoint,
 
   .resourceType = GIO_RESOURCE_NULL
 };
@@ -519,42 +519,62 @@ ASYNC_INPUT_CALLBACK(handleLinuxKeyboardEvent) {
                label, kio->kix->file.descriptor);
     destroyKeyboardInstanceObject(kio);
   } else {
-    const struct input_event *event = parameters->buffer;
+    const struct input_event *const events = parameters->buffer;
+    const struct input_event *event = events;
+    const struct input_event *const end = events + (parameters->length / sizeof(*event));
+
+    if (event < end) {
+      UinputObject *uinput = kio->kix->uinput;
+
+      /* Evdev hands over whole SYN_REPORT frames, and a read returns as many
+       * of them as fit, so a burst is handled in one callback and whatever
+       * isn't bound is forwarded with a single write.
+       */
+      beginUinputBatch(uinput);
+
+      do {
+        switch (event->type) {
+          case EV_KEY: {
+            int release = event->value == 0;
+            int press   = event->value == 1;
+
+            if (release || press) {
+              /* A bound key may run a command right away, so whatever has
+               * already been passed through must reach the system first.
+               */
+              if (kio->kmo->isActive) flushUinputBatch(uinput);
+              handleKeyEvent(kio, event->code, press);
+            }
 
-    if (parameters->length >= sizeof(*event)) {
-      switch (event->type) {
-        case EV_KEY: {
-          int release = event->value == 0;
-          int press   = event->value == 1;
+            break;
+          }
 
-          if (release || press) handleKeyEvent(kio, event->code, press);
-          break;
-        }
+          case EV_REP: {
+            switch (event->code) {
+              case REP_DELAY: {
+                writeRepeatDelay(uinput, event->value);
+                break;
+              }
 
-        case EV_REP: {
-          switch (event->code) {
-            case REP_DELAY: {
-              writeRepeatDelay(kio->kix->uinput, event->value);
-              break;
-            }
+              case REP_PERIOD: {
+                writeRepeatPeriod(uinput, event->value);
+                break;
+              }
 
-            case REP_PERIOD: {
-              writeRepeatPeriod(kio->kix->uinput, event->value);
-              break;
+              default:
+                break;
             }
 
-            default:
-              break;
+            break;
           }
 
-          break;
+          default:
+            break;
         }
+      } while (++event < end);
 
-        default:
-          break;
-      }
-
-      return sizeof(*event);
+      endUinputBatch(uinput);
+      return (event - events) * sizeof(*event);
     }
   }
 
@@ -722,7 +742,8 @@ monitorKeyboard (KeyboardInstanceObject *kio) {
               if ((kio->kix->uinput = newUinputInstance(kio->kix->device.path))) {
                 if (prepareUinputInstance(kio->kix->uinput, kio->kix->file.descriptor)) {
                   if (asyncReadFile(&kio->kix->file.monitor,
-                                    kio->kix->file.descriptor, sizeof(struct input_event),
+                                    kio->kix->file.descriptor,
+                                    (sizeof(struct input_event) * LINUX_INPUT_EVENT_READ_COUNT),
                                     handleLinuxKeyboardEvent, kio)) {
                     logMessage(LOG_DEBUG, "keyboard opened: %s: fd=%d",
                                kio->kix->device.path, kio->kix->file.descriptor);
@@ -917,7 +938,7 @@ getKobjectUeventSocket (void) {
   if (socketDescriptor == -1) {
     const struct sockaddr_nl socketAddress = {
       .nl_family = AF_NETLINK,
-      .nl_pid = getpid(),
+      .nl_pid = 0, /* let the kernel choose - the USB monitor has one too */
       .nl_groups = 0XFFFFFFFF
     };
 
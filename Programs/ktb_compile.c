@@ -189,6 +189,10 @@ getKeyContext (KeyTableData *ktd, unsigned char context) {
       ctx->keyBindings.size = 0;
       ctx->keyBindings.count = 0;
       ctx->keyBindings.sorted = NULL;
+      ctx->keyBindings.hash.table = NULL;
+      ctx->keyBindings.hash.size = 0;
+      BITMASK_ZERO(ctx->keyBindings.anyModifierGroups);
+      BITMASK_ZERO(ctx->keyBindings.anyImmediateGroups);
 
       ctx->hotkeys.table = NULL;
       ctx->hotkeys.count = 0;
@@ -1213,7 +1217,7 @@ resetKeyTable (KeyTable *table) {
   table->context.current = table->context.next = table->context.persistent = KTB_CTX_DEFAULT;
 }
 
-static int
+int
 compareKeyCombinations (const KeyCombination *combination1, const KeyCombination *combination2) {
   if (combination1->flags & KCF_IMMEDIATE_KEY) {
     if (combination2->flags & KCF_IMMEDIATE_KEY) {
@@ -1235,6 +1239,35 @@ compareKeyBindings (const KeyBinding *binding1, const KeyBinding *binding2) {
   return compareKeyCombinations(&binding1->keyCombination, &binding2->keyCombination);
 }
 
+unsigned int
+hashKeyCombination (const KeyCombination *combination) {
+  unsigned int hash = 2166136261U;
+
+#define HASH_BYTE(byte) (hash = (hash ^ (byte)) * 16777619U)
+  HASH_BYTE(combination->modifierCount);
+
+  {
+    const KeyValue *modifier = combination->modifierKeys;
+    const KeyValue *end = modifier + combination->modifierCount;
+
+    while (modifier < end) {
+      HASH_BYTE(modifier->group);
+      HASH_BYTE(modifier->number);
+      modifier += 1;
+    }
+  }
+
+  if (combination->flags & KCF_IMMEDIATE_KEY) {
+    HASH_BYTE(combination->immediateKey.group);
+    HASH_BYTE(combination->immediateKey.number);
+  } else {
+    HASH_BYTE(KTB_KEY_ANY);
+  }
+#undef HASH_BYTE
+
+  return hash;
+}
+
 static int
 sortKeyBindings (const void *element1, const void *element2) {
   const KeyBinding *const *binding1 = element1;
@@ -1381,6 +1414,56 @@ done:
   return ok;
 }
 
+static int
+hashKeyBindings (KeyContext *ctx) {
+  unsigned int size = 0X10;
+
+  while (size < (ctx->keyBindings.count * 2)) size <<= 1;
+
+  if (!(ctx->keyBindings.hash.table = calloc(size, sizeof(*ctx->keyBindings.hash.table)))) {
+    logMallocError();
+    return 0;
+  }
+
+  ctx->keyBindings.hash.size = size;
+
+  {
+    const KeyBinding *const *binding = ctx->keyBindings.sorted;
+    const KeyBinding *const *end = binding + ctx->keyBindings.count;
+
+    while (binding < end) {
+      const KeyCombination *combination = &(*binding)->keyCombination;
+      unsigned int index = hashKeyCombination(combination) & (size - 1);
+
+      while (ctx->keyBindings.hash.table[index]) index = (index + 1) & (size - 1);
+      ctx->keyBindings.hash.table[index] = *binding;
+
+      {
+        const KeyValue *modifier = combination->modifierKeys;
+        const KeyValue *last = modifier + combination->modifierCount;
+
+        while (modifier < last) {
+          if (modifier->number == KTB_KEY_ANY) {
+            BITMASK_SET(ctx->keyBindings.anyModifierGroups, modifier->group);
+          }
+
+          modifier += 1;
+        }
+      }
+
+      if (combination->flags & KCF_IMMEDIATE_KEY) {
+        if (combination->immediateKey.number == KTB_KEY_ANY) {
+          BITMASK_SET(ctx->keyBindings.anyImmediateGroups, combination->immediateKey.group);
+        }
+      }
+
+      binding += 1;
+    }
+  }
+
+  return 1;
+}
+
 static int
 prepareKeyBindings (KeyContext *ctx) {
   if (!addIncompleteBindings(ctx)) return 0;
@@ -1421,6 +1504,7 @@ prepareKeyBindings (KeyContext *ctx) {
     }
 
     qsort(ctx->keyBindings.sorted, ctx->keyBindings.count, sizeof(*ctx->keyBindings.sorted), sortKeyBindings);
+    if (!hashKeyBindings(ctx)) return 0;
   }
 
   return 1;
@@ -1644,6 +1728,7 @@ destroyKeyTable (KeyTable *table) {
 
     if (ctx->keyBindings.table) free(ctx->keyBindings.table);
     if (ctx->keyBindings.sorted) free(ctx->keyBindings.sorted);
+    if (ctx->keyBindings.hash.table) free(ctx->keyBindings.hash.table);
 
     if (ctx->hotkeys.table) free(ctx->hotkeys.table);
     if (ctx->hotkeys.sorted) free(ctx->hotkeys.sorted);
@@ -22,6 +22,7 @@
 #include "strfmth.h"
 #include "cmd_types.h"
 #include "async.h"
+#include "bitmask.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -100,6 +101,14 @@ typedef struct {
     unsigned int size;
     unsigned int count;
     const KeyBinding **sorted;
+
+    struct {
+      const KeyBinding **table;
+      unsigned int size;
+    } hash;
+
+    BITMASK(anyModifierGroups, 0X100, char);
+    BITMASK(anyImmediateGroups, 0X100, char);
   } keyBindings;
 
   struct {
@@ -189,7 +198,9 @@ extern int insertKeyValue (
 extern void removeKeyValue (KeyValue *values, unsigned int *count, unsigned int position);
 extern int deleteKeyValue (KeyValue *values, unsigned int *count, const KeyValue *value);
 
+extern int compareKeyCombinations (const KeyCombination *combination1, const KeyCombination *combination2);
 extern int compareKeyBindings (const KeyBinding *binding1, const KeyBinding *binding2);
+extern unsigned int hashKeyCombination (const KeyCombination *combination);
 
 extern STR_DECLARE_FORMATTER(formatKeyName, KeyTable *table, const KeyValue *value);
 
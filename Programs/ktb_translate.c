@@ -87,66 +87,91 @@ setKeyAutoreleaseTime (KeyTable *table, unsigned char setting) {
   setAutoreleaseAlarm(table);
 }
 
-static int
-sortModifierKeys (const void *element1, const void *element2) {
-  const KeyValue *modifier1 = element1;
-  const KeyValue *modifier2 = element2;
-  return compareKeyValues(modifier1, modifier2);
-}
+static const KeyBinding *
+getKeyBinding (const KeyContext *ctx, const KeyCombination *combination) {
+  unsigned int mask = ctx->keyBindings.hash.size - 1;
+  unsigned int index = hashKeyCombination(combination) & mask;
+  const KeyBinding *binding;
+
+  while ((binding = ctx->keyBindings.hash.table[index])) {
+    if (compareKeyCombinations(combination, &binding->keyCombination) == 0) return binding;
+    index = (index + 1) & mask;
+  }
 
-static int
-searchKeyBinding (const void *target, const void *element) {
-  const KeyBinding *reference = target;
-  const KeyBinding *const *binding = element;
-  return compareKeyBindings(reference, *binding);
+  return NULL;
 }
 
 static const KeyBinding *
 findKeyBinding (KeyTable *table, unsigned char context, const KeyValue *immediate, int *isIncomplete) {
   const KeyContext *ctx = getKeyContext(table, context);
 
-  if (ctx && ctx->keyBindings.sorted &&
+  if (ctx && ctx->keyBindings.hash.table &&
       (table->pressedKeys.count <= MAX_MODIFIERS_PER_COMBINATION)) {
-    KeyBinding target;
+    unsigned int count = table->pressedKeys.count;
+    unsigned int wildcards = 0;
+    KeyCombination target;
+
     memset(&target, 0, sizeof(target));
+    target.modifierCount = count;
 
     if (immediate) {
-      target.keyCombination.immediateKey = *immediate;
-      target.keyCombination.flags |= KCF_IMMEDIATE_KEY;
+      target.immediateKey = *immediate;
+      target.flags |= KCF_IMMEDIATE_KEY;
+    }
+
+    /* Only pressed keys in a group which some binding matches with a
+     * wildcard can take part in a wildcard lookup - any other subset
+     * can't possibly be found so it needn't be tried.
+     */
+    {
+      unsigned int index;
+
+      for (index=0; index<count; index+=1) {
+        if (BITMASK_TEST(ctx->keyBindings.anyModifierGroups, table->pressedKeys.table[index].group)) {
+          wildcards |= 1 << index;
+        }
+      }
     }
-    target.keyCombination.modifierCount = table->pressedKeys.count;
 
     while (1) {
-      unsigned int all = (1 << table->pressedKeys.count) - 1;
-      unsigned int bits;
+      unsigned int bits = 0;
 
-      for (bits=0; bits<=all; bits+=1) {
+      do {
         {
           unsigned int index;
-          unsigned int bit;
 
-          for (index=0, bit=1; index<table->pressedKeys.count; index+=1, bit<<=1) {
-            KeyValue *modifier = &target.keyCombination.modifierKeys[index];
+          for (index=0; index<count; index+=1) {
+            KeyValue modifier = table->pressedKeys.table[index];
+            unsigned int position = index;
+
+            if (bits & (1 << index)) modifier.number = KTB_KEY_ANY;
 
-            *modifier = table->pressedKeys.table[index];
-            if (bits & bit) modifier->number = KTB_KEY_ANY;
+            while (position && (compareKeyValues(&modifier, &target.modifierKeys[position-1]) < 0)) {
+              target.modifierKeys[position] = target.modifierKeys[position-1];
+              position -= 1;
+            }
+
+            target.modifierKeys[position] = modifier;
           }
         }
-        qsort(target.keyCombination.modifierKeys, table->pressedKeys.count, sizeof(*target.keyCombination.modifierKeys), sortModifierKeys);
 
         {
-          const KeyBinding *const *binding = bsearch(&target, ctx->keyBindings.sorted, ctx->keyBindings.count, sizeof(*ctx->keyBindings.sorted), searchKeyBinding);
+          const KeyBinding *binding = getKeyBinding(ctx, &target);
 
           if (binding) {
-            if ((*binding)->primaryCommand.value != EOF) return *binding;
+            if (binding->primaryCommand.value != EOF) return binding;
             *isIncomplete = 1;
           }
         }
-      }
 
-      if (!(target.keyCombination.flags & KCF_IMMEDIATE_KEY)) break;
-      if (target.keyCombination.immediateKey.number == KTB_KEY_ANY) break;
-      target.keyCombination.immediateKey.number = KTB_KEY_ANY;
+        /* next subset of the wildcard positions in ascending order */
+        bits = (bits - wildcards) & wildcards;
+      } while (bits);
+
+      if (!(target.flags & KCF_IMMEDIATE_KEY)) break;
+      if (target.immediateKey.number == KTB_KEY_ANY) break;
+      if (!BITMASK_TEST(ctx->keyBindings.anyImmediateGroups, target.immediateKey.group)) break;
+      target.immediateKey.number = KTB_KEY_ANY;
     }
   }
 
@@ -1030,6 +1030,18 @@ makePreferencesMenu (void) {
       TEST(Autospeak);
     }
 
+    {
+      static const MenuString strings[] = {
+        {.label=strtext("Line")},
+        {.label=strtext("Window")},
+        {.label=strtext("Screen")}
+      };
+
+      NAME(strtext("Autospeak Region"));
+      ITEM(newEnumeratedMenuItem(speechSubmenu, &prefs.autospeakRegion, &itemName, strings));
+      TEST(Autospeak);
+    }
+
     {
       NAME(strtext("Show Speech Cursor"));
       ITEM(newBooleanMenuItem(speechSubmenu, &prefs.showSpeechCursor, &itemName));
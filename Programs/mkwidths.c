@@ -0,0 +1,237 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2017 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+/* This program generates unicode_widths.h - the two-stage character width
+ * table which is compiled into unicode.c - from the Unicode properties
+ * provided by ICU. It can also check the compiled-in table against them.
+ */
+
+#include "prologue.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "program.h"
+#include "options.h"
+#include "log.h"
+#include "unicode.h"
+
+#ifdef HAVE_ICU
+#include <unicode/uchar.h>
+#endif /* HAVE_ICU */
+
+static int opt_checkTable;
+
+BEGIN_OPTION_TABLE(programOptions)
+  { .letter = 'c',
+    .word = "check",
+    .setting.flag = &opt_checkTable,
+    .description = strtext("Check the compiled-in table rather than generating it.")
+  },
+END_OPTION_TABLE
+
+#ifdef HAVE_ICU
+#define WIDTH_LIMIT (UCHAR_MAX_VALUE + 1)
+#define WIDTH_BLOCK_SHIFT 7
+#define WIDTH_BLOCK_SIZE (1 << WIDTH_BLOCK_SHIFT)
+#define WIDTH_BLOCK_COUNT (WIDTH_LIMIT >> WIDTH_BLOCK_SHIFT)
+
+static int
+computeCharacterWidth (UChar32 character) {
+  UCharCategory category = u_getIntPropertyValue(character, UCHAR_GENERAL_CATEGORY);
+  UEastAsianWidth width = u_getIntPropertyValue(character, UCHAR_EAST_ASIAN_WIDTH);
+
+  if (character == 0) return 0;
+  if (category == U_CONTROL_CHAR) return -1;
+
+  if (category == U_NON_SPACING_MARK) return 0;
+  if (category == U_ENCLOSING_MARK) return 0;
+
+  /* Hangul Jamo medial vowels and final consonants */
+  if ((character >= 0X1160) && (character <= 0X11FF) && (category == U_OTHER_LETTER)) return 0;
+
+  /*  */
+  if (character == 0XAD) return 1; /* soft hyphen */
+  if (category == U_FORMAT_CHAR) return 0;
+
+  if (width == U_EA_FULLWIDTH) return 2;
+  if (width == U_EA_HALFWIDTH) return 1;
+
+  if (width == U_EA_WIDE) return 2;
+  if (width == U_EA_NARROW) return 1;
+
+  if (width == U_EA_AMBIGUOUS) {
+    /* CJK Unified Ideographs block */
+    if ((character >= 0X4E00) && (character <= 0X9FFF)) return 2;
+
+    /* CJK Unified Ideographs Externsion A block */
+    if ((character >= 0X3400) && (character <= 0X4DBF)) return 2;
+
+    /* CJK Compatibility Ideographs block */
+    if ((character >= 0XF900) && (character <= 0XFAFF)) return 2;
+
+    /* Supplementary Ideographic Plane */
+  //if ((character >= 0X20000) && (character <= 0X2FFFF)) return 2;
+
+    /* Tertiary Ideographic Plane */
+  //if ((character >= 0X30000) && (character <= 0X3FFFF)) return 2;
+  }
+
+  if (category == U_UNASSIGNED) return -1;
+  return 1;
+}
+
+static void
+getUnicodeVersion (char *buffer) {
+  UVersionInfo version;
+
+  u_getUnicodeVersion(version);
+  u_versionToString(version, buffer);
+}
+
+static ProgramExitStatus
+generateTable (void) {
+  static signed char blocks[WIDTH_BLOCK_COUNT][WIDTH_BLOCK_SIZE];
+  static unsigned int indexes[WIDTH_BLOCK_COUNT];
+  unsigned int blockCount = 0;
+
+  for (unsigned int block=0; block<WIDTH_BLOCK_COUNT; block+=1) {
+    signed char *widths = blocks[blockCount];
+    UChar32 first = block << WIDTH_BLOCK_SHIFT;
+    unsigned int index;
+
+    for (unsigned int offset=0; offset<WIDTH_BLOCK_SIZE; offset+=1) {
+      widths[offset] = computeCharacterWidth(first + offset);
+    }
+
+    for (index=0; index<blockCount; index+=1) {
+      if (memcmp(blocks[index], widths, WIDTH_BLOCK_SIZE) == 0) break;
+    }
+
+    if (index == blockCount) blockCount += 1;
+    indexes[block] = index;
+  }
+
+  if (blockCount > 0X100) {
+    logMessage(LOG_ERR, "too many character width blocks: %u", blockCount);
+    return PROG_EXIT_SEMANTIC;
+  }
+
+  {
+    char version[U_MAX_VERSION_STRING_LENGTH];
+    getUnicodeVersion(version);
+
+    printf("/* This file was generated by mkwidths (Unicode %s) - don't edit it.\n", version);
+    printf(" * Regenerate it with \"make unicode-widths\" in the Programs directory.\n");
+    printf(" */\n\n");
+
+    printf("#define CHARACTER_WIDTH_UNICODE_VERSION \"%s\"\n", version);
+  }
+
+  printf("#define CHARACTER_WIDTH_LIMIT 0X%X\n", WIDTH_LIMIT);
+  printf("#define CHARACTER_WIDTH_BLOCK_SHIFT %d\n", WIDTH_BLOCK_SHIFT);
+  printf("#define CHARACTER_WIDTH_BLOCK_MASK 0X%X\n\n", WIDTH_BLOCK_SIZE-1);
+
+  printf("static const unsigned char characterWidthIndexes[0X%X] = {", WIDTH_BLOCK_COUNT);
+  for (unsigned int block=0; block<WIDTH_BLOCK_COUNT; block+=1) {
+    printf("%s%3u,", ((block % 0X10)? " ": "\n  "), indexes[block]);
+  }
+  printf("\n};\n\n");
+
+  printf("static const signed char characterWidthBlocks[%u][0X%X] = {\n", blockCount, WIDTH_BLOCK_SIZE);
+  for (unsigned int index=0; index<blockCount; index+=1) {
+    printf("  { /* %u */", index);
+
+    for (unsigned int offset=0; offset<WIDTH_BLOCK_SIZE; offset+=1) {
+      printf("%s%2d,", ((offset % 0X20)? " ": "\n    "), blocks[index][offset]);
+    }
+
+    printf("\n  },\n");
+  }
+  printf("};\n");
+
+  if (ferror(stdout)) {
+    logMessage(LOG_ERR, "output error: %s", strerror(errno));
+    return PROG_EXIT_FATAL;
+  }
+
+  return PROG_EXIT_SUCCESS;
+}
+
+static ProgramExitStatus
+checkTable (void) {
+  unsigned int mismatches = 0;
+
+  {
+    char version[U_MAX_VERSION_STRING_LENGTH];
+    getUnicodeVersion(version);
+    logMessage(LOG_NOTICE, "checking character widths against Unicode %s", version);
+  }
+
+  for (UChar32 character=0; character<WIDTH_LIMIT; character+=1) {
+    int expected = computeCharacterWidth(character);
+    int actual = getCharacterWidth(character);
+
+    if (actual != expected) {
+      if (mismatches < 0X20) {
+        logMessage(LOG_WARNING, "character width mismatch: U+%04X: %d != %d",
+                   (unsigned int)character, actual, expected);
+      }
+
+      mismatches += 1;
+    }
+  }
+
+  if (mismatches) {
+    logMessage(LOG_ERR, "character width mismatches: %u (run \"make unicode-widths\")", mismatches);
+    return PROG_EXIT_SEMANTIC;
+  }
+
+  return PROG_EXIT_SUCCESS;
+}
+#endif /* HAVE_ICU */
+
+int
+main (int argc, char *argv[]) {
+  {
+    static const OptionsDescriptor descriptor = {
+      OPTION_TABLE(programOptions),
+      .applicationName = "mkwidths"
+    };
+
+    PROCESS_OPTIONS(descriptor, argc, argv);
+  }
+
+  if (argc) {
+    logMessage(LOG_ERR, "too many parameters");
+    return PROG_EXIT_SYNTAX;
+  }
+
+#ifdef HAVE_ICU
+  return opt_checkTable? checkTable(): generateTable();
+#else /* HAVE_ICU */
+  if (opt_checkTable) {
+    logMessage(LOG_NOTICE, "ICU not available - character widths not checked");
+    return PROG_EXIT_SUCCESS;
+  }
+
+  logMessage(LOG_ERR, "ICU not available - character widths can't be generated");
+  return PROG_EXIT_FATAL;
+#endif /* HAVE_ICU */
+}
@@ -23,11 +23,55 @@
 
 #include "prefs.h"
 #include "log.h"
+#include "program.h"
 #include "pcm.h"
 #include "notes.h"
 
 char *opt_pcmDevice;
 
+#define PCM_AMPLITUDE_BUFFER_SIZE 0X100
+#define PCM_TONE_CACHE_SIZE 8
+#define PCM_TONE_CACHE_LIMIT 0X10000
+#define PCM_TUNE_CACHE_SIZE 0X20
+#define PCM_TUNE_CACHE_LIMIT 0X40000
+
+typedef struct {
+  NoteFrequency frequency;
+  int32_t sampleCount;
+
+  unsigned char *frames;
+  size_t size;
+  unsigned long lastUsed;
+} PcmCachedTone;
+
+typedef struct {
+  ToneElement *elements;
+  unsigned int count;
+
+  unsigned char *frames;
+  size_t used;
+  size_t size;
+  unsigned long lastUsed;
+} PcmCachedTune;
+
+/* The rendered sounds outlive the device (which is closed whenever it's
+ * been idle for a while) but are only valid for the output format and
+ * the volume they were rendered for.
+ */
+static struct {
+  unsigned char initialized;
+
+  int blockSize;
+  int sampleRate;
+  int channelCount;
+  PcmAmplitudeFormat amplitudeFormat;
+  unsigned char volume;
+
+  unsigned long usageCounter;
+  PcmCachedTone tones[PCM_TONE_CACHE_SIZE];
+  PcmCachedTune tunes[PCM_TUNE_CACHE_SIZE];
+} pcmCache;
+
 struct NoteDeviceStruct {
   PcmDevice *pcm;
 
@@ -40,6 +84,8 @@ struct NoteDeviceStruct {
   int blockUsed;
 
   PcmSampleMaker makeSample;
+  PcmSampleSize sampleSize;
+  int frameSize;
 };
 
 static int
@@ -49,17 +95,14 @@ pcmFlushBytes (NoteDevice *device) {
   return ok;
 }
 
+static inline int
+pcmGetFramesLeft (NoteDevice *device) {
+  return (device->blockSize - device->blockUsed) / device->frameSize;
+}
+
 static int
-pcmWriteSample (NoteDevice *device, int16_t amplitude) {
-  PcmSample *sample = (PcmSample *)&device->blockAddress[device->blockUsed];
-  PcmSampleSize size = device->makeSample(sample, amplitude);
-  device->blockUsed += size;
-
-  for (int channel=1; channel<device->channelCount; channel+=1) {
-    for (int byte=0; byte<size; byte+=1) {
-      device->blockAddress[device->blockUsed++] = sample->bytes[byte];
-    }
-  }
+pcmCommitFrames (NoteDevice *device, int count) {
+  device->blockUsed += count * device->frameSize;
 
   if (device->blockUsed == device->blockSize) {
     if (!pcmFlushBytes(device)) {
@@ -70,15 +113,145 @@ pcmWriteSample (NoteDevice *device, int16_t amplitude) {
   return 1;
 }
 
+static void
+pcmMakeFrames (NoteDevice *device, unsigned char *frames, const int16_t *amplitudes, int count) {
+  if ((device->amplitudeFormat == PCM_FMT_S16N) && (device->channelCount == 1)) {
+    memcpy(frames, amplitudes, (count * sizeof(*amplitudes)));
+    return;
+  }
+
+  const int16_t *end = amplitudes + count;
+
+  while (amplitudes < end) {
+    PcmSample *sample = (PcmSample *)frames;
+    PcmSampleSize size = device->makeSample(sample, *amplitudes++);
+    frames += size;
+
+    for (int channel=1; channel<device->channelCount; channel+=1) {
+      memcpy(frames, sample->bytes, size);
+      frames += size;
+    }
+  }
+}
+
+static void
+pcmReplicateFrame (NoteDevice *device, unsigned char *frames, int count) {
+  /* The first frame has already been made. Keep doubling the number of
+   * copies so that the fill only needs a logarithmic number of copies.
+   */
+  size_t size = count * device->frameSize;
+  size_t done = device->frameSize;
+
+  while (done < size) {
+    size_t amount = MIN(done, size-done);
+    memcpy(&frames[done], frames, amount);
+    done += amount;
+  }
+}
+
+static int
+pcmWriteSilence (NoteDevice *device, int32_t count) {
+  static const int16_t zero = 0;
+
+  while (count > 0) {
+    int frames = MIN(count, pcmGetFramesLeft(device));
+    unsigned char *address = &device->blockAddress[device->blockUsed];
+
+    pcmMakeFrames(device, address, &zero, 1);
+    pcmReplicateFrame(device, address, frames);
+
+    if (!pcmCommitFrames(device, frames)) return 0;
+    count -= frames;
+  }
+
+  return 1;
+}
+
+static int
+pcmWriteFrames (NoteDevice *device, const unsigned char *frames, size_t size) {
+  while (size > 0) {
+    size_t amount = MIN(size, (device->blockSize - device->blockUsed));
+
+    memcpy(&device->blockAddress[device->blockUsed], frames, amount);
+    frames += amount;
+    size -= amount;
+
+    if (!pcmCommitFrames(device, (amount / device->frameSize))) return 0;
+  }
+
+  return 1;
+}
+
 static int
 pcmFlushBlock (NoteDevice *device) {
-  while (device->blockUsed)
-    if (!pcmWriteSample(device, 0))
+  if (device->blockUsed) {
+    if (!pcmWriteSilence(device, pcmGetFramesLeft(device))) {
       return 0;
+    }
+  }
 
   return 1;
 }
 
+static void
+pcmClearCache (void) {
+  {
+    PcmCachedTone *entry = pcmCache.tones;
+    const PcmCachedTone *end = entry + ARRAY_COUNT(pcmCache.tones);
+
+    while (entry < end) {
+      if (entry->frames) free(entry->frames);
+      memset(entry, 0, sizeof(*entry));
+      entry += 1;
+    }
+  }
+
+  {
+    PcmCachedTune *entry = pcmCache.tunes;
+    const PcmCachedTune *end = entry + ARRAY_COUNT(pcmCache.tunes);
+
+    while (entry < end) {
+      if (entry->elements) free(entry->elements);
+      if (entry->frames) free(entry->frames);
+      memset(entry, 0, sizeof(*entry));
+      entry += 1;
+    }
+  }
+
+  pcmCache.usageCounter = 0;
+}
+
+static void
+exitPcmCache (void *data) {
+  pcmClearCache();
+  pcmCache.initialized = 0;
+}
+
+static void
+pcmPrepareCache (NoteDevice *device) {
+  unsigned char volume = prefs.pcmVolume;
+
+  if (!pcmCache.initialized) {
+    pcmCache.initialized = 1;
+    onProgramExit("pcm-cache", exitPcmCache, NULL);
+  } else if ((pcmCache.blockSize == device->blockSize) &&
+             (pcmCache.sampleRate == device->sampleRate) &&
+             (pcmCache.channelCount == device->channelCount) &&
+             (pcmCache.amplitudeFormat == device->amplitudeFormat) &&
+             (pcmCache.volume == volume)) {
+    return;
+  } else {
+    logMessage(LOG_DEBUG, "PCM cache invalidated");
+    pcmClearCache();
+  }
+
+  pcmCache.blockSize = device->blockSize;
+  pcmCache.sampleRate = device->sampleRate;
+  pcmCache.channelCount = device->channelCount;
+  pcmCache.amplitudeFormat = device->amplitudeFormat;
+  pcmCache.volume = volume;
+}
+
 static NoteDevice *
 pcmConstruct (int errorLevel) {
   NoteDevice *device;
@@ -96,8 +269,9 @@ pcmConstruct (int errorLevel) {
       device->makeSample = getPcmSampleMaker(device->amplitudeFormat);
 
       PcmSample sample;
-      PcmSampleSize sampleSize = device->makeSample(&sample, 0);
-      sampleSize *= device->channelCount;
+      device->sampleSize = device->makeSample(&sample, 0);
+      device->frameSize = device->sampleSize * device->channelCount;
+      int sampleSize = device->frameSize;
 
       if (sampleSize && device->blockSize &&
           !(device->blockSize % sampleSize)) {
@@ -136,65 +310,130 @@ pcmDestruct (NoteDevice *device) {
   logMessage(LOG_DEBUG, "PCM disabled");
 }
 
-static int
-pcmTone (NoteDevice *device, unsigned int duration, NoteFrequency frequency) {
-  int32_t sampleCount = device->sampleRate * duration / 1000;
+typedef struct {
+  int32_t maximumAmplitude;
+  uint32_t stepsPerSample;
+  uint32_t currentValue;
+} PcmToneGenerator;
 
-  logMessage(LOG_DEBUG, "tone: MSecs:%u SmpCt:%"PRId32 " Freq:%"PRIfreq,
-             duration, sampleCount, frequency);
+/* A triangle waveform sounds nice, is lightweight, and avoids
+ * relying too much on floating-point performance and/or on
+ * expensive math functions like sin(). Considerations like
+ * these are especially important on PDAs without any FPU.
+ */ 
 
-  if (frequency) {
-    /* A triangle waveform sounds nice, is lightweight, and avoids
-     * relying too much on floating-point performance and/or on
-     * expensive math functions like sin(). Considerations like
-     * these are especially important on PDAs without any FPU.
-     */ 
-
-    /* We need to know the maximum amplitude based on the currently set
-     * volume percentage. This percentage then needs to be squared because
-     * we perceive loudness exponentially.
-     */
-    const unsigned char fullVolume = 100;
-    const unsigned char currentVolume = MIN(fullVolume, prefs.pcmVolume);
-    const int32_t maximumAmplitude = INT16_MAX
-                                   * (currentVolume * currentVolume)
-                                   / (fullVolume * fullVolume);
-
-    /* The calculations for triangle wave generation work out nicely and
-     * efficiently if we map a full period onto a 32-bit unsigned range.
-     */
+/* The calculations for triangle wave generation work out nicely and
+ * efficiently if we map a full period onto a 32-bit unsigned range.
+ */
 
-    /* The two high-order bits specify which quarter wave a sample is for.
-     *   00 -> ascending from the negative peak to zero
-     *   01 -> ascending from zero to the positive peak
-     *   10 -> descending from the positive peak to zero
-     *   11 -> descending from zero to the negative peak
-     * The higher bit is 0 for the ascending segment and 1 for the
-     * descending segment. The lower bit is 0 when going from a peak to
-     * zero and 1 when going from zero to a peak.
-     */
-    const uint8_t magnitudeWidth = 32 - 2;
+/* The two high-order bits specify which quarter wave a sample is for.
+ *   00 -> ascending from the negative peak to zero
+ *   01 -> ascending from zero to the positive peak
+ *   10 -> descending from the positive peak to zero
+ *   11 -> descending from zero to the negative peak
+ * The higher bit is 0 for the ascending segment and 1 for the
+ * descending segment. The lower bit is 0 when going from a peak to
+ * zero and 1 when going from zero to a peak.
+ */
+#define PCM_MAGNITUDE_WIDTH (32 - 2)
 
-    /* The amplitude is 0 when the lower bit of the quarter wave indicator
-     * is 1 and the rest of the (magnitude) bits are all 0.
+/* The amplitude is 0 when the lower bit of the quarter wave indicator
+ * is 1 and the rest of the (magnitude) bits are all 0.
+ */
+#define PCM_ZERO_VALUE (UINT32_C(1) << PCM_MAGNITUDE_WIDTH)
+
+static void
+pcmStartTone (PcmToneGenerator *tone, NoteDevice *device, NoteFrequency frequency, unsigned char volume) {
+  /* We need to know the maximum amplitude based on the currently set
+   * volume percentage. This percentage then needs to be squared because
+   * we perceive loudness exponentially.
+   */
+  const unsigned char fullVolume = 100;
+  const unsigned char currentVolume = MIN(fullVolume, volume);
+
+  tone->maximumAmplitude = INT16_MAX
+                         * (currentVolume * currentVolume)
+                         / (fullVolume * fullVolume);
+
+  /* We need to know how many steps to make from one sample to the next.
+   * stepsPerSample = stepsPerWave * wavesPerSecond / samplesPerSecond
+   *                = stepsPerWave * frequency / sampleRate
+   *                = stepsPerWave / sampleRate * frequency
+   */
+  tone->stepsPerSample = (NoteFrequency)UINT32_MAX 
+                       / (NoteFrequency)device->sampleRate
+                       * frequency;
+
+  /* We start by initializing the current value to the one that
+   * corresponds to the start of the first logical quarter wave
+   * (the one that ascends from zero to the positive peak).
+   */
+  tone->currentValue = PCM_ZERO_VALUE;
+}
+
+static void
+pcmMakeAmplitudes (PcmToneGenerator *tone, int16_t *amplitudes, int count) {
+  /* This loop has no calls and no data-dependent branches so that the
+   * compiler is able to vectorize it.
+   */
+  const int32_t maximumAmplitude = tone->maximumAmplitude;
+  const uint32_t stepsPerSample = tone->stepsPerSample;
+  uint32_t currentValue = tone->currentValue;
+
+  for (int index=0; index<count; index+=1) {
+    /* The current value needs to be treated as a signed value so that
+     * the >> operator will extend its sign bit.
      */
-    const uint32_t zeroValue = UINT32_C(1) << magnitudeWidth;
+    int32_t value = currentValue;
 
-    /* We need to know how many steps to make from one sample to the next.
-     * stepsPerSample = stepsPerWave * wavesPerSecond / samplesPerSecond
-     *                = stepsPerWave * frequency / sampleRate
-     *                = stepsPerWave / sampleRate * frequency
+    /* Convert the current 32-bit unsigned linear value to a 31-bit
+     * triangular amplitude by inverting its low-order 31 bits if its
+     * high-order (sign) bit is set.
      */
-    const uint32_t stepsPerSample = (NoteFrequency)UINT32_MAX 
-                                  / (NoteFrequency)device->sampleRate
-                                  * frequency;
-
-    /* The current value needs to be a signed value so that the >> operator
-     * will extend its sign bit. We start by initializing it to the value
-     * that corresponds to the start of the first logical quarter wave
-     * (the one that ascends from zero to the positive peak).
+    int32_t amplitude = value ^ (value >> 31);
+
+    /* Convert the 31-bit amplitude from unsigned to signed. */
+    amplitude -= PCM_ZERO_VALUE;
+
+    /* Convert the amplitude's magnitude from 30 bits to 16 bits. */
+    amplitude >>= PCM_MAGNITUDE_WIDTH - 16;
+
+    /* Adjust the 17-bit signed amplitude (sign bit + 16-bit value) by
+     * the currently set volume (15-bit value):
+     * (16-bit value) * (15-bit value) + (sign bit) = 32-bit signed value
      */
-    int32_t currentValue = zeroValue;
+    amplitude *= maximumAmplitude;
+
+    /* Convert the signed amplitude from 32 bits to 16 bits. */
+    amplitudes[index] = amplitude >> 16;
+
+    currentValue += stepsPerSample;
+  }
+
+  tone->currentValue = currentValue;
+}
+
+static void
+pcmRenderTone (NoteDevice *device, PcmToneGenerator *tone, unsigned char *frames, int count) {
+  int16_t amplitudes[PCM_AMPLITUDE_BUFFER_SIZE];
+
+  while (count > 0) {
+    int amount = MIN(count, ARRAY_COUNT(amplitudes));
+
+    pcmMakeAmplitudes(tone, amplitudes, amount);
+    pcmMakeFrames(device, frames, amplitudes, amount);
+
+    frames += amount * device->frameSize;
+    count -= amount;
+  }
+}
+
+static int32_t
+pcmGetSampleCount (NoteDevice *device, unsigned int duration, NoteFrequency frequency, PcmToneGenerator *tone) {
+  int32_t sampleCount = device->sampleRate * duration / 1000;
+
+  if (frequency) {
+    pcmStartTone(tone, device, frequency, pcmCache.volume);
 
     /* Round the number of samples up to a whole number of periods:
      * partialSteps = (sampleCount * stepsPerSample) % stepsPerWave
@@ -208,43 +447,218 @@ pcmTone (NoteDevice *device, unsigned int duration, NoteFrequency frequency) {
 
      * extraSamples = missingSteps / stepsPerSample
      */
-    sampleCount += (uint32_t)(sampleCount * -stepsPerSample) / stepsPerSample;
+    sampleCount += (uint32_t)(sampleCount * -tone->stepsPerSample) / tone->stepsPerSample;
+  }
+
+  return sampleCount;
+}
+
+static void
+pcmRenderSound (NoteDevice *device, unsigned char *frames, unsigned int duration, NoteFrequency frequency) {
+  PcmToneGenerator tone;
+  int32_t sampleCount = pcmGetSampleCount(device, duration, frequency, &tone);
+
+  if (sampleCount > 0) {
+    if (frequency) {
+      pcmRenderTone(device, &tone, frames, sampleCount);
+    } else {
+      static const int16_t zero = 0;
+
+      pcmMakeFrames(device, frames, &zero, 1);
+      pcmReplicateFrame(device, frames, sampleCount);
+    }
+  }
+}
 
-    while (sampleCount > 0) {
-      /* Convert the current 32-bit unsigned linear value to a 31-bit
-       * triangular amplitude by inverting its low-order 31 bits if its
-       * high-order (sign) bit is set.
-       */
-      int32_t amplitude = currentValue ^ (currentValue >> 31);
+static const PcmCachedTone *
+pcmGetCachedTone (NoteDevice *device, unsigned int duration, NoteFrequency frequency, int32_t sampleCount) {
+  PcmCachedTone *entry = pcmCache.tones;
+  const PcmCachedTone *end = entry + ARRAY_COUNT(pcmCache.tones);
+  PcmCachedTone *oldest = entry;
+
+  while (entry < end) {
+    if (entry->frames &&
+        (entry->frequency == frequency) &&
+        (entry->sampleCount == sampleCount)) {
+      entry->lastUsed = ++pcmCache.usageCounter;
+      return entry;
+    }
 
-      /* Convert the 31-bit amplitude from unsigned to signed. */
-      amplitude -= zeroValue;
+    if (entry->lastUsed < oldest->lastUsed) oldest = entry;
+    entry += 1;
+  }
 
-      /* Convert the amplitude's magnitude from 30 bits to 16 bits. */
-      amplitude >>= magnitudeWidth - 16;
+  {
+    size_t size = sampleCount * device->frameSize;
+    unsigned char *frames;
+
+    if ((frames = malloc(size))) {
+      pcmRenderSound(device, frames, duration, frequency);
+
+      if (oldest->frames) free(oldest->frames);
+      oldest->frequency = frequency;
+      oldest->sampleCount = sampleCount;
+      oldest->frames = frames;
+      oldest->size = size;
+      oldest->lastUsed = ++pcmCache.usageCounter;
+      return oldest;
+    } else {
+      logMallocError();
+    }
+  }
 
-      /* Adjust the 17-bit signed amplitude (sign bit + 16-bit value) by
-       * the currently set volume (15-bit value):
-       * (16-bit value) * (15-bit value) + (sign bit) = 32-bit signed value
-       */
-      amplitude *= maximumAmplitude;
+  return NULL;
+}
+
+static int
+pcmTone (NoteDevice *device, unsigned int duration, NoteFrequency frequency) {
+  pcmPrepareCache(device);
 
-      /* Convert the signed amplitude from 32 bits to 16 bits. */
-      amplitude >>= 16;
+  PcmToneGenerator tone;
+  int32_t sampleCount = pcmGetSampleCount(device, duration, frequency, &tone);
+
+  logMessage(LOG_DEBUG, "tone: MSecs:%u SmpCt:%"PRId32 " Freq:%"PRIfreq,
+             duration, sampleCount, frequency);
+
+  if (!frequency) return pcmWriteSilence(device, sampleCount);
+
+  /* Since every tone starts at the same phase, its samples only depend
+   * on its frequency, its length, and the volume. Short tones, which is
+   * what alerts are made of, are rendered once and then reused.
+   */
+  if ((sampleCount * device->frameSize) <= PCM_TONE_CACHE_LIMIT) {
+    const PcmCachedTone *cached = pcmGetCachedTone(device, duration, frequency, sampleCount);
+
+    if (cached) return pcmWriteFrames(device, cached->frames, cached->size);
+  }
+
+  while (sampleCount > 0) {
+    int count = MIN(sampleCount, pcmGetFramesLeft(device));
+
+    pcmRenderTone(device, &tone, &device->blockAddress[device->blockUsed], count);
+    if (!pcmCommitFrames(device, count)) return 0;
+    sampleCount -= count;
+  }
 
-      if (!pcmWriteSample(device, amplitude)) break;
-      currentValue += stepsPerSample;
-      sampleCount -= 1;
+  return 1;
+}
+
+static unsigned int
+pcmGetTuneLength (const ToneElement *tune) {
+  const ToneElement *element = tune;
+
+  while (element->duration) element += 1;
+  return element - tune;
+}
+
+static PcmCachedTune *
+pcmRenderTune (NoteDevice *device, const ToneElement *tune, unsigned int count, PcmCachedTune *entry) {
+  size_t used = 0;
+
+  for (unsigned int index=0; index<count; index+=1) {
+    const ToneElement *element = &tune[index];
+    PcmToneGenerator tone;
+    int32_t sampleCount = pcmGetSampleCount(device, element->duration, element->frequency, &tone);
+
+    if (sampleCount > 0) used += sampleCount * device->frameSize;
+    if (used > PCM_TUNE_CACHE_LIMIT) return NULL;
+  }
+
+  /* The rendered tune is padded with silence to a whole number of blocks
+   * so that it can be written with a single call when the block is empty.
+   */
+  size_t size = ((used + device->blockSize - 1) / device->blockSize) * device->blockSize;
+  unsigned char *frames;
+
+  if ((frames = malloc(size))) {
+    ToneElement *elements;
+
+    if ((elements = malloc(ARRAY_SIZE(elements, count)))) {
+      unsigned char *next = frames;
+
+      memcpy(elements, tune, ARRAY_SIZE(elements, count));
+
+      for (unsigned int index=0; index<count; index+=1) {
+        const ToneElement *element = &tune[index];
+        PcmToneGenerator tone;
+        int32_t sampleCount = pcmGetSampleCount(device, element->duration, element->frequency, &tone);
+
+        if (sampleCount > 0) {
+          pcmRenderSound(device, next, element->duration, element->frequency);
+          next += sampleCount * device->frameSize;
+        }
+      }
+
+      if (size > used) {
+        static const int16_t zero = 0;
+
+        pcmMakeFrames(device, next, &zero, 1);
+        pcmReplicateFrame(device, next, ((size - used) / device->frameSize));
+      }
+
+      if (entry->elements) free(entry->elements);
+      if (entry->frames) free(entry->frames);
+
+      entry->elements = elements;
+      entry->count = count;
+      entry->frames = frames;
+      entry->used = used;
+      entry->size = size;
+      return entry;
+    } else {
+      logMallocError();
     }
+
+    free(frames);
   } else {
-    /* generate silence */
-    while (sampleCount > 0) {
-      if (!pcmWriteSample(device, 0)) break;
-      sampleCount -= 1;
+    logMallocError();
+  }
+
+  return NULL;
+}
+
+static const PcmCachedTune *
+pcmGetCachedTune (NoteDevice *device, const ToneElement *tune) {
+  unsigned int count = pcmGetTuneLength(tune);
+  if (!count) return NULL;
+
+  PcmCachedTune *entry = pcmCache.tunes;
+  const PcmCachedTune *end = entry + ARRAY_COUNT(pcmCache.tunes);
+  PcmCachedTune *oldest = entry;
+
+  while (entry < end) {
+    if (entry->frames && (entry->count == count) &&
+        (memcmp(entry->elements, tune, ARRAY_SIZE(entry->elements, count)) == 0)) {
+      entry->lastUsed = ++pcmCache.usageCounter;
+      return entry;
     }
+
+    if (entry->lastUsed < oldest->lastUsed) oldest = entry;
+    entry += 1;
   }
 
-  return (sampleCount > 0) ? 0 : 1;
+  if (!pcmRenderTune(device, tune, count, oldest)) return NULL;
+  oldest->lastUsed = ++pcmCache.usageCounter;
+  return oldest;
+}
+
+static int
+pcmTune (NoteDevice *device, const ToneElement *tune) {
+  pcmPrepareCache(device);
+
+  const PcmCachedTune *cached = pcmGetCachedTune(device, tune);
+
+  if (cached) {
+    if (!device->blockUsed) return writePcmData(device->pcm, cached->frames, cached->size);
+    return pcmWriteFrames(device, cached->frames, cached->used);
+  }
+
+  while (tune->duration) {
+    if (!pcmTone(device, tune->duration, tune->frequency)) return 0;
+    tune += 1;
+  }
+
+  return 1;
 }
 
 static int
@@ -263,5 +677,6 @@ const NoteMethods pcmNoteMethods = {
 
   .tone = pcmTone,
   .note = pcmNote,
+  .tune = pcmTune,
   .flush = pcmFlush
 };
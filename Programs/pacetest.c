@@ -0,0 +1,285 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2017 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+/* This program paces output (see gioPaceOutput) over a null link which
+ * claims a baud rate but really drains at some other speed. Each scripted
+ * scenario writes a run of messages, waiting either for the pacing delay
+ * (as writeBraillePacket's caller does) or for an acknowledgement from the
+ * other end, and checks where the pacing scale settles and whether the
+ * messages kept pace with the link.
+ */
+
+#include "prologue.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "program.h"
+#include "options.h"
+#include "log.h"
+#include "parse.h"
+#include "timing.h"
+#include "parameters.h"
+#include "io_serial.h"
+#include "io_generic.h"
+#include "gio_internal.h"
+
+static char *opt_baud;
+static char *opt_scenarioName;
+
+BEGIN_OPTION_TABLE(programOptions)
+  { .letter = 'b',
+    .word = "baud",
+    .argument = "rate",
+    .setting.string = &opt_baud,
+    .internal.setting = "19200",
+    .description = "The nominal baud rate of the link."
+  },
+
+  { .letter = 's',
+    .word = "scenario",
+    .argument = "name",
+    .setting.string = &opt_scenarioName,
+    .description = "Only run this scenario."
+  },
+END_OPTION_TABLE
+
+#define MESSAGE_SIZE 40
+#define MESSAGE_COUNT 30
+#define ACKNOWLEDGEMENT_LATENCY 2
+
+typedef struct {
+  const char *name;
+  unsigned int speed; /* percent of the nominal rate */
+  unsigned int writes; /* per message */
+  unsigned int missing; /* acknowledgements missed before the run */
+  unsigned acknowledged:1;
+
+  unsigned int minimumScale;
+  unsigned int maximumScale;
+} PacingScenario;
+
+static const PacingScenario pacingScenarios[] = {
+  { .name = "matched",
+    .speed = 100, .writes = 1,
+    .minimumScale = 100, .maximumScale = 110
+  },
+
+  { .name = "slow",
+    .speed = 50, .writes = 1,
+    .minimumScale = 150, .maximumScale = GIO_WRITE_PACING_SCALE_MAXIMUM
+  },
+
+  { .name = "fast",
+    .speed = 200, .writes = 1, .acknowledged = 1,
+    .minimumScale = 100, .maximumScale = 100
+  },
+
+  { .name = "split",
+    .speed = 100, .writes = 4,
+    .minimumScale = 100, .maximumScale = 110
+  },
+
+  { .name = "recovering",
+    .speed = 100, .writes = 4, .missing = 2, .acknowledged = 1,
+    .minimumScale = 100, .maximumScale = 125
+  },
+};
+
+/* When the data written so far will have drained (mirrors gio_null.c). */
+static TimeValue linkDrained;
+
+static void
+drainLink (unsigned int bytesPerSecond, size_t size) {
+  TimeValue now;
+
+  getMonotonicTime(&now);
+  if (compareTimeValues(&now, &linkDrained) > 0) linkDrained = now;
+  adjustTimeValue(&linkDrained, (((size * 1000) + (bytesPerSecond / 2)) / bytesPerSecond));
+}
+
+static long int
+getLinkBacklog (void) {
+  TimeValue now;
+
+  getMonotonicTime(&now);
+  return millisecondsBetween(&now, &linkDrained);
+}
+
+static int
+runScenario (const PacingScenario *scenario, const SerialParameters *parameters) {
+  unsigned int nominalRate = parameters->baud / serialGetCharacterSize(parameters);
+  unsigned int linkRate = (nominalRate * scenario->speed) / 100;
+  unsigned int lowestScale;
+  long int largestBacklog = 0;
+  long int idleTime = 0;
+  TimeValue start;
+  GioEndpoint *endpoint;
+
+  {
+    GioDescriptor descriptor;
+
+    gioInitializeDescriptor(&descriptor);
+    descriptor.null.parameters = parameters;
+    descriptor.null.bytesPerSecond = linkRate;
+
+    if (!(endpoint = gioConnectResource("null:", &descriptor))) {
+      logMessage(LOG_ERR, "%s: null link not connected", scenario->name);
+      return 0;
+    }
+  }
+
+  for (unsigned int count=0; count<scenario->missing; count+=1) {
+    gioCountMissingAcknowledgement(endpoint);
+  }
+
+  lowestScale = endpoint->pacing.scale;
+  getMonotonicTime(&start);
+  getMonotonicTime(&linkDrained);
+
+  for (unsigned int message=0; message<MESSAGE_COUNT; message+=1) {
+    unsigned char buffer[MESSAGE_SIZE];
+    size_t offset = 0;
+    unsigned int delay = 0;
+
+    if (message) {
+      long int backlog = getLinkBacklog();
+
+      if (backlog > largestBacklog) largestBacklog = backlog;
+      if (backlog < 0) idleTime -= backlog;
+    }
+
+    memset(buffer, message, sizeof(buffer));
+
+    for (unsigned int write=1; write<=scenario->writes; write+=1) {
+      size_t size = ((MESSAGE_SIZE * write) / scenario->writes) - offset;
+
+      drainLink(linkRate, size);
+
+      if (gioWriteData(endpoint, &buffer[offset], size) != size) {
+        logMessage(LOG_ERR, "%s: null link write failed", scenario->name);
+        gioDisconnectResource(endpoint);
+        return 0;
+      }
+
+      offset += size;
+      delay += gioGetWritePacingDelay(endpoint);
+      if (endpoint->pacing.scale < lowestScale) lowestScale = endpoint->pacing.scale;
+    }
+
+    gioCountOutputPacket(endpoint);
+
+    if (scenario->acknowledged) {
+      TimeValue written;
+      long int wait = getLinkBacklog() + ACKNOWLEDGEMENT_LATENCY;
+
+      getMonotonicTime(&written);
+      if (wait > 0) approximateDelay(wait);
+
+      gioCountAcknowledgement(endpoint, getMonotonicElapsed(&written));
+      if (endpoint->pacing.scale < lowestScale) lowestScale = endpoint->pacing.scale;
+    } else if (delay) {
+      approximateDelay(delay);
+    }
+  }
+
+  {
+    unsigned int scale = endpoint->pacing.scale;
+    long int time = getMonotonicElapsed(&start);
+    long int messageTime = (MESSAGE_SIZE * 1000) / linkRate;
+    int ok = 1;
+
+    /* a link with a nominal rate is never paced faster than that */
+    if (lowestScale < 100) ok = 0;
+
+    if (scale < scenario->minimumScale) ok = 0;
+    if (scale > scenario->maximumScale) ok = 0;
+
+    if (!scenario->acknowledged) {
+      /* no more than one message should be queued - and the link shouldn't be mostly idle */
+      if (largestBacklog > messageTime) ok = 0;
+      if (idleTime > (time / 2)) ok = 0;
+    }
+
+    printf("%-12s %5uB/s scale:%3u%% lowest:%3u%% backlog:%3ldms idle:%4ldms %5ldms %s\n",
+           scenario->name, linkRate, scale, lowestScale,
+           largestBacklog, idleTime, time, (ok? "ok": "FAILED"));
+
+    gioDisconnectResource(endpoint);
+    return ok;
+  }
+}
+
+int
+main (int argc, char *argv[]) {
+  SerialParameters parameters;
+  unsigned int failures = 0;
+  unsigned int count = 0;
+
+  {
+    static const OptionsDescriptor descriptor = {
+      OPTION_TABLE(programOptions),
+      .applicationName = "pacetest"
+    };
+
+    PROCESS_OPTIONS(descriptor, argc, argv);
+  }
+
+  gioInitializeSerialParameters(&parameters);
+
+  {
+    static const int minimum = 1200;
+    static const int maximum = 115200;
+    int baud;
+
+    if (!validateInteger(&baud, opt_baud, &minimum, &maximum)) {
+      logMessage(LOG_ERR, "%s: %s", "invalid baud rate", opt_baud);
+      return PROG_EXIT_SYNTAX;
+    }
+
+    parameters.baud = baud;
+  }
+
+  if (argc) {
+    logMessage(LOG_ERR, "too many parameters");
+    return PROG_EXIT_SYNTAX;
+  }
+
+  for (unsigned int index=0; index<ARRAY_COUNT(pacingScenarios); index+=1) {
+    const PacingScenario *scenario = &pacingScenarios[index];
+
+    if (opt_scenarioName && *opt_scenarioName) {
+      if (strcmp(scenario->name, opt_scenarioName) != 0) continue;
+    }
+
+    if (!runScenario(scenario, &parameters)) failures += 1;
+    count += 1;
+  }
+
+  if (!count) {
+    logMessage(LOG_ERR, "unknown scenario: %s", opt_scenarioName);
+    return PROG_EXIT_SYNTAX;
+  }
+
+  if (failures) {
+    logMessage(LOG_ERR, "write pacing scenarios failed: %u", failures);
+    return PROG_EXIT_SEMANTIC;
+  }
+
+  return PROG_EXIT_SUCCESS;
+}
@@ -0,0 +1,362 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2017 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+/* This program replays byte streams over a null link which hands them back
+ * a few bytes per read (and then waits out the input timeout, as a quiet link
+ * would), and reads packets from them with both
+ * readBraillePacket (a per-byte verifier) and readFramedBraillePacket (a
+ * framing descriptor) for a protocol like Seika's NTK one (FF FF type length
+ * ...). Each scenario checks, for every read size, that both readers find
+ * the same packets in the stream - skipping whatever garbage surrounds them -
+ * and that input is only waited for while a packet is incomplete.
+ */
+
+#include "prologue.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "program.h"
+#include "options.h"
+#include "log.h"
+#include "timing.h"
+#include "brl_base.h"
+#include "io_generic.h"
+#include "gio_internal.h"
+
+static char *opt_scenarioName;
+
+BEGIN_OPTION_TABLE(programOptions)
+  { .letter = 's',
+    .word = "scenario",
+    .argument = "name",
+    .setting.string = &opt_scenarioName,
+    .description = "Only run this scenario."
+  },
+END_OPTION_TABLE
+
+#define PACKET_SIZE 0X20
+#define PACKET_LIMIT 4
+#define INPUT_TIMEOUT 100
+
+typedef struct {
+  size_t offset;
+  size_t length;
+} ExpectedPacket;
+
+typedef struct {
+  const char *name;
+  const unsigned char *stream;
+  size_t size;
+
+  ExpectedPacket packets[PACKET_LIMIT];
+  unsigned incomplete:1; /* the stream ends part way through a packet */
+} PacketScenario;
+
+#define PACKET_STREAM(name) .stream = name, .size = sizeof(name)
+
+static const unsigned char cleanStream[] = {
+  0XFF, 0XFF, 0XA2, 0X03, 0X01, 0X02, 0X03,
+  0XFF, 0XFF, 0XA4, 0X00
+};
+
+static const unsigned char garbageStream[] = {
+  0X00, 0X12, 0X34,
+  0XFF, 0XFF, 0XA2, 0X03, 0X01, 0X02, 0X03,
+  0XFF, 0XFF, 0XA4, 0X00
+};
+
+static const unsigned char falseHeaderStream[] = {
+  0XFF, 0X12,
+  0XFF, 0XFF, 0XA4, 0X01, 0X05
+};
+
+static const unsigned char betweenStream[] = {
+  0XFF, 0XFF, 0XA4, 0X01, 0X05,
+  0X55, 0X66, 0XFF, 0X77,
+  0XFF, 0XFF, 0XA6, 0X02, 0X01, 0X02
+};
+
+static const unsigned char trailingStream[] = {
+  0XFF, 0XFF, 0XA4, 0X01, 0X05,
+  0X00, 0X11
+};
+
+static const unsigned char noiseStream[] = {
+  0X00, 0X11, 0XFF, 0X22, 0X33
+};
+
+static const unsigned char incompleteStream[] = {
+  0XFF, 0XFF, 0XA4, 0X01, 0X05,
+  0XFF, 0XFF, 0XA2, 0X05, 0X01
+};
+
+static const PacketScenario packetScenarios[] = {
+  { .name = "clean",
+    PACKET_STREAM(cleanStream),
+    .packets = {{0, 7}, {7, 4}}
+  },
+
+  { .name = "garbage",
+    PACKET_STREAM(garbageStream),
+    .packets = {{3, 7}, {10, 4}}
+  },
+
+  { .name = "false-header",
+    PACKET_STREAM(falseHeaderStream),
+    .packets = {{2, 5}}
+  },
+
+  { .name = "between",
+    PACKET_STREAM(betweenStream),
+    .packets = {{0, 5}, {9, 6}}
+  },
+
+  { .name = "trailing",
+    PACKET_STREAM(trailingStream),
+    .packets = {{0, 5}}
+  },
+
+  { .name = "noise",
+    PACKET_STREAM(noiseStream)
+  },
+
+  { .name = "incomplete",
+    PACKET_STREAM(incompleteStream),
+    .packets = {{0, 5}},
+    .incomplete = 1
+  },
+};
+
+/* the most bytes a single read returns (0 for all of them) */
+static const size_t inputChunks[] = {1, 2, 3, 5, 0};
+
+static BraillePacketVerifierResult
+verifyTestPacket (
+  BrailleDisplay *brl,
+  const unsigned char *bytes, size_t size,
+  size_t *length, void *data
+) {
+  unsigned char byte = bytes[size-1];
+
+  switch (size) {
+    case 1:
+    case 2:
+      if (byte != 0XFF) return BRL_PVR_INVALID;
+      *length = 4;
+      break;
+
+    case 4:
+      *length += byte;
+      break;
+
+    default:
+      break;
+  }
+
+  return BRL_PVR_INCLUDE;
+}
+
+static const unsigned char testPacketHeader[] = {0XFF, 0XFF};
+
+static const BraillePacketFraming testPacketFraming = {
+  .header = testPacketHeader,
+  .headerSize = sizeof(testPacketHeader),
+
+  .method = BRL_PFM_LENGTH,
+  .rule.length = {
+    .offset = 3,
+    .adjustment = 4
+  }
+};
+
+typedef enum {
+  READER_VERIFIED,
+  READER_FRAMED
+} PacketReader;
+
+static const char *const readerNames[] = {
+  [READER_VERIFIED] = "verified",
+  [READER_FRAMED] = "framed"
+};
+
+static int
+replayStream (const PacketScenario *scenario, PacketReader reader, size_t chunk) {
+  BrailleDisplay brl;
+  GioEndpoint *endpoint;
+  unsigned int count = 0;
+  int ok = 1;
+  TimeValue start;
+
+  {
+    GioDescriptor descriptor;
+
+    gioInitializeDescriptor(&descriptor);
+    descriptor.null.input = scenario->stream;
+    descriptor.null.inputSize = scenario->size;
+    descriptor.null.inputChunk = chunk;
+    descriptor.null.options.inputTimeout = INPUT_TIMEOUT;
+
+    if (!(endpoint = gioConnectResource("null:", &descriptor))) {
+      logMessage(LOG_ERR, "%s: null link not connected", scenario->name);
+      return 0;
+    }
+  }
+
+  memset(&brl, 0, sizeof(brl));
+  getMonotonicTime(&start);
+
+  while (1) {
+    unsigned char packet[PACKET_SIZE];
+    size_t length;
+
+    switch (reader) {
+      case READER_VERIFIED:
+        length = readBraillePacket(&brl, endpoint, packet, sizeof(packet), verifyTestPacket, NULL);
+        break;
+
+      case READER_FRAMED:
+        length = readFramedBraillePacket(&brl, endpoint, packet, sizeof(packet), &testPacketFraming, NULL);
+        break;
+
+      default:
+        length = 0;
+        break;
+    }
+
+    if (!length) break;
+
+    {
+      const ExpectedPacket *expected = (count < PACKET_LIMIT)? &scenario->packets[count]: NULL;
+
+      if (!expected || !expected->length ||
+          (length != expected->length) ||
+          (memcmp(packet, &scenario->stream[expected->offset], length) != 0)) {
+        logMessage(LOG_ERR, "%s: %s reader, %u-byte reads: unexpected packet %u",
+                   scenario->name, readerNames[reader], (unsigned int)chunk, count+1);
+        ok = 0;
+        break;
+      }
+    }
+
+    count += 1;
+  }
+
+  if (ok) {
+    if ((count < PACKET_LIMIT) && scenario->packets[count].length) {
+      logMessage(LOG_ERR, "%s: %s reader, %u-byte reads: packet %u missing",
+                 scenario->name, readerNames[reader], (unsigned int)chunk, count+1);
+      ok = 0;
+    }
+
+    {
+      /* the end of the stream is only waited for part way through a packet */
+      long int waits = getMonotonicElapsed(&start) / INPUT_TIMEOUT;
+
+      if (waits != scenario->incomplete) {
+        logMessage(LOG_ERR, "%s: %s reader, %u-byte reads: input waited for %ld times",
+                   scenario->name, readerNames[reader], (unsigned int)chunk, waits);
+        ok = 0;
+      }
+    }
+  }
+
+  gioDisconnectResource(endpoint);
+  return ok;
+}
+
+static int
+runScenario (const PacketScenario *scenario) {
+  unsigned int packets = 0;
+  unsigned int replays = 0;
+  unsigned int failures = 0;
+
+  while ((packets < PACKET_LIMIT) && scenario->packets[packets].length) packets += 1;
+
+  for (unsigned int chunk=0; chunk<ARRAY_COUNT(inputChunks); chunk+=1) {
+    for (unsigned int reader=0; reader<ARRAY_COUNT(readerNames); reader+=1) {
+      if (!replayStream(scenario, reader, inputChunks[chunk])) failures += 1;
+      replays += 1;
+    }
+  }
+
+  printf("%-12s bytes:%2u packets:%u replays:%2u failed:%u %s\n",
+         scenario->name, (unsigned int)scenario->size, packets,
+         replays, failures, (failures? "FAILED": "ok"));
+
+  return !failures;
+}
+
+int
+main (int argc, char *argv[]) {
+  unsigned int failures = 0;
+  unsigned int count = 0;
+
+  {
+    static const OptionsDescriptor descriptor = {
+      OPTION_TABLE(programOptions),
+      .applicationName = "packettest"
+    };
+
+    PROCESS_OPTIONS(descriptor, argc, argv);
+  }
+
+  if (argc) {
+    logMessage(LOG_ERR, "too many parameters");
+    return PROG_EXIT_SYNTAX;
+  }
+
+  /* the readers warn about every bit of garbage they skip */
+  stderrLogLevel = LOG_ERR;
+
+  for (unsigned int index=0; index<ARRAY_COUNT(packetScenarios); index+=1) {
+    const PacketScenario *scenario = &packetScenarios[index];
+
+    if (opt_scenarioName && *opt_scenarioName) {
+      if (strcmp(scenario->name, opt_scenarioName) != 0) continue;
+    }
+
+    if (!runScenario(scenario)) failures += 1;
+    count += 1;
+  }
+
+  if (!count) {
+    logMessage(LOG_ERR, "unknown scenario: %s", opt_scenarioName);
+    return PROG_EXIT_SYNTAX;
+  }
+
+  if (failures) {
+    logMessage(LOG_ERR, "braille packet scenarios failed: %u", failures);
+    return PROG_EXIT_SEMANTIC;
+  }
+
+  return PROG_EXIT_SUCCESS;
+}
+
+#include "scr.h"
+
+KeyTableCommandContext
+getScreenCommandContext (void) {
+  return KTB_CTX_DEFAULT;
+}
+
+#include "alert.h"
+
+void
+alert (AlertIdentifier identifier) {
+}
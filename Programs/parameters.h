@@ -37,6 +37,7 @@ extern "C" {
 
 #define SPEECH_DRIVER_START_RETRY_INTERVAL 5000
 #define SPEECH_DRIVER_START_AUTOSPEAK_DELAY 4000
+#define AUTOSPEAK_MAXIMUM_EDITS 0X40
 
 #define SPEECH_DRIVER_THREAD_START_TIMEOUT 15000
 #define SPEECH_DRIVER_THREAD_STOP_TIMEOUT 5000
@@ -45,6 +46,8 @@ extern "C" {
 
 #define SCREEN_DRIVER_START_RETRY_INTERVAL 5000
 #define SCREEN_FREEZE_REMINDER_INTERVAL 30000
+#define SCREEN_FREEZE_HISTORY_SIZE 32
+#define SCREEN_FREEZE_ROW_SEARCH_DISTANCE 4
 #define SCREEN_UPDATE_POLL_INTERVAL 40
 #define SCREEN_UPDATE_SCHEDULE_DELAY 5
 
@@ -53,6 +56,8 @@ extern "C" {
 #define PID_FILE_CREATE_RETRY_INTERVAL 5000
 
 #define UPDATE_SCHEDULE_DELAY 15
+#define UPDATE_FRAME_BUDGET 50
+#define UPDATE_LATENCY_LIMIT 1000
 
 #define TUNE_DEVICE_CLOSE_DELAY 2000
 #define TUNE_TOGGLE_REPEAT_DELAY 100
@@ -68,6 +73,8 @@ extern "C" {
 #define GPM_CONNECTION_RESET_DELAY 5000
 
 #define GIO_USB_INPUT_MONITOR_DISABLE 0
+#define GIO_WRITE_PACING_SCALE_MINIMUM 25
+#define GIO_WRITE_PACING_SCALE_MAXIMUM 400
 
 #define SERIAL_DEVICE_RESTART_DELAY 500
 
@@ -75,6 +82,8 @@ extern "C" {
 #define USB_INPUT_READ_INITIAL_TIMEOUT_DEFAULT 20
 #define USB_INPUT_INTERRUPT_DELAY_MAXIMUM 16
 #define USB_INPUT_INTERRUPT_REQUESTS_MAXIMUM 8
+#define USB_INPUT_RING_SIZE_INITIAL 0X400
+#define USB_INPUT_RING_SIZE_MAXIMUM 0X10000
 
 #define BLUETOOTH_DEVICE_NAME_OBTAIN_TIMEOUT 5000
 #define BLUETOOTH_CHANNEL_BUSY_RETRY_TIMEOUT 2000
@@ -82,7 +91,8 @@ extern "C" {
 #define BLUETOOTH_CHANNEL_CONNECT_TIMEOUT 15000
 
 #define LINUX_INPUT_DEVICE_OPEN_DELAY 1000
-#define LINUX_USB_INPUT_PIPE_DISABLE 0
+#define LINUX_INPUT_EVENT_READ_COUNT 0X40
+#define LINUX_USB_INPUT_RING_DISABLE 0
 #define LINUX_USB_INPUT_USE_SIGNAL_MONITOR 0
 #define LINUX_USB_INPUT_TREAT_INTERRUPT_AS_BULK 0
 #define LINUX_BLUETOOTH_NAME_OBTAIN_ASYNCHRONOUS 1
@@ -0,0 +1,1329 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2017 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+/* This program times the translation paths which run on every screen refresh.
+ * Each benchmark is a loop which calls just the code being measured once per
+ * item (character, cell, row, or key event) of some screen content - either
+ * synthetic or recorded (any text file, one row per line). A few paths which
+ * don't depend on the screen (key events, alert tunes, USB input packets) are
+ * timed on their own. The results (ns/op and allocations/op) can be compared against,
+ * or written as, a baseline.
+ */
+
+#include "prologue.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "program.h"
+#include "options.h"
+#include "log.h"
+#include "parse.h"
+#include "file.h"
+#include "charset.h"
+#include "timing.h"
+#include "prefs.h"
+#include "scr_types.h"
+#include "scr_utils.h"
+#include "update_cells.h"
+#include "brl_utils.h"
+#include "unicode.h"
+#include "ttb.h"
+#include "atb.h"
+#include "ctb.h"
+#include "ktb.h"
+#include "ktb_keyboard.h"
+#include "cmd_queue.h"
+#include "async_wait.h"
+#include "parameters.h"
+#include "notes.h"
+#include "tune_build.h"
+
+#ifdef PERFTEST_USB_linux
+#include <linux/usbdevice_fs.h>
+
+#include "io_usb.h"
+#include "usb_internal.h"
+
+/* in usb_linux.c - what the USBFS monitor does with each reaped input URB */
+extern int usbHandleCompletedInputRequest (UsbEndpoint *endpoint, struct usbdevfs_urb *urb);
+#endif /* PERFTEST_USB_linux */
+
+static char *opt_tablesDirectory;
+static char *opt_textTable;
+static char *opt_attributesTable;
+static char *opt_contractionTable;
+static char *opt_keyboardTable;
+static char *opt_baselineFile;
+static int opt_writeBaseline;
+static char *opt_benchmarkDuration;
+static char *opt_slowerTolerance;
+
+BEGIN_OPTION_TABLE(programOptions)
+  { .letter = 'T',
+    .word = "tables-directory",
+    .flags = OPT_Hidden,
+    .argument = "directory",
+    .setting.string = &opt_tablesDirectory,
+    .internal.setting = TABLES_DIRECTORY,
+    .internal.adjust = fixInstallPath,
+    .description = "Path to directory containing tables."
+  },
+
+  { .letter = 't',
+    .word = "text-table",
+    .argument = "file",
+    .setting.string = &opt_textTable,
+    .internal.setting = TEXT_TABLE,
+    .description = "Text table."
+  },
+
+  { .letter = 'a',
+    .word = "attributes-table",
+    .argument = "file",
+    .setting.string = &opt_attributesTable,
+    .internal.setting = ATTRIBUTES_TABLE,
+    .description = "Attributes table."
+  },
+
+  { .letter = 'c',
+    .word = "contraction-table",
+    .argument = "file",
+    .setting.string = &opt_contractionTable,
+    .internal.setting = "en-us-g2",
+    .description = "Contraction table."
+  },
+
+  { .letter = 'k',
+    .word = "keyboard-table",
+    .argument = "file",
+    .setting.string = &opt_keyboardTable,
+    .internal.setting = "desktop",
+    .description = "Keyboard table."
+  },
+
+  { .letter = 'b',
+    .word = "baseline",
+    .argument = "file",
+    .setting.string = &opt_baselineFile,
+    .description = "Compare the results against this baseline."
+  },
+
+  { .letter = 'w',
+    .word = "write-baseline",
+    .setting.flag = &opt_writeBaseline,
+    .description = "Write the results to standard output as a baseline."
+  },
+
+  { .letter = 'd',
+    .word = "duration",
+    .argument = "milliseconds",
+    .setting.string = &opt_benchmarkDuration,
+    .internal.setting = "200",
+    .description = "How long to run each benchmark for."
+  },
+
+  { .letter = 's',
+    .word = "slower-tolerance",
+    .argument = "percent",
+    .setting.string = &opt_slowerTolerance,
+    .internal.setting = "25",
+    .description = "How much slower than its baseline a benchmark may be."
+  },
+END_OPTION_TABLE
+
+#ifdef PERFTEST_COUNT_ALLOCATIONS
+/* The link wraps these (see the perftest target in Makefile.in) so that
+ * allocations made by the code being timed can be counted.
+ */
+static unsigned long int allocationCount = 0;
+
+extern void *__real_malloc (size_t size);
+extern void *__real_calloc (size_t count, size_t size);
+extern void *__real_realloc (void *address, size_t size);
+extern char *__real_strdup (const char *string);
+
+void *
+__wrap_malloc (size_t size) {
+  allocationCount += 1;
+  return __real_malloc(size);
+}
+
+void *
+__wrap_calloc (size_t count, size_t size) {
+  allocationCount += 1;
+  return __real_calloc(count, size);
+}
+
+void *
+__wrap_realloc (void *address, size_t size) {
+  allocationCount += 1;
+  return __real_realloc(address, size);
+}
+
+char *
+__wrap_strdup (const char *string) {
+  allocationCount += 1;
+  return __real_strdup(string);
+}
+#endif /* PERFTEST_COUNT_ALLOCATIONS */
+
+#define SCREEN_COLUMNS 80
+#define SYNTHETIC_ROWS 25
+#define RECORDED_ROWS_LIMIT 0X400
+
+typedef struct {
+  const char *name;
+  ScreenCharacter *characters;
+  unsigned int rows;
+
+  struct {
+    unsigned char *cells;
+    int *lengths;
+    int *offsets;
+  } contracted;
+} ScreenContent;
+
+static TextTable *benchmarkTextTable = NULL;
+static AttributesTable *benchmarkAttributesTable = NULL;
+static ContractionTable *benchmarkContractionTable = NULL;
+static KeyTable *benchmarkKeyTable = NULL;
+
+static unsigned char displayCells[SCREEN_COLUMNS];
+static unsigned char screenCells[SCREEN_COLUMNS];
+static wchar_t screenText[SCREEN_COLUMNS];
+static unsigned char blinkVisible;
+static volatile unsigned int benchmarkSink;
+
+static ScreenCharacter *
+getScreenRow (const ScreenContent *content, unsigned int row) {
+  return &content->characters[row * SCREEN_COLUMNS];
+}
+
+static unsigned int
+runTextDots (const ScreenContent *content) {
+  const ScreenCharacter *character = content->characters;
+  const ScreenCharacter *end = character + (content->rows * SCREEN_COLUMNS);
+  unsigned char dots = 0;
+
+  while (character < end) {
+    dots ^= convertCharacterToDots(benchmarkTextTable, character->text);
+    character += 1;
+  }
+
+  benchmarkSink = dots;
+  return content->rows * SCREEN_COLUMNS;
+}
+
+static unsigned int
+runAttributesDots (const ScreenContent *content) {
+  const ScreenCharacter *character = content->characters;
+  const ScreenCharacter *end = character + (content->rows * SCREEN_COLUMNS);
+  unsigned char dots = 0;
+
+  while (character < end) {
+    dots ^= convertAttributesToDots(benchmarkAttributesTable, character->attributes);
+    character += 1;
+  }
+
+  benchmarkSink = dots;
+  return content->rows * SCREEN_COLUMNS;
+}
+
+static unsigned int
+runContractText (const ScreenContent *content) {
+  for (unsigned int row=0; row<content->rows; row+=1) {
+    const ScreenCharacter *characters = getScreenRow(content, row);
+    wchar_t text[SCREEN_COLUMNS];
+    unsigned char cells[SCREEN_COLUMNS];
+    int offsets[SCREEN_COLUMNS];
+    int inputLength = SCREEN_COLUMNS;
+    int outputLength = SCREEN_COLUMNS;
+
+    for (unsigned int column=0; column<SCREEN_COLUMNS; column+=1) {
+      text[column] = characters[column].text;
+    }
+
+    contractText(benchmarkContractionTable,
+                 text, &inputLength,
+                 cells, &outputLength,
+                 offsets, CTB_NO_CURSOR);
+
+    benchmarkSink = outputLength;
+  }
+
+  return content->rows;
+}
+
+static unsigned int
+runCellsChanged (const ScreenContent *content) {
+  /* Each row is written twice - as if the window had moved onto it and then
+   * been refreshed without anything on it having changed.
+   */
+  unsigned int changed = 0;
+
+  for (unsigned int row=0; row<content->rows; row+=1) {
+    const unsigned char *cells = &content->contracted.cells[row * SCREEN_COLUMNS];
+
+    for (unsigned int count=0; count<2; count+=1) {
+      unsigned int from;
+      unsigned int to;
+
+      if (cellsHaveChanged(displayCells, cells, SCREEN_COLUMNS, &from, &to, NULL)) {
+        changed += to - from;
+      }
+    }
+  }
+
+  benchmarkSink = changed;
+  return content->rows * 2;
+}
+
+/* The rest of the screen benchmarks call the functions which doUpdate (in
+ * update.c) uses to fill the braille window.
+ */
+
+static int
+isBenchmarkBlinkVisible (void) {
+  return blinkVisible;
+}
+
+static const CellsBlinkTesters benchmarkBlinkTesters = {
+  .uppercaseLetters = isBenchmarkBlinkVisible,
+  .attributesUnderline = isBenchmarkBlinkVisible
+};
+
+static unsigned int
+runWindowText (const ScreenContent *content) {
+  for (unsigned int row=0; row<content->rows; row+=1) {
+    translateScreenText(screenCells, screenText, getScreenRow(content, row),
+                        SCREEN_COLUMNS, &benchmarkBlinkTesters);
+  }
+
+  benchmarkSink = screenCells[0];
+  return content->rows;
+}
+
+static unsigned int
+runWindowAttributes (const ScreenContent *content) {
+  for (unsigned int row=0; row<content->rows; row+=1) {
+    translateScreenAttributes(screenCells, screenText, getScreenRow(content, row), SCREEN_COLUMNS);
+  }
+
+  benchmarkSink = screenCells[0];
+  return content->rows;
+}
+
+static unsigned int
+runContractedAttributes (const ScreenContent *content) {
+  for (unsigned int row=0; row<content->rows; row+=1) {
+    int outputLength = content->contracted.lengths[row];
+    unsigned char attributesBuffer[outputLength];
+
+    memcpy(screenCells, &content->contracted.cells[row * SCREEN_COLUMNS], outputLength);
+
+    mergeContractedAttributes(attributesBuffer, outputLength,
+                              getScreenRow(content, row),
+                              &content->contracted.offsets[row * SCREEN_COLUMNS],
+                              SCREEN_COLUMNS);
+
+    overlayContractedAttributes(screenCells, attributesBuffer, outputLength, &benchmarkBlinkTesters);
+  }
+
+  benchmarkSink = screenCells[0];
+  return content->rows;
+}
+
+typedef struct {
+  unsigned char group;
+  unsigned char number;
+  unsigned char press;
+} KeyEvent;
+
+#define KEY_PRESS(grp,key) {.group=KBD_GROUP(grp), .number=KBD_KEY(grp,key), .press=1}
+#define KEY_RELEASE(grp,key) {.group=KBD_GROUP(grp), .number=KBD_KEY(grp,key), .press=0}
+#define KEY_STROKE(grp,key) KEY_PRESS(grp,key), KEY_RELEASE(grp,key)
+
+static const KeyEvent keyEvents[] = {
+  /* typing - not bound */
+  KEY_STROKE(LETTER, H),
+  KEY_STROKE(LETTER, E),
+  KEY_STROKE(LETTER, L),
+  KEY_STROKE(LETTER, L),
+  KEY_STROKE(LETTER, O),
+  KEY_STROKE(SYMBOL, Space),
+
+  /* a shifted letter - a modifier plus an unbound key */
+  KEY_PRESS(MODIFIER, ShiftLeft),
+  KEY_STROKE(LETTER, W),
+  KEY_RELEASE(MODIFIER, ShiftLeft),
+
+  /* bound keypad chords */
+  KEY_PRESS(KPNUMBER, Zero),
+  KEY_STROKE(KPNUMBER, Eight),
+  KEY_STROKE(KPNUMBER, Two),
+  KEY_RELEASE(KPNUMBER, Zero),
+
+  /* a bound modifier on its own */
+  KEY_STROKE(MODIFIER, ControlLeft),
+};
+
+static unsigned long int commandsHandled = 0;
+
+static int
+handleBenchmarkCommand (int command, void *data) {
+  commandsHandled += 1;
+  return 1;
+}
+
+static unsigned int
+runKeyEvents (const ScreenContent *content) {
+  const KeyEvent *event = keyEvents;
+  const KeyEvent *end = event + ARRAY_COUNT(keyEvents);
+  unsigned int commands = 0;
+
+  while (event < end) {
+    if (processKeyEvent(benchmarkKeyTable, KTB_CTX_DEFAULT, event->group, event->number, event->press) == KTS_COMMAND) {
+      commands += 1;
+    }
+
+    event += 1;
+  }
+
+  benchmarkSink = commands;
+  return ARRAY_COUNT(keyEvents);
+}
+
+static void
+drainCommandQueue (void) {
+  /* The command queue hands one command to our handler at a time. */
+  unsigned long int handled;
+
+  do {
+    handled = commandsHandled;
+    asyncWait(0);
+  } while (commandsHandled != handled);
+}
+
+/* Some of the alert tunes (see alert.c), each played the way the tune thread
+ * plays it - through the PCM note device's tune method - on a PCM device
+ * (below) which accepts whatever is written at once. The time is how long it
+ * takes from the request until the device has all of the sound.
+ */
+static const char *const alertTunes[] = {
+  "n64@60 n69@100", /* braille on */
+  "n74@40 r@30 n74@40 r@40 n74@140 r@20 n79@50", /* command done */
+  "n78@100", /* command rejected */
+  "n83@20 n81@15 n79@15 n84@25", /* mark set */
+  "n79@30 r@30 n79@30 r@30 n79@30", /* no change */
+  "n74@30 r@30 n79@30 r@30 n86@30", /* toggle on */
+};
+
+static ToneElement *alertToneElements[ARRAY_COUNT(alertTunes)];
+static NoteDevice *alertNoteDevice = NULL;
+static unsigned long int alertBytesWritten;
+
+static void
+finishAlertSounds (void) {
+  for (unsigned int index=0; index<ARRAY_COUNT(alertToneElements); index+=1) {
+    ToneElement **tune = &alertToneElements[index];
+
+    if (*tune) {
+      free(*tune);
+      *tune = NULL;
+    }
+  }
+
+  if (alertNoteDevice) {
+    pcmNoteMethods.destruct(alertNoteDevice);
+    alertNoteDevice = NULL;
+  }
+}
+
+static int
+prepareAlertSounds (void) {
+  TuneBuilder *tb;
+  int ok = 0;
+
+  if ((tb = newTuneBuilder())) {
+    unsigned int index;
+
+    setTuneSourceName(tb, "alert");
+
+    for (index=0; index<ARRAY_COUNT(alertTunes); index+=1) {
+      setTuneSourceIndex(tb, index);
+      if (!parseTuneString(tb, "p100")) break;
+      if (!parseTuneString(tb, alertTunes[index])) break;
+      if (!(alertToneElements[index] = getTune(tb))) break;
+      resetTuneBuilder(tb);
+    }
+
+    destroyTuneBuilder(tb);
+
+    if (index == ARRAY_COUNT(alertTunes)) {
+      if ((alertNoteDevice = pcmNoteMethods.construct(LOG_WARNING))) {
+        ok = 1;
+      }
+    }
+  }
+
+  if (!ok) finishAlertSounds();
+  return ok;
+}
+
+static unsigned int
+runAlertSounds (const ScreenContent *content) {
+  for (unsigned int index=0; index<ARRAY_COUNT(alertToneElements); index+=1) {
+    pcmNoteMethods.tune(alertNoteDevice, alertToneElements[index]);
+  }
+
+  benchmarkSink = alertBytesWritten;
+  return ARRAY_COUNT(alertToneElements);
+}
+
+static void
+invalidateAlertSounds (void) {
+  /* the rendered tunes are only kept for the volume they were rendered at */
+  prefs.pcmVolume ^= 1;
+}
+
+#ifdef PERFTEST_USB_linux
+/* Packets go through an input endpoint which is never opened, the way the
+ * USBFS monitor hands them over, and are read back a few at a time, the way
+ * a driver reads them. Its pending requests are kept topped up so that no
+ * new one is ever submitted.
+ */
+#define USB_BENCHMARK_PACKET_SIZE 64
+#define USB_BENCHMARK_PACKET_COUNT 64
+#define USB_BENCHMARK_READ_PACKETS 4
+
+static UsbEndpointDescriptor usbBenchmarkDescriptor;
+static UsbDevice usbBenchmarkDevice;
+static UsbEndpoint usbBenchmarkEndpoint;
+static unsigned char usbBenchmarkRequests[USB_INPUT_INTERRUPT_REQUESTS_MAXIMUM];
+static unsigned char usbBenchmarkPacket[USB_BENCHMARK_PACKET_SIZE];
+static struct usbdevfs_urb usbBenchmarkURB;
+
+static void
+finishUsbInputRing (void) {
+  UsbDevice *device = &usbBenchmarkDevice;
+  UsbEndpoint *endpoint = &usbBenchmarkEndpoint;
+
+  usbDestroyInputRing(endpoint);
+
+  if (endpoint->direction.input.pending.requests) {
+    deallocateQueue(endpoint->direction.input.pending.requests);
+    endpoint->direction.input.pending.requests = NULL;
+  }
+
+  if (device->inputFilters) {
+    deallocateQueue(device->inputFilters);
+    device->inputFilters = NULL;
+  }
+
+  if (device->endpoints) {
+    deallocateQueue(device->endpoints);
+    device->endpoints = NULL;
+  }
+}
+
+static int
+prepareUsbInputRing (void) {
+  UsbDevice *device = &usbBenchmarkDevice;
+  UsbEndpoint *endpoint = &usbBenchmarkEndpoint;
+  struct usbdevfs_urb *urb = &usbBenchmarkURB;
+
+  memset(device, 0, sizeof(*device));
+  memset(endpoint, 0, sizeof(*endpoint));
+  memset(urb, 0, sizeof(*urb));
+
+  usbBenchmarkDescriptor.bEndpointAddress = UsbEndpointDirection_Input | 1;
+  endpoint->device = device;
+  endpoint->descriptor = &usbBenchmarkDescriptor;
+  endpoint->direction.input.ring.event = INVALID_FILE_DESCRIPTOR;
+  endpoint->direction.input.ring.notifier = INVALID_FILE_DESCRIPTOR;
+
+  for (unsigned int index=0; index<sizeof(usbBenchmarkPacket); index+=1) {
+    usbBenchmarkPacket[index] = index;
+  }
+
+  urb->buffer = usbBenchmarkPacket;
+  urb->buffer_length = sizeof(usbBenchmarkPacket);
+
+  if ((device->endpoints = newQueue(NULL, NULL))) {
+    if (enqueueItem(device->endpoints, endpoint)) {
+      if ((device->inputFilters = newQueue(NULL, NULL))) {
+        Queue *requests;
+
+        if ((endpoint->direction.input.pending.requests = requests = newQueue(NULL, NULL))) {
+          unsigned int index;
+
+          for (index=0; index<ARRAY_COUNT(usbBenchmarkRequests); index+=1) {
+            if (!enqueueItem(requests, &usbBenchmarkRequests[index])) break;
+          }
+
+          if (index == ARRAY_COUNT(usbBenchmarkRequests)) {
+            if (usbMakeInputRing(endpoint)) {
+              return 1;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  finishUsbInputRing();
+  return 0;
+}
+
+static unsigned int
+runUsbInputRing (const ScreenContent *content) {
+  unsigned char buffer[USB_BENCHMARK_PACKET_SIZE * USB_BENCHMARK_READ_PACKETS];
+  struct usbdevfs_urb *urb = &usbBenchmarkURB;
+  unsigned int handled = 0;
+
+  for (unsigned int packet=1; packet<=USB_BENCHMARK_PACKET_COUNT; packet+=1) {
+    urb->actual_length = urb->buffer_length;
+    urb->status = 0;
+    if (usbHandleCompletedInputRequest(&usbBenchmarkEndpoint, urb)) handled += 1;
+
+    if (!(packet % USB_BENCHMARK_READ_PACKETS)) {
+      usbReadData(&usbBenchmarkDevice, 1, buffer, sizeof(buffer), 0, 0);
+    }
+  }
+
+  benchmarkSink = handled + buffer[0];
+  return USB_BENCHMARK_PACKET_COUNT;
+}
+#endif /* PERFTEST_USB_linux */
+
+typedef struct {
+  const char *name;
+  const char *unit;
+  unsigned int (*run) (const ScreenContent *content);
+  void (*reset) (void);
+
+  /* for benchmarks which don't depend on the screen */
+  const char *content;
+  int (*prepare) (void);
+  void (*finish) (void);
+
+  unsigned char screenContent:1;
+} BenchmarkEntry;
+
+static const BenchmarkEntry benchmarkTable[] = {
+  { .name = "text-dots",
+    .unit = "char",
+    .run = runTextDots,
+    .screenContent = 1
+  },
+
+  { .name = "attributes-dots",
+    .unit = "cell",
+    .run = runAttributesDots,
+    .screenContent = 1
+  },
+
+  { .name = "contract-text",
+    .unit = "row",
+    .run = runContractText,
+    .screenContent = 1
+  },
+
+  { .name = "cells-changed",
+    .unit = "row",
+    .run = runCellsChanged,
+    .screenContent = 1
+  },
+
+  { .name = "window-text",
+    .unit = "row",
+    .run = runWindowText,
+    .screenContent = 1
+  },
+
+  { .name = "window-attributes",
+    .unit = "row",
+    .run = runWindowAttributes,
+    .screenContent = 1
+  },
+
+  { .name = "contracted-attributes",
+    .unit = "row",
+    .run = runContractedAttributes,
+    .screenContent = 1
+  },
+
+  { .name = "key-events",
+    .unit = "event",
+    .run = runKeyEvents,
+    .reset = drainCommandQueue,
+    .content = "keyboard"
+  },
+
+  { .name = "alert-sound",
+    .unit = "alert",
+    .run = runAlertSounds,
+    .content = "pcm",
+    .prepare = prepareAlertSounds,
+    .finish = finishAlertSounds
+  },
+
+  { .name = "alert-sound-rendered",
+    .unit = "alert",
+    .run = runAlertSounds,
+    .reset = invalidateAlertSounds,
+    .content = "pcm",
+    .prepare = prepareAlertSounds,
+    .finish = finishAlertSounds
+  },
+
+#ifdef PERFTEST_USB_linux
+  { .name = "usb-input-ring",
+    .unit = "packet",
+    .run = runUsbInputRing,
+    .content = "usb",
+    .prepare = prepareUsbInputRing,
+    .finish = finishUsbInputRing
+  },
+#endif /* PERFTEST_USB_linux */
+};
+
+typedef struct {
+  char benchmark[0X40];
+  char content[0X40];
+  double nanoseconds;
+  double allocations;
+} BaselineEntry;
+
+static BaselineEntry *baselineEntries = NULL;
+static unsigned int baselineCount = 0;
+static unsigned int baselineSize = 0;
+
+static int
+handleBaselineLine (char *line, void *data) {
+  const char *file = data;
+  BaselineEntry entry;
+
+  {
+    const char *character = line;
+
+    while (*character == ' ') character += 1;
+    if (!*character || (*character == '#')) return 1;
+  }
+
+  if (sscanf(line, "%63s %63s %lf %lf",
+             entry.benchmark, entry.content,
+             &entry.nanoseconds, &entry.allocations) != 4) {
+    logMessage(LOG_WARNING, "%s: %s: %s", "invalid baseline line", file, line);
+    return 1;
+  }
+
+  if (baselineCount == baselineSize) {
+    unsigned int newSize = baselineSize? baselineSize<<1: 0X20;
+    BaselineEntry *newEntries = realloc(baselineEntries, ARRAY_SIZE(newEntries, newSize));
+
+    if (!newEntries) {
+      logMallocError();
+      return 0;
+    }
+
+    baselineEntries = newEntries;
+    baselineSize = newSize;
+  }
+
+  baselineEntries[baselineCount++] = entry;
+  return 1;
+}
+
+static int
+loadBaseline (const char *path) {
+  FILE *stream = openFile(path, "r", 0);
+  int ok = 0;
+
+  if (stream) {
+    if (processLines(stream, handleBaselineLine, (void *)path)) ok = 1;
+    fclose(stream);
+  }
+
+  return ok;
+}
+
+static const BaselineEntry *
+findBaselineEntry (const char *benchmark, const char *content) {
+  for (unsigned int index=0; index<baselineCount; index+=1) {
+    const BaselineEntry *entry = &baselineEntries[index];
+
+    if (strcmp(entry->benchmark, benchmark) != 0) continue;
+    if (strcmp(entry->content, content) != 0) continue;
+    return entry;
+  }
+
+  return NULL;
+}
+
+static long int
+getNanosecondsBetween (const TimeValue *from, const TimeValue *to) {
+  return ((long int)(to->seconds - from->seconds) * NSECS_PER_SEC)
+       + (to->nanoseconds - from->nanoseconds);
+}
+
+static int benchmarkDuration;
+static int slowerTolerance;
+static unsigned int regressionCount = 0;
+
+static void
+runBenchmark (const BenchmarkEntry *benchmark, const ScreenContent *content) {
+  unsigned long int operations = 0;
+  unsigned long int allocations;
+  long int elapsed = 0;
+  long int duration = benchmarkDuration * NSECS_PER_MSEC;
+
+  /* one untimed pass to get any lazily built state out of the way */
+  benchmark->run(content);
+  if (benchmark->reset) benchmark->reset();
+
+#ifdef PERFTEST_COUNT_ALLOCATIONS
+  allocations = allocationCount;
+#endif /* PERFTEST_COUNT_ALLOCATIONS */
+
+  do {
+    TimeValue start;
+    TimeValue end;
+
+    getMonotonicTime(&start);
+    operations += benchmark->run(content);
+    getMonotonicTime(&end);
+
+    elapsed += getNanosecondsBetween(&start, &end);
+    if (benchmark->reset) benchmark->reset();
+  } while (elapsed < duration);
+
+#ifdef PERFTEST_COUNT_ALLOCATIONS
+  allocations = allocationCount - allocations;
+#else /* PERFTEST_COUNT_ALLOCATIONS */
+  allocations = 0;
+#endif /* PERFTEST_COUNT_ALLOCATIONS */
+
+  {
+    double nanoseconds = (double)elapsed / (double)operations;
+    double allocationsPerOperation = (double)allocations / (double)operations;
+
+    if (opt_writeBaseline) {
+      printf("%-24s %-16s %10.1f %8.2f\n",
+             benchmark->name, content->name,
+             nanoseconds, allocationsPerOperation);
+    } else {
+      const BaselineEntry *baseline = findBaselineEntry(benchmark->name, content->name);
+      const char *verdict = "";
+
+      printf("%-24s %-16s %-6s %10.1f", benchmark->name, content->name, benchmark->unit, nanoseconds);
+
+      if (baseline) {
+        printf(" %10.1f %+6.0f%%", baseline->nanoseconds, ((nanoseconds / baseline->nanoseconds) - 1.0) * 100.0);
+      } else {
+        printf(" %10s %7s", "-", "-");
+      }
+
+#ifdef PERFTEST_COUNT_ALLOCATIONS
+      printf(" %8.2f", allocationsPerOperation);
+
+      if (baseline) {
+        printf(" %8.2f", baseline->allocations);
+      } else {
+        printf(" %8s", "-");
+      }
+#endif /* PERFTEST_COUNT_ALLOCATIONS */
+
+      if (baseline) {
+#ifdef PERFTEST_COUNT_ALLOCATIONS
+        if (allocationsPerOperation > (baseline->allocations + 0.005)) {
+          verdict = "more allocations";
+          regressionCount += 1;
+        } else
+#endif /* PERFTEST_COUNT_ALLOCATIONS */
+
+        if (nanoseconds > (baseline->nanoseconds * (100 + slowerTolerance) / 100)) {
+          verdict = "slower";
+          regressionCount += 1;
+        }
+      }
+
+      printf("  %s\n", verdict);
+    }
+  }
+}
+
+static int
+prepareScreenContent (ScreenContent *content) {
+  size_t count = content->rows * SCREEN_COLUMNS;
+
+  if ((content->contracted.cells = malloc(ARRAY_SIZE(content->contracted.cells, count)))) {
+    if ((content->contracted.offsets = malloc(ARRAY_SIZE(content->contracted.offsets, count)))) {
+      if ((content->contracted.lengths = malloc(ARRAY_SIZE(content->contracted.lengths, content->rows)))) {
+        for (unsigned int row=0; row<content->rows; row+=1) {
+          const ScreenCharacter *characters = getScreenRow(content, row);
+          wchar_t text[SCREEN_COLUMNS];
+          int inputLength = SCREEN_COLUMNS;
+          int outputLength = SCREEN_COLUMNS;
+
+          for (unsigned int column=0; column<SCREEN_COLUMNS; column+=1) {
+            text[column] = characters[column].text;
+          }
+
+          contractText(benchmarkContractionTable,
+                       text, &inputLength,
+                       &content->contracted.cells[row * SCREEN_COLUMNS], &outputLength,
+                       &content->contracted.offsets[row * SCREEN_COLUMNS], CTB_NO_CURSOR);
+
+          while (inputLength < SCREEN_COLUMNS) {
+            content->contracted.offsets[(row * SCREEN_COLUMNS) + inputLength++] = CTB_NO_OFFSET;
+          }
+
+          memset(&content->contracted.cells[(row * SCREEN_COLUMNS) + outputLength], 0, SCREEN_COLUMNS - outputLength);
+          content->contracted.lengths[row] = outputLength;
+        }
+
+        return 1;
+      }
+
+      free(content->contracted.offsets);
+    }
+
+    free(content->contracted.cells);
+  }
+
+  logMallocError();
+  return 0;
+}
+
+static void
+destroyScreenContent (ScreenContent *content) {
+  free(content->contracted.lengths);
+  free(content->contracted.offsets);
+  free(content->contracted.cells);
+  free(content->characters);
+}
+
+static ScreenCharacter *
+allocateScreenCharacters (unsigned int rows) {
+  size_t count = rows * SCREEN_COLUMNS;
+  ScreenCharacter *characters = malloc(ARRAY_SIZE(characters, count));
+
+  if (characters) {
+    clearScreenCharacters(characters, count);
+  } else {
+    logMallocError();
+  }
+
+  return characters;
+}
+
+static int
+makeSyntheticContent (ScreenContent *content) {
+  static const wchar_t *const words[] = {
+    WS_C("the"), WS_C("braille"), WS_C("display"), WS_C("shows"),
+    WS_C("one"), WS_C("line"), WS_C("of"), WS_C("screen"), WS_C("at"),
+    WS_C("a"), WS_C("time"), WS_C("and"), WS_C("cursor"), WS_C("routing"),
+    WS_C("keys"), WS_C("move"), WS_C("it"), WS_C("Mielke"), WS_C("BRLTTY"),
+    WS_C("README"), WS_C("2017"), WS_C("0x7F"), WS_C("$HOME/.profile"),
+    WS_C("caf\xE9"), WS_C("na\xEFve"), WS_C("\x3B1\x3B2\x3B3"),
+    WS_C("\x65E5\x672C\x8A9E"), WS_C("\x2500\x2500\x2524"), WS_C("\x2022"),
+  };
+
+  static const unsigned char colours[] = {
+    SCR_COLOUR_FG_LIGHT_GREY | SCR_COLOUR_BG_BLACK,
+    SCR_COLOUR_FG_WHITE | SCR_COLOUR_BG_BLACK,
+    SCR_COLOUR_FG_BLACK | SCR_COLOUR_BG_LIGHT_GREY,
+    SCR_COLOUR_FG_LIGHT_GREY | SCR_COLOUR_BG_BLUE,
+    SCR_COLOUR_FG_YELLOW | SCR_COLOUR_BG_BLUE,
+  };
+
+  unsigned int seed = 1;
+
+  if (!(content->characters = allocateScreenCharacters(SYNTHETIC_ROWS))) return 0;
+  content->name = "synthetic";
+  content->rows = SYNTHETIC_ROWS;
+
+  for (unsigned int row=0; row<content->rows; row+=1) {
+    ScreenCharacter *characters = getScreenRow(content, row);
+    unsigned int column = 0;
+    unsigned char attributes = colours[0];
+
+    while (column < SCREEN_COLUMNS) {
+      seed = (seed * 1103515245) + 12345;
+
+      {
+        const wchar_t *word = words[(seed >> 16) % ARRAY_COUNT(words)];
+
+        if (!((seed >> 8) % 5)) attributes = colours[(seed >> 4) % ARRAY_COUNT(colours)];
+
+        while (*word && (column < SCREEN_COLUMNS)) {
+          ScreenCharacter *character = &characters[column++];
+
+          character->text = *word++;
+          character->attributes = attributes;
+        }
+      }
+
+      if (column < SCREEN_COLUMNS) {
+        ScreenCharacter *character = &characters[column++];
+
+        character->text = WC_C(' ');
+        character->attributes = attributes;
+      }
+    }
+  }
+
+  return 1;
+}
+
+typedef struct {
+  ScreenContent *content;
+  unsigned int size;
+} RecordedContentData;
+
+static int
+handleRecordedLine (char *line, void *data) {
+  RecordedContentData *rcd = data;
+  ScreenContent *content = rcd->content;
+
+  if (content->rows == RECORDED_ROWS_LIMIT) return 1;
+
+  if (content->rows == rcd->size) {
+    unsigned int newSize = rcd->size? rcd->size<<1: 0X40;
+    size_t count = newSize * SCREEN_COLUMNS;
+    ScreenCharacter *newCharacters = realloc(content->characters, ARRAY_SIZE(newCharacters, count));
+
+    if (!newCharacters) {
+      logMallocError();
+      return 0;
+    }
+
+    content->characters = newCharacters;
+    rcd->size = newSize;
+  }
+
+  {
+    ScreenCharacter *characters = getScreenRow(content, content->rows++);
+    const char *byte = line;
+    size_t bytes = strlen(line);
+    unsigned int column = 0;
+
+    clearScreenCharacters(characters, SCREEN_COLUMNS);
+
+    while (bytes && (column < SCREEN_COLUMNS)) {
+      wint_t character = convertUtf8ToWchar(&byte, &bytes);
+
+      if (character == WEOF) break;
+      if (character == WC_C('\t')) character = WC_C(' ');
+      characters[column++].text = character;
+    }
+  }
+
+  return 1;
+}
+
+static int
+loadRecordedContent (ScreenContent *content, const char *path) {
+  FILE *stream = openFile(path, "r", 0);
+  int ok = 0;
+
+  if (stream) {
+    RecordedContentData rcd = {
+      .content = content,
+      .size = 0
+    };
+
+    content->name = locatePathName(path);
+    content->characters = NULL;
+    content->rows = 0;
+
+    if (processLines(stream, handleRecordedLine, &rcd)) {
+      if (content->rows) {
+        ok = 1;
+      } else {
+        logMessage(LOG_ERR, "%s: %s", "no recorded screen content", path);
+      }
+    }
+
+    if (!ok && content->characters) free(content->characters);
+    fclose(stream);
+  }
+
+  return ok;
+}
+
+static void
+runScreenBenchmarks (ScreenContent *content) {
+  if (prepareScreenContent(content)) {
+    for (unsigned int index=0; index<ARRAY_COUNT(benchmarkTable); index+=1) {
+      const BenchmarkEntry *benchmark = &benchmarkTable[index];
+
+      if (benchmark->screenContent) runBenchmark(benchmark, content);
+    }
+
+    destroyScreenContent(content);
+  }
+}
+
+static void
+runStandaloneBenchmarks (void) {
+  for (unsigned int index=0; index<ARRAY_COUNT(benchmarkTable); index+=1) {
+    const BenchmarkEntry *benchmark = &benchmarkTable[index];
+
+    if (!benchmark->screenContent) {
+      ScreenContent content = {
+        .name = benchmark->content
+      };
+
+      if (benchmark->prepare && !benchmark->prepare()) {
+        logMessage(LOG_WARNING, "%s: %s", "benchmark not prepared", benchmark->name);
+        continue;
+      }
+
+      runBenchmark(benchmark, &content);
+      if (benchmark->finish) benchmark->finish();
+    }
+  }
+}
+
+static int
+loadTables (void) {
+  const char *directory = opt_tablesDirectory;
+  char *path;
+
+  if ((path = makeTextTablePath(directory, opt_textTable))) {
+    benchmarkTextTable = compileTextTable(path);
+    free(path);
+  }
+  if (!benchmarkTextTable) return 0;
+  textTable = benchmarkTextTable;
+
+  if ((path = makeAttributesTablePath(directory, opt_attributesTable))) {
+    benchmarkAttributesTable = compileAttributesTable(path);
+    free(path);
+  }
+  if (!benchmarkAttributesTable) return 0;
+  attributesTable = benchmarkAttributesTable;
+
+  if ((path = makeContractionTablePath(directory, opt_contractionTable))) {
+    benchmarkContractionTable = compileContractionTable(path);
+    free(path);
+  }
+  if (!benchmarkContractionTable) return 0;
+
+  if ((path = makeKeyboardTablePath(directory, opt_keyboardTable))) {
+    benchmarkKeyTable = compileKeyTable(path, KEY_NAME_TABLES(keyboard));
+    free(path);
+  }
+  if (!benchmarkKeyTable) return 0;
+
+  return 1;
+}
+
+static void
+destroyTables (void) {
+  if (benchmarkKeyTable) destroyKeyTable(benchmarkKeyTable);
+  if (benchmarkContractionTable) destroyContractionTable(benchmarkContractionTable);
+  if (benchmarkAttributesTable) destroyAttributesTable(benchmarkAttributesTable);
+  if (benchmarkTextTable) destroyTextTable(benchmarkTextTable);
+}
+
+int
+main (int argc, char *argv[]) {
+  ProgramExitStatus exitStatus = PROG_EXIT_FATAL;
+
+  {
+    static const OptionsDescriptor descriptor = {
+      OPTION_TABLE(programOptions),
+      .applicationName = "perftest",
+      .argumentsSummary = "[recorded-screen-file ...]"
+    };
+
+    PROCESS_OPTIONS(descriptor, argc, argv);
+  }
+
+  {
+    static const int minimum = 1;
+
+    if (!validateInteger(&benchmarkDuration, opt_benchmarkDuration, &minimum, NULL)) {
+      logMessage(LOG_ERR, "%s: %s", "invalid duration", opt_benchmarkDuration);
+      return PROG_EXIT_SYNTAX;
+    }
+  }
+
+  {
+    static const int minimum = 0;
+
+    if (!validateInteger(&slowerTolerance, opt_slowerTolerance, &minimum, NULL)) {
+      logMessage(LOG_ERR, "%s: %s", "invalid slower tolerance", opt_slowerTolerance);
+      return PROG_EXIT_SYNTAX;
+    }
+  }
+
+  if (opt_baselineFile && *opt_baselineFile) {
+    if (!loadBaseline(opt_baselineFile)) return PROG_EXIT_FATAL;
+  }
+
+  resetPreferences();
+  prefs.showAttributes = 1;
+  blinkVisible = 1;
+
+  beginCommandQueue();
+  pushCommandHandler("perftest", KTB_CTX_DEFAULT,
+                     handleBenchmarkCommand, NULL, NULL);
+
+  if (loadTables()) {
+    ScreenContent content;
+
+    exitStatus = PROG_EXIT_SUCCESS;
+
+    if (opt_writeBaseline) {
+      printf("# regenerate with \"make bench-baseline\" in the Programs directory\n");
+      printf("# %-22s %-16s %10s %8s\n", "benchmark", "content", "ns/op", "allocs");
+    } else {
+      printf("%-24s %-16s %-6s %10s %10s %7s",
+             "benchmark", "content", "op", "ns/op", "baseline", "change");
+
+#ifdef PERFTEST_COUNT_ALLOCATIONS
+      printf(" %8s %8s", "allocs", "baseline");
+#endif /* PERFTEST_COUNT_ALLOCATIONS */
+
+      printf("\n");
+    }
+
+    if (makeSyntheticContent(&content)) {
+      runScreenBenchmarks(&content);
+    } else {
+      exitStatus = PROG_EXIT_FATAL;
+    }
+
+    while (argc) {
+      if (loadRecordedContent(&content, *argv)) {
+        runScreenBenchmarks(&content);
+      } else {
+        exitStatus = PROG_EXIT_FATAL;
+      }
+
+      argv += 1, argc -= 1;
+    }
+
+    runStandaloneBenchmarks();
+
+    if (regressionCount) {
+      logMessage(LOG_WARNING, "benchmarks regressed: %u", regressionCount);
+      if (exitStatus == PROG_EXIT_SUCCESS) exitStatus = PROG_EXIT_SEMANTIC;
+    }
+  }
+
+  destroyTables();
+  endCommandQueue();
+  return exitStatus;
+}
+
+#include "scr.h"
+
+KeyTableCommandContext
+getScreenCommandContext (void) {
+  return KTB_CTX_DEFAULT;
+}
+
+#include "alert.h"
+
+void
+alert (AlertIdentifier identifier) {
+}
+
+#include "pcm.h"
+
+/* A PCM device (in place of the platform's) which takes whatever is written. */
+struct PcmDeviceStruct {
+  int sampleRate;
+  int channelCount;
+  PcmAmplitudeFormat amplitudeFormat;
+};
+
+PcmDevice *
+openPcmDevice (int errorLevel, const char *device) {
+  static PcmDevice pcm = {
+    .sampleRate = 16000,
+    .channelCount = 1,
+    .amplitudeFormat = PCM_FMT_S16N
+  };
+
+  return &pcm;
+}
+
+void
+closePcmDevice (PcmDevice *pcm) {
+}
+
+int
+writePcmData (PcmDevice *pcm, const unsigned char *buffer, int count) {
+  alertBytesWritten += count;
+  return 1;
+}
+
+int
+getPcmBlockSize (PcmDevice *pcm) {
+  return 0X400;
+}
+
+int
+getPcmSampleRate (PcmDevice *pcm) {
+  return pcm->sampleRate;
+}
+
+int
+setPcmSampleRate (PcmDevice *pcm, int rate) {
+  return pcm->sampleRate = rate;
+}
+
+int
+getPcmChannelCount (PcmDevice *pcm) {
+  return pcm->channelCount;
+}
+
+int
+setPcmChannelCount (PcmDevice *pcm, int channels) {
+  return pcm->channelCount = channels;
+}
+
+PcmAmplitudeFormat
+getPcmAmplitudeFormat (PcmDevice *pcm) {
+  return pcm->amplitudeFormat;
+}
+
+PcmAmplitudeFormat
+setPcmAmplitudeFormat (PcmDevice *pcm, PcmAmplitudeFormat format) {
+  return pcm->amplitudeFormat = format;
+}
+
+void
+forcePcmOutput (PcmDevice *pcm) {
+}
+
+void
+awaitPcmOutput (PcmDevice *pcm) {
+}
+
+void
+cancelPcmOutput (PcmDevice *pcm) {
+}
@@ -94,6 +94,10 @@ PREFERENCE_STRING_TABLE(sayLineMode,
   "immediate", "enqueue"
 )
 
+PREFERENCE_STRING_TABLE(autospeakRegion,
+  "line", "window", "screen"
+)
+
 PREFERENCE_STRING_TABLE(timeFormat,
   "24hour", "12hour"
 )
@@ -497,6 +501,12 @@ const PreferenceEntry preferenceTable[] = {
     .setting = &prefs.autospeakCompletedWords
   },
 
+  { .name = "autospeak-region",
+    .defaultValue = DEFAULT_AUTOSPEAK_REGION,
+    .settingNames = &preferenceStringTable_autospeakRegion,
+    .setting = &prefs.autospeakRegion
+  },
+
   { .name = "show-speech-cursor",
     .defaultValue = DEFAULT_SHOW_SPEECH_CURSOR,
     .settingNames = &preferenceStringTable_boolean,
@@ -0,0 +1,1038 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2017 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+/* This program plays back a screen recording (see scr_record.h) through a
+ * brltty which is using the Replay screen driver and the Virtual braille
+ * driver. Screen snapshots are written into the screen export segment which
+ * the Replay driver follows, and commands are sent as if they had come from
+ * the (virtual) braille display, both at their recorded times. The latency
+ * of each event is how long it takes for the braille window to change -
+ * i.e. for the next Braille or Visual line to arrive from the driver. An
+ * event is missed if that doesn't happen within the timeout or before the
+ * next event is played.
+ */
+
+#include "prologue.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#if !defined(AF_LOCAL) && defined(AF_UNIX)
+#define AF_LOCAL AF_UNIX
+#endif /* !defined(AF_LOCAL) && defined(AF_UNIX) */
+
+#include "program.h"
+#include "options.h"
+#include "log.h"
+#include "parse.h"
+#include "file.h"
+#include "charset.h"
+#include "timing.h"
+#include "cmd.h"
+#include "brl_cmds.h"
+#include "scr.h"
+#include "scr_export.h"
+#include "scr_record.h"
+
+static char *opt_brlttyProgram;
+static char *opt_driversDirectory;
+static char *opt_tablesDirectory;
+static char *opt_socketPath;
+static char *opt_segmentName;
+static char *opt_cellCount;
+static char *opt_eventTimeout;
+static char *opt_settleTime;
+
+BEGIN_OPTION_TABLE(programOptions)
+  { .letter = 'b',
+    .word = "brltty",
+    .argument = "program",
+    .setting.string = &opt_brlttyProgram,
+    .description = "Start (and stop) this brltty rather than waiting for one to connect."
+  },
+
+  { .letter = 'D',
+    .word = "drivers-directory",
+    .flags = OPT_Hidden,
+    .argument = "directory",
+    .setting.string = &opt_driversDirectory,
+    .description = "Path to directory for loading drivers (passed to brltty)."
+  },
+
+  { .letter = 'T',
+    .word = "tables-directory",
+    .flags = OPT_Hidden,
+    .argument = "directory",
+    .setting.string = &opt_tablesDirectory,
+    .description = "Path to directory containing tables (passed to brltty)."
+  },
+
+  { .letter = 's',
+    .word = "socket",
+    .argument = "path",
+    .setting.string = &opt_socketPath,
+    .internal.setting = "/tmp/brltty-replay.socket",
+    .description = "Path to the socket which the Virtual braille driver connects to."
+  },
+
+  { .letter = 'S',
+    .word = "segment",
+    .argument = "name",
+    .setting.string = &opt_segmentName,
+    .internal.setting = "brltty-replay",
+    .description = "Name of the screen export segment which the Replay screen driver follows."
+  },
+
+  { .letter = 'c',
+    .word = "cells",
+    .argument = "count",
+    .setting.string = &opt_cellCount,
+    .internal.setting = "40",
+    .description = "Length of the virtual braille display."
+  },
+
+  { .letter = 't',
+    .word = "timeout",
+    .argument = "milliseconds",
+    .setting.string = &opt_eventTimeout,
+    .internal.setting = "1000",
+    .description = "How long to wait for the braille window to change after an event."
+  },
+
+  { .letter = 'w',
+    .word = "settle",
+    .argument = "milliseconds",
+    .setting.string = &opt_settleTime,
+    .internal.setting = "500",
+    .description = "How quiet the display must be before playback starts."
+  },
+END_OPTION_TABLE
+
+/* scr_export.o refers to this but only calls it from exportScreen. */
+int
+readScreen (short left, short top, short width, short height, ScreenCharacter *buffer) {
+  return 0;
+}
+
+typedef enum {
+  EVENT_SCREEN,
+  EVENT_COMMAND
+} EventType;
+
+typedef struct {
+  unsigned int index;
+  ScreenCharacter *characters;
+} RecordedRow;
+
+typedef struct {
+  EventType type;
+  long int time;
+
+  union {
+    struct {
+      ScreenDescription description;
+      RecordedRow *rows;
+      unsigned int rowCount;
+    } screen;
+
+    int command;
+  } value;
+} RecordedEvent;
+
+typedef struct {
+  const char *path;
+  unsigned int line;
+
+  RecordedEvent *events;
+  unsigned int size;
+  unsigned int count;
+} Recording;
+
+static void
+logRecordingError (const Recording *recording, const char *format, ...) {
+  char message[0X100];
+
+  {
+    va_list arguments;
+
+    va_start(arguments, format);
+    vsnprintf(message, sizeof(message), format, arguments);
+    va_end(arguments);
+  }
+
+  logMessage(LOG_ERR, "%s[%u]: %s", recording->path, recording->line, message);
+}
+
+static RecordedEvent *
+addRecordedEvent (Recording *recording, EventType type, long int time) {
+  if (recording->count == recording->size) {
+    unsigned int size = recording->size? (recording->size << 1): 0X100;
+    RecordedEvent *events = realloc(recording->events, ARRAY_SIZE(events, size));
+
+    if (!events) {
+      logMallocError();
+      return NULL;
+    }
+
+    recording->events = events;
+    recording->size = size;
+  }
+
+  {
+    RecordedEvent *event = &recording->events[recording->count++];
+
+    memset(event, 0, sizeof(*event));
+    event->type = type;
+    event->time = time;
+    return event;
+  }
+}
+
+static int
+parseRecordedText (const char **string, ScreenCharacter *characters, unsigned int count) {
+  const char *byte = *string;
+  unsigned int column = 0;
+
+  if (*byte++ != '"') return 0;
+
+  while (*byte != '"') {
+    wint_t character;
+
+    if (!*byte) return 0;
+    if (column == count) return 0;
+
+    if (*byte == '\\') {
+      byte += 1;
+
+      if ((*byte == 'X') || (*byte == 'U')) {
+        int digits = (*byte == 'X')? 2: 8;
+        char buffer[digits + 1];
+        char *end;
+
+        if ((int)strnlen(byte+1, digits) != digits) return 0;
+        memcpy(buffer, byte+1, digits);
+        buffer[digits] = 0;
+
+        character = strtoul(buffer, &end, 0X10);
+        if (*end) return 0;
+        byte += 1 + digits;
+      } else if (*byte) {
+        character = *byte++;
+      } else {
+        return 0;
+      }
+    } else {
+      size_t length = strlen(byte);
+
+      if ((character = convertUtf8ToWchar(&byte, &length)) == WEOF) return 0;
+    }
+
+    characters[column++].text = character;
+  }
+
+  *string = byte + 1;
+  return column == count;
+}
+
+static int
+parseRecordedRow (Recording *recording, RecordedEvent *event, const char *operands) {
+  const ScreenDescription *description = &event->value.screen.description;
+  unsigned int columns = description->cols;
+  unsigned int index;
+  int length;
+
+  if ((sscanf(operands, "%u %n", &index, &length) < 1) || (index >= description->rows)) {
+    logRecordingError(recording, "invalid row index");
+    return 0;
+  }
+  operands += length;
+
+  {
+    ScreenCharacter *characters = calloc(columns, sizeof(*characters));
+
+    if (!characters) {
+      logMallocError();
+      return 0;
+    }
+
+    for (unsigned int column=0; column<columns; column+=1) {
+      unsigned int attributes;
+
+      if (sscanf(operands, "%2x", &attributes) < 1) {
+        logRecordingError(recording, "invalid row attributes");
+        free(characters);
+        return 0;
+      }
+
+      characters[column].attributes = attributes;
+      operands += 2;
+    }
+
+    if ((*operands++ != ' ') || !parseRecordedText(&operands, characters, columns)) {
+      logRecordingError(recording, "invalid row text");
+      free(characters);
+      return 0;
+    }
+
+    {
+      unsigned int count = event->value.screen.rowCount;
+      RecordedRow *rows = realloc(event->value.screen.rows, ARRAY_SIZE(rows, count+1));
+
+      if (!rows) {
+        logMallocError();
+        free(characters);
+        return 0;
+      }
+
+      rows[count].index = index;
+      rows[count].characters = characters;
+      event->value.screen.rows = rows;
+      event->value.screen.rowCount = count + 1;
+    }
+  }
+
+  return 1;
+}
+
+static int
+handleRecordingLine (char *line, void *data) {
+  Recording *recording = data;
+  char keyword[0X10];
+  long int time;
+  int length;
+
+  if (!recording->line++) {
+    if (strcmp(line, SCREEN_RECORDING_HEADER) == 0) return 1;
+    logRecordingError(recording, "not a screen recording");
+    return 0;
+  }
+
+  if (sscanf(line, "%15s %n", keyword, &length) < 1) return 1;
+
+  if (strcmp(keyword, "row") == 0) {
+    RecordedEvent *event = recording->count? &recording->events[recording->count-1]: NULL;
+
+    if (!event || (event->type != EVENT_SCREEN)) {
+      logRecordingError(recording, "row not within a screen");
+      return 0;
+    }
+
+    return parseRecordedRow(recording, event, line+length);
+  }
+
+  line += length;
+  if (sscanf(line, "%ld %n", &time, &length) < 1) {
+    logRecordingError(recording, "missing time");
+    return 0;
+  }
+  line += length;
+
+  if (strcmp(keyword, "screen") == 0) {
+    ScreenDescription description;
+    int cursor;
+
+    memset(&description, 0, sizeof(description));
+
+    if ((sscanf(line, "%d %hd %hd %hd %hd %d",
+                &description.number, &description.cols, &description.rows,
+                &description.posx, &description.posy, &cursor) < 6) ||
+        (description.cols < 1) || (description.rows < 1)) {
+      logRecordingError(recording, "invalid screen description");
+      return 0;
+    }
+
+    description.cursor = cursor;
+
+    {
+      RecordedEvent *event = addRecordedEvent(recording, EVENT_SCREEN, time);
+      if (!event) return 0;
+      event->value.screen.description = description;
+    }
+  } else if (strcmp(keyword, "command") == 0) {
+    unsigned int command;
+
+    if (sscanf(line, "%x", &command) < 1) {
+      logRecordingError(recording, "invalid command");
+      return 0;
+    }
+
+    {
+      RecordedEvent *event = addRecordedEvent(recording, EVENT_COMMAND, time);
+      if (!event) return 0;
+      event->value.command = command;
+    }
+  } else {
+    logRecordingError(recording, "unknown event: %s", keyword);
+    return 0;
+  }
+
+  return 1;
+}
+
+static void
+destroyRecording (Recording *recording) {
+  for (unsigned int index=0; index<recording->count; index+=1) {
+    RecordedEvent *event = &recording->events[index];
+
+    if (event->type == EVENT_SCREEN) {
+      for (unsigned int row=0; row<event->value.screen.rowCount; row+=1) {
+        free(event->value.screen.rows[row].characters);
+      }
+
+      if (event->value.screen.rows) free(event->value.screen.rows);
+    }
+  }
+
+  if (recording->events) free(recording->events);
+  memset(recording, 0, sizeof(*recording));
+}
+
+static int
+loadRecording (Recording *recording, const char *path) {
+  FILE *file;
+
+  memset(recording, 0, sizeof(*recording));
+  recording->path = path;
+
+  if ((file = openFile(path, "r", 0))) {
+    int ok = processLines(file, handleRecordingLine, recording) && recording->line;
+
+    fclose(file);
+
+    if (ok) {
+      if (recording->count && (recording->events[0].type == EVENT_SCREEN)) return 1;
+      logMessage(LOG_ERR, "%s: recording doesn't start with a screen", path);
+    }
+  }
+
+  destroyRecording(recording);
+  return 0;
+}
+
+/* The Virtual braille driver takes a command's name and, for a command which
+ * takes an argument, a number which is added to the first command within its
+ * block. An argument at (or before) that first command can't be sent.
+ */
+static int
+formatCommand (char *buffer, size_t size, int command) {
+  int code = command & BRL_MSK_CMD;
+  int block = code & BRL_MSK_BLK;
+  const CommandEntry *exact = NULL;
+  const CommandEntry *first = NULL;
+
+  for (const CommandEntry *entry=commandTable; entry->name; entry+=1) {
+    if ((entry->code & BRL_MSK_BLK) != block) continue;
+    if (entry->code == code) exact = entry;
+    if (!first || (entry->code < first->code)) first = entry;
+  }
+
+  if (!block) {
+    if (!exact) return 0;
+
+    /* The driver would disconnect from (and then reconnect to) the display. */
+    if (code == BRL_CMD_RESTARTBRL) return 0;
+
+    snprintf(buffer, size, "%s%s\n", exact->name,
+             ((command & BRL_FLG_TOGGLE_ON)? " on":
+              (command & BRL_FLG_TOGGLE_OFF)? " off": ""));
+    return 1;
+  }
+
+  if (exact && (exact != first)) {
+    snprintf(buffer, size, "%s\n", exact->name);
+    return 1;
+  }
+
+  if (first && (code > first->code)) {
+    snprintf(buffer, size, "%s %d\n", first->name, code - first->code);
+    return 1;
+  }
+
+  return 0;
+}
+
+typedef struct {
+  const char *name;
+  long int *latencies;
+  unsigned int size;
+  unsigned int count;
+  unsigned int events;
+  unsigned int unanswered;
+} LatencyStatistics;
+
+static LatencyStatistics commandLatencies = {.name = "key-to-display"};
+static LatencyStatistics screenLatencies = {.name = "screen-to-display"};
+
+static void
+addLatency (LatencyStatistics *statistics, long int latency) {
+  if (statistics->count == statistics->size) {
+    unsigned int size = statistics->size? (statistics->size << 1): 0X100;
+    long int *latencies = realloc(statistics->latencies, ARRAY_SIZE(latencies, size));
+
+    if (!latencies) {
+      logMallocError();
+      return;
+    }
+
+    statistics->latencies = latencies;
+    statistics->size = size;
+  }
+
+  statistics->latencies[statistics->count++] = latency;
+}
+
+static int
+compareLatencies (const void *item1, const void *item2) {
+  const long int *latency1 = item1;
+  const long int *latency2 = item2;
+
+  if (*latency1 < *latency2) return -1;
+  if (*latency1 > *latency2) return 1;
+  return 0;
+}
+
+static long int
+getPercentile (const LatencyStatistics *statistics, unsigned int percent) {
+  unsigned int rank = ((statistics->count * percent) + 99) / 100;
+
+  if (rank < 1) rank = 1;
+  return statistics->latencies[rank - 1];
+}
+
+static void
+showLatencies (LatencyStatistics *statistics) {
+  printf("%-18s %6u %6u %6u", statistics->name,
+         statistics->events, statistics->count, statistics->unanswered);
+
+  if (statistics->count) {
+    qsort(statistics->latencies, statistics->count,
+          sizeof(*statistics->latencies), compareLatencies);
+
+    printf(" %6ld %6ld %6ld %6ld",
+           getPercentile(statistics, 50), getPercentile(statistics, 90),
+           getPercentile(statistics, 99), statistics->latencies[statistics->count-1]);
+  } else {
+    printf(" %6s %6s %6s %6s", "-", "-", "-", "-");
+  }
+
+  printf("\n");
+}
+
+typedef struct {
+  int socket;
+  char input[0X1000];
+  size_t inputLength;
+
+  TimeValue start;
+  long int timeout;
+
+  LatencyStatistics *pendingStatistics;
+  long int pendingTime;
+
+  ScreenDescription description;
+  ScreenCharacter *characters;
+  size_t charactersSize;
+
+  unsigned int unsentCommands;
+} ReplayState;
+
+static long int
+getReplayTime (ReplayState *state) {
+  return getMonotonicElapsed(&state->start);
+}
+
+static void
+setPendingEvent (ReplayState *state, LatencyStatistics *statistics) {
+  /* A change can't be attributed to an event once another has been played. */
+  if (state->pendingStatistics) state->pendingStatistics->unanswered += 1;
+
+  state->pendingStatistics = statistics;
+  state->pendingTime = getReplayTime(state);
+  statistics->events += 1;
+}
+
+static void
+answerPendingEvent (ReplayState *state) {
+  if (state->pendingStatistics) {
+    addLatency(state->pendingStatistics, getReplayTime(state) - state->pendingTime);
+    state->pendingStatistics = NULL;
+  }
+}
+
+static long int
+expirePendingEvent (ReplayState *state) {
+  if (state->pendingStatistics) {
+    long int expiry = state->pendingTime + state->timeout;
+
+    if (expiry > getReplayTime(state)) return expiry;
+    state->pendingStatistics->unanswered += 1;
+    state->pendingStatistics = NULL;
+  }
+
+  return LONG_MAX;
+}
+
+static int
+writeDisplayLine (ReplayState *state, const char *line) {
+  size_t length = strlen(line);
+
+  while (length) {
+    ssize_t count = send(state->socket, line, length, 0);
+
+    if (count == -1) {
+      if (errno == EINTR) continue;
+      logSystemError("send");
+      return 0;
+    }
+
+    line += count;
+    length -= count;
+  }
+
+  return 1;
+}
+
+static int
+readDisplayLines (ReplayState *state, int *changed) {
+  ssize_t count = recv(state->socket, &state->input[state->inputLength],
+                       sizeof(state->input) - state->inputLength, 0);
+
+  if (count == -1) {
+    if (errno == EINTR) return 1;
+    logSystemError("recv");
+    return 0;
+  }
+
+  if (count == 0) {
+    logMessage(LOG_ERR, "braille driver disconnected");
+    return 0;
+  }
+
+  state->inputLength += count;
+
+  {
+    char *line = state->input;
+    char *end;
+
+    while ((end = memchr(line, '\n', &state->input[state->inputLength] - line))) {
+      *end = 0;
+      logMessage(LOG_DEBUG, "display: %s", line);
+
+      if ((strncmp(line, "Braille ", 8) == 0) || (strncmp(line, "Visual ", 7) == 0)) {
+        *changed = 1;
+      }
+
+      line = end + 1;
+    }
+
+    state->inputLength = &state->input[state->inputLength] - line;
+    memmove(state->input, line, state->inputLength);
+
+    /* A line too long for the buffer can only be a window change. */
+    if (state->inputLength == sizeof(state->input)) {
+      state->inputLength = 0;
+      *changed = 1;
+    }
+  }
+
+  return 1;
+}
+
+static int
+awaitDisplay (ReplayState *state, long int milliseconds, int *changed) {
+  fd_set descriptors;
+  struct timeval timeout;
+
+  FD_ZERO(&descriptors);
+  FD_SET(state->socket, &descriptors);
+
+  timeout.tv_sec = milliseconds / MSECS_PER_SEC;
+  timeout.tv_usec = (milliseconds % MSECS_PER_SEC) * USECS_PER_MSEC;
+
+  switch (select(state->socket+1, &descriptors, NULL, NULL, &timeout)) {
+    case -1:
+      if (errno == EINTR) return 1;
+      logSystemError("select");
+      return 0;
+
+    case 0:
+      return 1;
+
+    default:
+      return readDisplayLines(state, changed);
+  }
+}
+
+static int
+playScreen (ReplayState *state, const RecordedEvent *event) {
+  const ScreenDescription *description = &event->value.screen.description;
+  size_t count = description->cols * description->rows;
+
+  if (count > state->charactersSize) {
+    ScreenCharacter *characters = realloc(state->characters, ARRAY_SIZE(characters, count));
+
+    if (!characters) {
+      logMallocError();
+      return 0;
+    }
+
+    state->characters = characters;
+    state->charactersSize = count;
+  }
+
+  for (unsigned int index=0; index<event->value.screen.rowCount; index+=1) {
+    const RecordedRow *row = &event->value.screen.rows[index];
+
+    memcpy(&state->characters[row->index * description->cols], row->characters,
+           ARRAY_SIZE(row->characters, description->cols));
+  }
+
+  state->description = *description;
+  exportScreenCharacters(&state->description, state->characters);
+  return 1;
+}
+
+static int
+playEvent (ReplayState *state, const RecordedEvent *event) {
+  switch (event->type) {
+    case EVENT_SCREEN:
+      if (!playScreen(state, event)) return 0;
+      setPendingEvent(state, &screenLatencies);
+      return 1;
+
+    case EVENT_COMMAND: {
+      char line[0X80];
+
+      if (!formatCommand(line, sizeof(line), event->value.command)) {
+        logMessage(LOG_DEBUG, "command not sendable: %06X", event->value.command);
+        state->unsentCommands += 1;
+        return 1;
+      }
+
+      if (!writeDisplayLine(state, line)) return 0;
+      setPendingEvent(state, &commandLatencies);
+      return 1;
+    }
+
+    default:
+      return 1;
+  }
+}
+
+static int
+playRecording (ReplayState *state, const Recording *recording) {
+  long int origin = recording->events[0].time;
+  unsigned int index = 1;
+
+  getMonotonicTime(&state->start);
+
+  while ((index < recording->count) || state->pendingStatistics) {
+    long int next = expirePendingEvent(state);
+    long int now = getReplayTime(state);
+
+    if (index < recording->count) {
+      const RecordedEvent *event = &recording->events[index];
+      long int due = event->time - origin;
+
+      if (due <= now) {
+        if (!playEvent(state, event)) return 0;
+        index += 1;
+        continue;
+      }
+
+      if (due < next) next = due;
+    }
+
+    if (next != LONG_MAX) {
+      int changed = 0;
+
+      if (!awaitDisplay(state, next-now, &changed)) return 0;
+      if (changed) answerPendingEvent(state);
+    }
+  }
+
+  return 1;
+}
+
+static int
+settleDisplay (ReplayState *state, long int quiet) {
+  TimeValue start;
+  TimeValue change;
+
+  getMonotonicTime(&start);
+  change = start;
+
+  while (getMonotonicElapsed(&change) < quiet) {
+    int changed = 0;
+
+    if (getMonotonicElapsed(&start) > (quiet * 20)) {
+      logMessage(LOG_ERR, "braille window doesn't settle");
+      return 0;
+    }
+
+    if (!awaitDisplay(state, quiet, &changed)) return 0;
+    if (changed) getMonotonicTime(&change);
+  }
+
+  return 1;
+}
+
+static int
+createDisplaySocket (const char *path) {
+  int listener = socket(AF_LOCAL, SOCK_STREAM, 0);
+
+  if (listener != -1) {
+    struct sockaddr_un address;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_LOCAL;
+
+    if (strlen(path) < sizeof(address.sun_path)) {
+      strcpy(address.sun_path, path);
+      unlink(path);
+
+      if (bind(listener, (struct sockaddr *)&address, sizeof(address)) != -1) {
+        if (listen(listener, 1) != -1) return listener;
+        logSystemError("listen");
+      } else {
+        logSystemError("bind");
+      }
+    } else {
+      logMessage(LOG_ERR, "socket path too long: %s", path);
+    }
+
+    close(listener);
+  } else {
+    logSystemError("socket");
+  }
+
+  return -1;
+}
+
+static int
+acceptDisplayConnection (int listener, int seconds) {
+  fd_set descriptors;
+  struct timeval timeout = {.tv_sec = seconds};
+
+  FD_ZERO(&descriptors);
+  FD_SET(listener, &descriptors);
+
+  switch (select(listener+1, &descriptors, NULL, NULL, &timeout)) {
+    case -1:
+      logSystemError("select");
+      return -1;
+
+    case 0:
+      logMessage(LOG_ERR, "braille driver didn't connect");
+      return -1;
+
+    default: {
+      int connection = accept(listener, NULL, NULL);
+
+      if (connection == -1) logSystemError("accept");
+      return connection;
+    }
+  }
+}
+
+static pid_t
+startBrltty (void) {
+  char device[0X100];
+  char parameters[0X100];
+  const char *arguments[0X20];
+  unsigned int count = 0;
+
+  snprintf(device, sizeof(device), "client:%s", opt_socketPath);
+  snprintf(parameters, sizeof(parameters), "segment=%s", opt_segmentName);
+
+  arguments[count++] = opt_brlttyProgram;
+  arguments[count++] = "-n";
+  arguments[count++] = "-e";
+  arguments[count++] = "-N";
+  arguments[count++] = "-q";
+  arguments[count++] = "-lerror";
+  arguments[count++] = "-f/dev/null";
+  arguments[count++] = "-F/dev/null";
+  arguments[count++] = "-sno";
+  arguments[count++] = "-bvr";
+  arguments[count++] = "-d";
+  arguments[count++] = device;
+  arguments[count++] = "-xrp";
+  arguments[count++] = "-X";
+  arguments[count++] = parameters;
+
+  if (opt_driversDirectory && *opt_driversDirectory) {
+    arguments[count++] = "-D";
+    arguments[count++] = opt_driversDirectory;
+  }
+
+  if (opt_tablesDirectory && *opt_tablesDirectory) {
+    arguments[count++] = "-T";
+    arguments[count++] = opt_tablesDirectory;
+  }
+
+  arguments[count] = NULL;
+
+  {
+    pid_t pid = fork();
+
+    switch (pid) {
+      case -1:
+        logSystemError("fork");
+        break;
+
+      case 0:
+        execv(arguments[0], (char *const *)arguments);
+        logMessage(LOG_ERR, "%s: %s", arguments[0], strerror(errno));
+        _exit(PROG_EXIT_FATAL);
+
+      default:
+        break;
+    }
+
+    return pid;
+  }
+}
+
+static void
+stopBrltty (pid_t pid) {
+  int status;
+
+  kill(pid, SIGTERM);
+
+  for (int attempt=0; attempt<50; attempt+=1) {
+    if (waitpid(pid, &status, WNOHANG) == pid) return;
+    approximateDelay(100);
+  }
+
+  logMessage(LOG_WARNING, "brltty didn't stop - killing it");
+  kill(pid, SIGKILL);
+  waitpid(pid, &status, 0);
+}
+
+int
+main (int argc, char *argv[]) {
+  ProgramExitStatus exitStatus = PROG_EXIT_FATAL;
+  Recording recording;
+  ReplayState state;
+  int cellCount;
+  int settleTime;
+
+  {
+    static const OptionsDescriptor descriptor = {
+      OPTION_TABLE(programOptions),
+      .applicationName = "replaytest",
+      .argumentsSummary = "recording-file"
+    };
+
+    PROCESS_OPTIONS(descriptor, argc, argv);
+  }
+
+  memset(&state, 0, sizeof(state));
+
+  {
+    static const int minimum = 1;
+
+    if (!validateInteger(&cellCount, opt_cellCount, &minimum, NULL)) {
+      logMessage(LOG_ERR, "%s: %s", "invalid cell count", opt_cellCount);
+      return PROG_EXIT_SYNTAX;
+    }
+
+    {
+      int timeout;
+
+      if (!validateInteger(&timeout, opt_eventTimeout, &minimum, NULL)) {
+        logMessage(LOG_ERR, "%s: %s", "invalid timeout", opt_eventTimeout);
+        return PROG_EXIT_SYNTAX;
+      }
+
+      state.timeout = timeout;
+    }
+
+    if (!validateInteger(&settleTime, opt_settleTime, &minimum, NULL)) {
+      logMessage(LOG_ERR, "%s: %s", "invalid settle time", opt_settleTime);
+      return PROG_EXIT_SYNTAX;
+    }
+  }
+
+  if (argc != 1) {
+    logMessage(LOG_ERR, "%s", (argc? "too many parameters": "missing recording file"));
+    return PROG_EXIT_SYNTAX;
+  }
+
+  if (!loadRecording(&recording, argv[0])) return PROG_EXIT_FATAL;
+
+  if (startScreenExport(opt_segmentName)) {
+    if (playScreen(&state, &recording.events[0])) {
+      int listener = createDisplaySocket(opt_socketPath);
+
+      if (listener != -1) {
+        pid_t brltty = 0;
+
+        if (opt_brlttyProgram && *opt_brlttyProgram) brltty = startBrltty();
+
+        if (brltty != -1) {
+          if ((state.socket = acceptDisplayConnection(listener, 10)) != -1) {
+            char line[0X20];
+
+            snprintf(line, sizeof(line), "cells %d\n", cellCount);
+
+            if (writeDisplayLine(&state, line) && settleDisplay(&state, settleTime)) {
+              if (playRecording(&state, &recording)) {
+                printf("%-18s %6s %6s %6s %6s %6s %6s %6s\n", "latency (ms)",
+                       "events", "shown", "missed", "p50", "p90", "p99", "max");
+                showLatencies(&commandLatencies);
+                showLatencies(&screenLatencies);
+
+                if (state.unsentCommands) {
+                  logMessage(LOG_NOTICE, "commands which couldn't be sent: %u", state.unsentCommands);
+                }
+
+                exitStatus = PROG_EXIT_SUCCESS;
+              }
+            }
+
+            if (brltty) stopBrltty(brltty);
+            close(state.socket);
+          } else if (brltty) {
+            stopBrltty(brltty);
+          }
+        }
+
+        close(listener);
+        unlink(opt_socketPath);
+      }
+    }
+
+    stopScreenExport();
+  }
+
+  if (state.characters) free(state.characters);
+  if (commandLatencies.latencies) free(commandLatencies.latencies);
+  if (screenLatencies.latencies) free(screenLatencies.latencies);
+  destroyRecording(&recording);
+  return exitStatus;
+}
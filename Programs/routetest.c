@@ -0,0 +1,424 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2017 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+/* This program routes the cursor (see routing.c) on a fake screen which
+ * behaves like a line editor: the cursor keys move it by one character, a
+ * tab or a wide character spans more than one column, the cursor can't go
+ * past the end of a line, and each key press can be made to take a while.
+ * Each scripted scenario checks where the cursor ends up and how many key
+ * presses it took to get there.
+ */
+
+#include "prologue.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+
+#ifdef SIGUSR1
+#include <sys/mman.h>
+#endif /* SIGUSR1 */
+
+#include "program.h"
+#include "options.h"
+#include "log.h"
+#include "timing.h"
+#include "unicode.h"
+#include "scr.h"
+#include "routing.h"
+
+static char *opt_scenarioName;
+
+BEGIN_OPTION_TABLE(programOptions)
+  { .letter = 's',
+    .word = "scenario",
+    .argument = "name",
+    .setting.string = &opt_scenarioName,
+    .description = "Only run this scenario."
+  },
+END_OPTION_TABLE
+
+#define FAKE_SCREEN_NUMBER 1
+#define FAKE_SCREEN_COLUMNS 40
+#define FAKE_SCREEN_ROWS 5
+#define FAKE_TAB_WIDTH 8
+#define FAKE_KEY_LIMIT 0X400
+
+typedef struct {
+  const char *name;
+  const wchar_t *lines[FAKE_SCREEN_ROWS];
+
+  int startRow;
+  int startIndex;
+  int targetColumn;
+  int targetRow;
+  int keyDelay;
+
+  RoutingStatus status;
+  int column;
+  unsigned int maximumKeys;
+} RoutingScenario;
+
+static const RoutingScenario routingScenarios[] = {
+  { .name = "forward",
+    .lines = {WS_C("the quick brown fox jumps over the lazy")},
+    .startIndex = 0, .targetColumn = 30,
+    .status = ROUTING_DONE, .column = 30, .maximumKeys = 30
+  },
+
+  { .name = "backward",
+    .lines = {WS_C("the quick brown fox jumps over the lazy")},
+    .startIndex = 35, .targetColumn = 4,
+    .status = ROUTING_DONE, .column = 4, .maximumKeys = 31
+  },
+
+  { .name = "tab-past",
+    .lines = {WS_C("a\tb\tc\td")},
+    .startIndex = 0, .targetColumn = 16,
+    .status = ROUTING_DONE, .column = 16
+  },
+
+  { .name = "tab-within",
+    .lines = {WS_C("a\tb\tc\td")},
+    .startIndex = 0, .targetColumn = 11,
+    .status = ROUTING_WRONG_COLUMN, .column = 9
+  },
+
+  { .name = "wide-past",
+    .lines = {WS_C("\x6F22\x5B57\x6F22\x5B57 and more text")},
+    .startIndex = 0, .targetColumn = 12,
+    .status = ROUTING_DONE, .column = 12
+  },
+
+  { .name = "wide-within",
+    .lines = {WS_C("\x6F22\x5B57\x6F22\x5B57 and more text")},
+    .startIndex = 0, .targetColumn = 5,
+    .status = ROUTING_WRONG_COLUMN, .column = 4
+  },
+
+  { .name = "end-of-line",
+    .lines = {WS_C("short")},
+    .startIndex = 0, .targetColumn = 30,
+    .status = ROUTING_WRONG_COLUMN, .column = 5
+  },
+
+  { .name = "other-row",
+    .lines = {WS_C("first line"), WS_C("second line of text"), WS_C("third line of text")},
+    .startRow = 0, .startIndex = 3, .targetColumn = 14, .targetRow = 2,
+    .status = ROUTING_DONE, .column = 14
+  },
+
+  { .name = "slow-responder",
+    .lines = {WS_C("the quick brown fox jumps over the lazy")},
+    .startIndex = 2, .targetColumn = 27, .keyDelay = 40,
+    .status = ROUTING_DONE, .column = 27, .maximumKeys = 25
+  },
+};
+
+/* This is shared with the routing subprocess (if there is one). */
+typedef struct {
+  int row;
+  int index;
+
+  unsigned int keyCount;
+  unsigned int largestBatch;
+
+  unsigned int keyHead;
+  unsigned int keyTail;
+  ScreenKey keys[FAKE_KEY_LIMIT];
+  long int keyTimes[FAKE_KEY_LIMIT];
+} FakeScreen;
+
+static FakeScreen *fakeScreen = NULL;
+static const RoutingScenario *fakeScenario = NULL;
+static TimeValue fakeStart;
+
+static int
+getFakeLineLength (int row) {
+  const wchar_t *line = fakeScenario->lines[row];
+  return line? wcslen(line): 0;
+}
+
+static int
+getFakeColumn (int row, int index) {
+  const wchar_t *line = fakeScenario->lines[row];
+  int column = 0;
+
+  for (int i=0; i<index; i+=1) {
+    wchar_t character = line[i];
+
+    if (character == WC_C('\t')) {
+      column += FAKE_TAB_WIDTH - (column % FAKE_TAB_WIDTH);
+    } else {
+      int width = getCharacterWidth(character);
+      column += (width > 1)? width: 1;
+    }
+  }
+
+  return column;
+}
+
+static int
+getFakeIndex (int row, int column) {
+  int length = getFakeLineLength(row);
+  int index = 0;
+
+  while ((index < length) && (getFakeColumn(row, index+1) <= column)) index += 1;
+  return index;
+}
+
+static void
+pressFakeKey (ScreenKey key) {
+  FakeScreen *fake = fakeScreen;
+  int length = getFakeLineLength(fake->row);
+
+  switch (key) {
+    case SCR_KEY_CURSOR_LEFT:
+      if (fake->index > 0) fake->index -= 1;
+      break;
+
+    case SCR_KEY_CURSOR_RIGHT:
+      if (fake->index < length) fake->index += 1;
+      break;
+
+    case SCR_KEY_CURSOR_UP:
+    case SCR_KEY_CURSOR_DOWN: {
+      int row = fake->row + ((key == SCR_KEY_CURSOR_UP)? -1: 1);
+
+      if ((row >= 0) && (row < FAKE_SCREEN_ROWS)) {
+        int column = getFakeColumn(fake->row, fake->index);
+
+        fake->row = row;
+        fake->index = getFakeIndex(row, column);
+      }
+
+      break;
+    }
+
+    default:
+      break;
+  }
+}
+
+/* The application handles one key press at a time, each taking keyDelay. */
+static void
+processFakeKeys (void) {
+  FakeScreen *fake = fakeScreen;
+  long int now = getMonotonicElapsed(&fakeStart);
+
+  while (fake->keyHead != fake->keyTail) {
+    unsigned int index = fake->keyHead % FAKE_KEY_LIMIT;
+
+    if (fake->keyTimes[index] > now) break;
+    pressFakeKey(fake->keys[index]);
+    fake->keyHead += 1;
+  }
+}
+
+int
+insertScreenKey (ScreenKey key) {
+  FakeScreen *fake = fakeScreen;
+  long int now = getMonotonicElapsed(&fakeStart);
+  unsigned int pending = fake->keyTail - fake->keyHead;
+
+  if (pending == FAKE_KEY_LIMIT) return 0;
+
+  {
+    unsigned int index = fake->keyTail % FAKE_KEY_LIMIT;
+    long int time = now;
+
+    if (pending) {
+      long int previous = fake->keyTimes[(fake->keyTail - 1) % FAKE_KEY_LIMIT];
+      if (previous > time) time = previous;
+    }
+
+    fake->keys[index] = key;
+    fake->keyTimes[index] = time + fakeScenario->keyDelay;
+    fake->keyTail += 1;
+  }
+
+  fake->keyCount += 1;
+  if (++pending > fake->largestBatch) fake->largestBatch = pending;
+  return 1;
+}
+
+void
+describeScreen (ScreenDescription *description) {
+  processFakeKeys();
+
+  memset(description, 0, sizeof(*description));
+  description->number = FAKE_SCREEN_NUMBER;
+  description->cols = FAKE_SCREEN_COLUMNS;
+  description->rows = FAKE_SCREEN_ROWS;
+  description->posx = getFakeColumn(fakeScreen->row, fakeScreen->index);
+  description->posy = fakeScreen->row;
+  description->cursor = 1;
+}
+
+int
+readScreen (short left, short top, short width, short height, ScreenCharacter *buffer) {
+  processFakeKeys();
+
+  if ((left < 0) || (top < 0) || (width < 1) || (height < 1)) return 0;
+  if ((left + width) > FAKE_SCREEN_COLUMNS) return 0;
+  if ((top + height) > FAKE_SCREEN_ROWS) return 0;
+
+  for (int row=top; row<(top+height); row+=1) {
+    ScreenCharacter characters[FAKE_SCREEN_COLUMNS];
+    int length = getFakeLineLength(row);
+
+    for (int column=0; column<FAKE_SCREEN_COLUMNS; column+=1) {
+      characters[column].text = WC_C(' ');
+      characters[column].attributes = SCR_COLOUR_DEFAULT;
+    }
+
+    for (int index=0; index<length; index+=1) {
+      wchar_t character = fakeScenario->lines[row][index];
+      int column = getFakeColumn(row, index);
+
+      if (column >= FAKE_SCREEN_COLUMNS) break;
+      if (character != WC_C('\t')) characters[column].text = character;
+    }
+
+    memcpy(buffer, &characters[left], ARRAY_SIZE(buffer, width));
+    buffer += width;
+  }
+
+  return 1;
+}
+
+int
+constructRoutingScreen (void) {
+  return 1;
+}
+
+void
+destructRoutingScreen (void) {
+}
+
+static const char *
+getRoutingStatusName (RoutingStatus status) {
+  switch (status) {
+    case ROUTING_NONE: return "none";
+    case ROUTING_DONE: return "done";
+    case ROUTING_WRONG_COLUMN: return "wrong-column";
+    case ROUTING_WRONG_ROW: return "wrong-row";
+    case ROUTING_ERROR: return "error";
+    default: return "?";
+  }
+}
+
+static int
+runScenario (const RoutingScenario *scenario) {
+  FakeScreen *fake = fakeScreen;
+  RoutingStatus status;
+  long int time;
+  int column;
+  int ok;
+
+  memset(fake, 0, sizeof(*fake));
+  fake->row = scenario->startRow;
+  fake->index = scenario->startIndex;
+
+  fakeScenario = scenario;
+  getMonotonicTime(&fakeStart);
+
+  if (!startRouting(scenario->targetColumn, scenario->targetRow, FAKE_SCREEN_NUMBER)) {
+    logMessage(LOG_ERR, "%s: routing not started", scenario->name);
+    return 0;
+  }
+
+  status = getRoutingStatus(1);
+  time = getMonotonicElapsed(&fakeStart);
+  column = getFakeColumn(fake->row, fake->index);
+
+  ok = (status == scenario->status) &&
+       (fake->row == scenario->targetRow) &&
+       (column == scenario->column) &&
+       (!scenario->maximumKeys || (fake->keyCount <= scenario->maximumKeys));
+
+  printf("%-16s %-12s [%2d,%d] keys:%3u batch:%2u %5ldms %s\n",
+         scenario->name, getRoutingStatusName(status), column, fake->row,
+         fake->keyCount, fake->largestBatch, time, (ok? "ok": "FAILED"));
+
+  return ok;
+}
+
+int
+main (int argc, char *argv[]) {
+  unsigned int failures = 0;
+  unsigned int count = 0;
+
+  {
+    static const OptionsDescriptor descriptor = {
+      OPTION_TABLE(programOptions),
+      .applicationName = "routetest"
+    };
+
+    PROCESS_OPTIONS(descriptor, argc, argv);
+  }
+
+  if (argc) {
+    logMessage(LOG_ERR, "too many parameters");
+    return PROG_EXIT_SYNTAX;
+  }
+
+#ifdef SIGUSR1
+  /* The cursor is routed by a subprocess. */
+  {
+    void *address = mmap(NULL, sizeof(*fakeScreen), PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (address == MAP_FAILED) {
+      logSystemError("mmap");
+      return PROG_EXIT_FATAL;
+    }
+
+    fakeScreen = address;
+  }
+#else /* SIGUSR1 */
+  if (!(fakeScreen = malloc(sizeof(*fakeScreen)))) {
+    logMallocError();
+    return PROG_EXIT_FATAL;
+  }
+#endif /* SIGUSR1 */
+
+  for (unsigned int index=0; index<ARRAY_COUNT(routingScenarios); index+=1) {
+    const RoutingScenario *scenario = &routingScenarios[index];
+
+    if (opt_scenarioName && *opt_scenarioName) {
+      if (strcmp(scenario->name, opt_scenarioName) != 0) continue;
+    }
+
+    if (!runScenario(scenario)) failures += 1;
+    count += 1;
+  }
+
+  if (!count) {
+    logMessage(LOG_ERR, "unknown scenario: %s", opt_scenarioName);
+    return PROG_EXIT_SYNTAX;
+  }
+
+  if (failures) {
+    logMessage(LOG_ERR, "cursor routing scenarios failed: %u", failures);
+    return PROG_EXIT_SEMANTIC;
+  }
+
+  return PROG_EXIT_SUCCESS;
+}
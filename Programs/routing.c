@@ -49,6 +49,8 @@
 #define ROUTING_NICENESS	10	/* niceness of cursor routing subprocess */
 #define ROUTING_INTERVAL	1	/* how often to check for response */
 #define ROUTING_TIMEOUT	2000	/* max wait for response to key press */
+#define ROUTING_BATCH_TIME	100	/* how long a batch of key presses should take */
+#define ROUTING_BATCH_LIMIT	20	/* max key presses per batch */
 
 typedef enum {
   CRR_DONE,
@@ -289,6 +291,115 @@ awaitCursorMotion (RoutingData *routing, int direction, const CursorAxisEntry *a
   return 1;
 }
 
+static int
+getBatchSize (RoutingData *routing, int distance) {
+  long int response = routing->timeSum / (routing->timeCount * 8);
+  int size = response? (ROUTING_BATCH_TIME / response): ROUTING_BATCH_LIMIT;
+
+  if (size > ROUTING_BATCH_LIMIT) size = ROUTING_BATCH_LIMIT;
+  if (size > distance) size = distance;
+  if (size < 1) size = 1;
+  return size;
+}
+
+static int
+awaitBatchedCursorMotion (RoutingData *routing, int trgy, int trgx, int count) {
+  long int timeout = routing->timeSum / routing->timeCount;
+  TimeValue start;
+  TimeValue motion;
+
+  int cury = routing->cury;
+  int curx = routing->curx;
+
+  routing->oldy = routing->cury;
+  routing->oldx = routing->curx;
+
+  getMonotonicTime(&start);
+  motion = start;
+
+  /* Only poll the cursor position while the batch is being processed -
+   * the row itself is read just once, after the cursor has settled.
+   */
+  while (1) {
+    ScreenDescription description;
+
+    asyncWait(ROUTING_INTERVAL);
+    describeScreen(&description);
+
+    if (description.number != routing->screenNumber) {
+      logRouting("screen changed: num=%d", description.number);
+      routing->screenNumber = description.number;
+      return 0;
+    }
+
+    if (((description.posy - routing->verticalDelta) != cury) || (description.posx != curx)) {
+      cury = description.posy - routing->verticalDelta;
+      curx = description.posx;
+      getMonotonicTime(&motion);
+      if ((cury == trgy) && (curx == trgx)) break;
+    } else if (getMonotonicElapsed(&motion) > timeout) {
+      break;
+    }
+  }
+
+  if (!getCurrentPosition(routing)) return 0;
+
+  if ((routing->cury != routing->oldy) || (routing->curx != routing->oldx)) {
+    long int time = millisecondsBetween(&start, &motion) + 1;
+
+    logRouting("moved: [%d,%d] -> [%d,%d] (%d keys, %ldms)",
+               routing->oldx, routing->oldy, routing->curx, routing->cury,
+               count, time);
+
+    routing->timeSum += (time * 8) / count;
+    routing->timeCount += 1;
+  } else {
+    logRouting("timed out: %ldms", timeout);
+  }
+
+  return 1;
+}
+
+static RoutingResult
+moveCursorInBatches (RoutingData *routing, int trgy, int trgx) {
+  const CursorAxisEntry *axis = &cursorAxisTable[CURSOR_AXIS_HORIZONTAL];
+
+  while (routing->cury == trgy) {
+    int distance = trgx - routing->curx;
+    int dir;
+    int size;
+    int expected;
+
+    if (!distance) return CRR_DONE;
+    dir = (distance > 0)? 1: -1;
+
+    size = getBatchSize(routing, (distance * dir));
+    expected = routing->curx + (size * dir);
+    logRouting("batch to: [%d,%d]", expected, trgy);
+
+    {
+      int count = size;
+
+      while (count-- > 0) {
+        moveCursor(routing, ((dir > 0)? axis->forward: axis->backward));
+      }
+    }
+
+    if (!awaitBatchedCursorMotion(routing, trgy, expected, size)) return CRR_FAIL;
+
+    if ((routing->cury != trgy) || (routing->curx != expected)) {
+      /* The application didn't move the cursor one column per key press
+       * (tabs, wide characters, end of line, etc) so let the stepwise
+       * mode find the nearest position.
+       */
+      logRouting("batch missed: [%d,%d]", routing->curx, routing->cury);
+      break;
+    }
+  }
+
+  return CRR_NEAR;
+}
+
 static RoutingResult
 adjustCursorPosition (RoutingData *routing, int where, int trgy, int trgx, const CursorAxisEntry *axis) {
   logRouting("to: [%d,%d]", trgx, trgy);
@@ -391,7 +502,13 @@ routeCursor (const RoutingParameters *parameters) {
       adjustCursorVertically(&routing, 0, parameters->row);
     } else {
       if (adjustCursorVertically(&routing, -1, parameters->row) != CRR_FAIL) {
-        if (adjustCursorHorizontally(&routing, 0, parameters->row, parameters->column) == CRR_NEAR) {
+        RoutingResult result = moveCursorInBatches(&routing, parameters->row, parameters->column);
+
+        if (result == CRR_NEAR) {
+          result = adjustCursorHorizontally(&routing, 0, parameters->row, parameters->column);
+        }
+
+        if (result == CRR_NEAR) {
           if (routing.cury < parameters->row) {
             if (adjustCursorVertically(&routing, 1, routing.cury+1) != CRR_FAIL) {
               adjustCursorHorizontally(&routing, 0, parameters->row, parameters->column);
@@ -0,0 +1,260 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2017 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+#include "prologue.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "log.h"
+#include "scr_export.h"
+
+#ifdef HAVE_SHM_OPEN
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "scr.h"
+
+static const mode_t exportMode = S_IRUSR | S_IWUSR | S_IRGRP;
+
+static char *exportName = NULL;
+static int exportFileDescriptor = -1;
+static ScreenExportHeader *exportHeader = NULL;
+static size_t exportSize = 0;
+
+static ScreenCharacter *exportBuffer = NULL;
+static size_t exportBufferSize = 0;
+
+#ifdef __GNUC__
+#define EXPORT_BARRIER() __sync_synchronize()
+#else /* __GNUC__ */
+#define EXPORT_BARRIER()
+#endif /* __GNUC__ */
+
+static ScreenCharacter *
+getExportedCharacters (void) {
+  return (ScreenCharacter *)((unsigned char *)exportHeader + exportHeader->charactersOffset);
+}
+
+static void
+unmapExportSegment (void) {
+  if (exportHeader) {
+    munmap(exportHeader, exportSize);
+    exportHeader = NULL;
+    exportSize = 0;
+  }
+}
+
+static int
+mapExportSegment (size_t size) {
+  if (ftruncate(exportFileDescriptor, size) != -1) {
+    void *address = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, exportFileDescriptor, 0);
+
+    if (address != MAP_FAILED) {
+      exportHeader = address;
+      exportSize = size;
+      return 1;
+    } else {
+      logSystemError("mmap");
+    }
+  } else {
+    logSystemError("ftruncate");
+  }
+
+  return 0;
+}
+
+static int
+ensureExportSegment (size_t count) {
+  size_t size = sizeof(*exportHeader) + (count * sizeof(ScreenCharacter));
+
+  if (size > exportSize) {
+    unmapExportSegment();
+    if (!mapExportSegment(size)) return 0;
+  }
+
+  if (count > exportBufferSize) {
+    ScreenCharacter *buffer = realloc(exportBuffer, ARRAY_SIZE(buffer, count));
+
+    if (!buffer) {
+      logMallocError();
+      return 0;
+    }
+
+    exportBuffer = buffer;
+    exportBufferSize = count;
+  }
+
+  return 1;
+}
+
+int
+startScreenExport (const char *name) {
+  stopScreenExport();
+
+  if (*name != '/') {
+    size_t size = strlen(name) + 2;
+    char path[size];
+
+    snprintf(path, size, "/%s", name);
+    exportName = strdup(path);
+  } else {
+    exportName = strdup(name);
+  }
+
+  if (exportName) {
+    /* Never reuse an existing object - it may have been planted by someone
+     * hoping to read (or alter) what we write into it.
+     */
+    shm_unlink(exportName);
+
+    if ((exportFileDescriptor = shm_open(exportName, O_RDWR | O_CREAT | O_EXCL, exportMode)) != -1) {
+      if (mapExportSegment(sizeof(*exportHeader))) {
+        ScreenExportHeader *header = exportHeader;
+
+        memset(header, 0, sizeof(*header));
+        header->magic = SCREEN_EXPORT_MAGIC;
+        header->version = SCREEN_EXPORT_VERSION;
+        header->headerSize = sizeof(*header);
+        header->segmentSize = exportSize;
+        header->characterSize = sizeof(ScreenCharacter);
+        header->charactersOffset = sizeof(*header);
+
+        logMessage(LOG_INFO, "screen export segment: %s", exportName);
+        return 1;
+      }
+
+      close(exportFileDescriptor);
+      exportFileDescriptor = -1;
+      shm_unlink(exportName);
+    } else {
+      logMessage(LOG_WARNING, "cannot create screen export segment: %s: %s",
+                 exportName, strerror(errno));
+    }
+
+    free(exportName);
+    exportName = NULL;
+  } else {
+    logMallocError();
+  }
+
+  return 0;
+}
+
+void
+stopScreenExport (void) {
+  unmapExportSegment();
+
+  if (exportFileDescriptor != -1) {
+    close(exportFileDescriptor);
+    exportFileDescriptor = -1;
+  }
+
+  if (exportName) {
+    shm_unlink(exportName);
+    free(exportName);
+    exportName = NULL;
+  }
+
+  if (exportBuffer) {
+    free(exportBuffer);
+    exportBuffer = NULL;
+    exportBufferSize = 0;
+  }
+}
+
+static void
+writeExportedScreen (const ScreenDescription *description, int unreadable, const ScreenCharacter *characters) {
+  ScreenExportHeader *header = exportHeader;
+  size_t count = characters? (description->cols * description->rows): 0;
+
+  if ((header->segmentSize == exportSize) &&
+      (header->number == description->number) &&
+      (header->columns == (count? description->cols: 0)) &&
+      (header->rows == (count? description->rows: 0)) &&
+      (header->cursorColumn == description->posx) &&
+      (header->cursorRow == description->posy) &&
+      (header->cursorVisible == description->cursor) &&
+      (header->unreadable == unreadable) &&
+      (!count || (memcmp(getExportedCharacters(), characters, ARRAY_SIZE(characters, count)) == 0))) {
+    return;
+  }
+
+  header->generation += 1;
+  EXPORT_BARRIER();
+
+  header->segmentSize = exportSize;
+  header->number = description->number;
+  header->columns = count? description->cols: 0;
+  header->rows = count? description->rows: 0;
+  header->cursorColumn = description->posx;
+  header->cursorRow = description->posy;
+  header->cursorVisible = description->cursor;
+  header->unreadable = unreadable;
+  if (count) memcpy(getExportedCharacters(), characters, ARRAY_SIZE(characters, count));
+
+  EXPORT_BARRIER();
+  header->generation += 1;
+}
+
+void
+exportScreen (const ScreenDescription *description) {
+  if (exportHeader) {
+    size_t count = description->cols * description->rows;
+    int unreadable = !!description->unreadable;
+
+    if (!ensureExportSegment(count)) return;
+
+    if (count && !readScreen(0, 0, description->cols, description->rows, exportBuffer)) {
+      count = 0;
+      unreadable = 1;
+    }
+
+    writeExportedScreen(description, unreadable, (count? exportBuffer: NULL));
+  }
+}
+
+void
+exportScreenCharacters (const ScreenDescription *description, const ScreenCharacter *characters) {
+  if (exportHeader) {
+    if (!ensureExportSegment(description->cols * description->rows)) return;
+    writeExportedScreen(description, !!description->unreadable, characters);
+  }
+}
+
+#else /* HAVE_SHM_OPEN */
+int
+startScreenExport (const char *name) {
+  logMessage(LOG_WARNING, "screen export not supported");
+  return 0;
+}
+
+void
+stopScreenExport (void) {
+}
+
+void
+exportScreen (const ScreenDescription *description) {
+}
+
+void
+exportScreenCharacters (const ScreenDescription *description, const ScreenCharacter *characters) {
+}
+#endif /* HAVE_SHM_OPEN */
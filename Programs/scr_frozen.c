@@ -27,9 +27,191 @@
 #include "alert.h"
 #include "scr.h"
 #include "scr_frozen.h"
+#include "update.h"
+#include "brl_cmds.h"
 
-static ScreenDescription screenDescription;
-static ScreenCharacter *screenCharacters;
+typedef struct {
+  unsigned int references;
+  unsigned int hash;
+  ScreenCharacter characters[0];
+} FrozenRow;
+
+typedef struct {
+  ScreenDescription description;
+  FrozenRow *rows[0];
+} FrozenSnapshot;
+
+static BaseScreen *sourceScreen;
+static FrozenSnapshot *frozenSnapshots[SCREEN_FREEZE_HISTORY_SIZE];
+static unsigned int snapshotCount;
+static unsigned int currentSnapshot;
+static int screenFrozen;
+
+static void
+releaseFrozenRow (FrozenRow *row) {
+  if (!(row->references -= 1)) free(row);
+}
+
+static void
+deallocateFrozenSnapshot (FrozenSnapshot *snapshot) {
+  int row;
+
+  for (row=0; row<snapshot->description.rows; row+=1) {
+    releaseFrozenRow(snapshot->rows[row]);
+  }
+
+  free(snapshot);
+}
+
+static unsigned int
+hashFrozenRow (const ScreenCharacter *characters, int count) {
+  unsigned int hash = 0;
+
+  while (count-- > 0) {
+    hash = (hash * 31) + characters->text;
+    hash = (hash * 31) + characters->attributes;
+    characters += 1;
+  }
+
+  return hash;
+}
+
+static FrozenRow *
+findFrozenRow (const FrozenSnapshot *snapshot, int index, const ScreenCharacter *characters, unsigned int hash) {
+  const ScreenDescription *description = &snapshot->description;
+  size_t size = description->cols * sizeof(*characters);
+  int limit = MIN(description->rows-1, SCREEN_FREEZE_ROW_SEARCH_DISTANCE);
+  int offset;
+
+  /* Try the same row first, and then the rows near it so that content
+   * which has scrolled a little since the previous snapshot is still shared.
+   */
+  for (offset=0; offset<=limit; offset+=1) {
+    int delta;
+
+    for (delta=-offset; delta<=offset; delta+=(offset? (offset * 2): 1)) {
+      int row = index + delta;
+
+      if ((row >= 0) && (row < description->rows)) {
+        FrozenRow *frozen = snapshot->rows[row];
+
+        if (frozen->hash == hash) {
+          if (memcmp(frozen->characters, characters, size) == 0) {
+            return frozen;
+          }
+        }
+      }
+    }
+  }
+
+  return NULL;
+}
+
+static FrozenSnapshot *
+captureFrozenSnapshot (const FrozenSnapshot *previous) {
+  ScreenDescription description;
+  FrozenSnapshot *snapshot;
+
+  describeBaseScreen(sourceScreen, &description);
+
+  if (previous) {
+    if ((description.cols != previous->description.cols) ||
+        (description.rows != previous->description.rows)) {
+      previous = NULL;
+    }
+  }
+
+  if ((snapshot = malloc(sizeof(*snapshot) + (description.rows * sizeof(snapshot->rows[0]))))) {
+    ScreenCharacter characters[description.cols];
+    int unchanged = previous != NULL;
+    int row;
+
+    snapshot->description = description;
+
+    for (row=0; row<description.rows; row+=1) {
+      const ScreenBox box = {
+        .left=0, .width=description.cols,
+        .top=row, .height=1
+      };
+
+      FrozenRow *frozen;
+      unsigned int hash;
+
+      if (!sourceScreen->readCharacters(&box, characters)) break;
+      hash = hashFrozenRow(characters, description.cols);
+
+      if (previous && (frozen = findFrozenRow(previous, row, characters, hash))) {
+        if (frozen != previous->rows[row]) unchanged = 0;
+        frozen->references += 1;
+      } else if ((frozen = malloc(sizeof(*frozen) + sizeof(characters)))) {
+        frozen->references = 1;
+        frozen->hash = hash;
+        memcpy(frozen->characters, characters, sizeof(characters));
+        unchanged = 0;
+      } else {
+        logMallocError();
+        break;
+      }
+
+      snapshot->rows[row] = frozen;
+    }
+
+    if (row == description.rows) {
+      if (unchanged) {
+        if ((description.number != previous->description.number) ||
+            (description.posx != previous->description.posx) ||
+            (description.posy != previous->description.posy)) {
+          unchanged = 0;
+        }
+      }
+
+      if (!unchanged) return snapshot;
+    }
+
+    snapshot->description.rows = row;
+    deallocateFrozenSnapshot(snapshot);
+  } else {
+    logMallocError();
+  }
+
+  return NULL;
+}
+
+static int
+addFrozenSnapshot (void) {
+  FrozenSnapshot *previous = snapshotCount? frozenSnapshots[snapshotCount-1]: NULL;
+  FrozenSnapshot *snapshot = captureFrozenSnapshot(previous);
+
+  if (!snapshot) return 0;
+
+  if (snapshotCount == SCREEN_FREEZE_HISTORY_SIZE) {
+    /* Discard the oldest snapshot, but never the one being viewed. */
+    unsigned int oldest = (screenFrozen && !currentSnapshot)? 1: 0;
+
+    deallocateFrozenSnapshot(frozenSnapshots[oldest]);
+    memmove(&frozenSnapshots[oldest], &frozenSnapshots[oldest+1],
+            ((snapshotCount -= 1) - oldest) * sizeof(frozenSnapshots[0]));
+
+    if (currentSnapshot > oldest) currentSnapshot -= 1;
+  }
+
+  frozenSnapshots[snapshotCount++] = snapshot;
+  return 1;
+}
+
+static void
+removeFrozenSnapshots (void) {
+  while (snapshotCount) {
+    deallocateFrozenSnapshot(frozenSnapshots[--snapshotCount]);
+  }
+
+  currentSnapshot = 0;
+}
+
+static const FrozenSnapshot *
+getFrozenSnapshot (void) {
+  return frozenSnapshots[currentSnapshot];
+}
 
 static int startFreezeReminderAlarm (void);
 static AsyncHandle freezeReminderAlarm = NULL;
@@ -58,53 +240,48 @@ stopFreezeReminderAlarm (void) {
   }
 }
 
-static int
-construct_FrozenScreen (BaseScreen *source) {
-  describeBaseScreen(source, &screenDescription);
-
-  if ((screenCharacters = calloc(screenDescription.rows*screenDescription.cols, sizeof(*screenCharacters)))) {
-    const ScreenBox box = {
-      .left=0, .width=screenDescription.cols,
-      .top=0, .height=screenDescription.rows
-    };
-
-    if (source->readCharacters(&box, screenCharacters)) {
-      startFreezeReminderAlarm();
-      return 1;
-    }
+static void
+capture_FrozenScreen (BaseScreen *source) {
+  sourceScreen = source;
 
-    free(screenCharacters);
-    screenCharacters = NULL;
-  } else {
-    logMallocError();
+  if (addFrozenSnapshot()) {
+    logMessage(LOG_DEBUG, "frozen screen snapshot added: %u", snapshotCount);
   }
+}
 
-  return 0;
+static int
+construct_FrozenScreen (BaseScreen *source) {
+  /* nothing is added if the screen hasn't changed since it was last captured */
+  capture_FrozenScreen(source);
+  if (!snapshotCount) return 0;
+
+  currentSnapshot = snapshotCount - 1;
+  screenFrozen = 1;
+  startFreezeReminderAlarm();
+  return 1;
 }
 
 static void
 destruct_FrozenScreen (void) {
   stopFreezeReminderAlarm();
-
-  if (screenCharacters) {
-    free(screenCharacters);
-    screenCharacters = NULL;
-  }
+  screenFrozen = 0;
 }
 
 static void
 describe_FrozenScreen (ScreenDescription *description) {
-  *description = screenDescription;
+  *description = getFrozenSnapshot()->description;
 }
 
 static int
 readCharacters_FrozenScreen (const ScreenBox *box, ScreenCharacter *buffer) {
-  if (validateScreenBox(box, screenDescription.cols, screenDescription.rows)) {
+  const FrozenSnapshot *snapshot = getFrozenSnapshot();
+
+  if (validateScreenBox(box, snapshot->description.cols, snapshot->description.rows)) {
     int row;
     for (row=0; row<box->height; row++) {
       memcpy(&buffer[row * box->width],
-             &screenCharacters[((box->top + row) * screenDescription.cols) + box->left],
-             box->width * sizeof(*screenCharacters));
+             &snapshot->rows[box->top + row]->characters[box->left],
+             box->width * sizeof(*buffer));
     }
     return 1;
   }
@@ -113,7 +290,45 @@ readCharacters_FrozenScreen (const ScreenBox *box, ScreenCharacter *buffer) {
 
 static int
 currentVirtualTerminal_FrozenScreen (void) {
-  return screenDescription.number;
+  return getFrozenSnapshot()->description.number;
+}
+
+static int
+selectFrozenSnapshot (unsigned int snapshot) {
+  if (snapshot == currentSnapshot) return 0;
+
+  currentSnapshot = snapshot;
+  scheduleUpdate("frozen screen snapshot");
+  return 1;
+}
+
+static int
+handleCommand_FrozenScreen (int command) {
+  int changed;
+
+  switch (command) {
+    case BRL_CMD_KEY(PAGE_UP):
+      changed = currentSnapshot && selectFrozenSnapshot(currentSnapshot - 1);
+      break;
+
+    case BRL_CMD_KEY(PAGE_DOWN):
+      changed = selectFrozenSnapshot(MIN((currentSnapshot + 1), (snapshotCount - 1)));
+      break;
+
+    case BRL_CMD_KEY(HOME):
+      changed = selectFrozenSnapshot(0);
+      break;
+
+    case BRL_CMD_KEY(END):
+      changed = selectFrozenSnapshot(snapshotCount - 1);
+      break;
+
+    default:
+      return 0;
+  }
+
+  if (!changed) alert(ALERT_COMMAND_REJECTED);
+  return 1;
 }
 
 void
@@ -122,7 +337,13 @@ initializeFrozenScreen (FrozenScreen *frozen) {
   frozen->base.describe = describe_FrozenScreen;
   frozen->base.readCharacters = readCharacters_FrozenScreen;
   frozen->base.currentVirtualTerminal = currentVirtualTerminal_FrozenScreen;
+  frozen->base.handleCommand = handleCommand_FrozenScreen;
   frozen->construct = construct_FrozenScreen;
   frozen->destruct = destruct_FrozenScreen;
-  screenCharacters = NULL;
+  frozen->capture = capture_FrozenScreen;
+  frozen->discardHistory = removeFrozenSnapshots;
+  sourceScreen = NULL;
+  snapshotCount = 0;
+  currentSnapshot = 0;
+  screenFrozen = 0;
 }
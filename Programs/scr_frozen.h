@@ -28,7 +28,9 @@ extern "C" {
 typedef struct {
   BaseScreen base;
   int (*construct) (BaseScreen *);		/* called every time the screen is frozen */
-  void (*destruct) (void);		/* called to discard frozen screen image */
+  void (*destruct) (void);		/* called every time the screen is unfrozen */
+  void (*capture) (BaseScreen *);		/* called whenever the source screen may have changed */
+  void (*discardHistory) (void);		/* called to discard every snapshot */
 } FrozenScreen;
 
 extern void initializeFrozenScreen (FrozenScreen *frozen);
@@ -41,6 +41,11 @@ typedef struct {
 
   unsigned char cursorRow;
   unsigned char cursorColumn;
+
+  struct {
+    HelpPageGenerator *generate;
+    void *data;
+  } generator;
 } HelpPageEntry;
 
 static HelpPageEntry *pageTable;
@@ -66,6 +71,9 @@ initializePage (HelpPageEntry *page) {
 
   page->cursorRow = 0;
   page->cursorColumn = 0;
+
+  page->generator.generate = NULL;
+  page->generator.data = NULL;
 }
 
 static unsigned int
@@ -101,8 +109,9 @@ clearPage (HelpPageEntry *page) {
     }
 
     free(page->lineTable);
-    initializePage(page);
   }
+
+  initializePage(page);
 }
 
 static int
@@ -144,6 +153,26 @@ getPage (void) {
   return NULL;
 }
 
+static HelpPageEntry *
+getGeneratedPage (void) {
+  HelpPageEntry *page = getPage();
+
+  if (page) {
+    HelpPageGenerator *generate = page->generator.generate;
+
+    if (generate) {
+      /* Reset first so that the lines the generator adds don't recurse. */
+      page->generator.generate = NULL;
+
+      if (!generate(page->generator.data)) {
+        logMessage(LOG_WARNING, "help page generation failed: %u", pageIndex+1);
+      }
+    }
+  }
+
+  return page;
+}
+
 static int
 construct_HelpScreen (void) {
   initializePageTable();
@@ -191,6 +220,18 @@ clearPage_HelpScreen (void) {
   return 1;
 }
 
+static int
+setPageGenerator_HelpScreen (HelpPageGenerator *generator, void *data) {
+  HelpPageEntry *page = getPage();
+
+  if (!page) return 0;
+  clearPage(page);
+
+  page->generator.generate = generator;
+  page->generator.data = data;
+  return 1;
+}
+
 static int
 addLine_HelpScreen (const wchar_t *characters) {
   HelpPageEntry *page = getPage();
@@ -200,7 +241,7 @@ addLine_HelpScreen (const wchar_t *characters) {
 
 static unsigned int 
 getLineCount_HelpScreen (void) {
-  HelpPageEntry *page = getPage();
+  HelpPageEntry *page = getGeneratedPage();
 
   return page? page->lineCount: 0;
 }
@@ -217,7 +258,7 @@ getTitle_HelpScreen (void) {
 
 static void
 describe_HelpScreen (ScreenDescription *description) {
-  const HelpPageEntry *page = getPage();
+  const HelpPageEntry *page = getGeneratedPage();
 
   if (page) {
     description->posx = page->cursorColumn;
@@ -232,7 +273,7 @@ describe_HelpScreen (ScreenDescription *description) {
 
 static int
 readCharacters_HelpScreen (const ScreenBox *box, ScreenCharacter *buffer) {
-  const HelpPageEntry *page = getPage();
+  const HelpPageEntry *page = getGeneratedPage();
 
   if (page) {
     if (validateScreenBox(box, page->lineLength, page->lineCount)) {
@@ -266,7 +307,7 @@ readCharacters_HelpScreen (const ScreenBox *box, ScreenCharacter *buffer) {
 
 static int
 insertKey_HelpScreen (ScreenKey key) {
-  HelpPageEntry *page = getPage();
+  HelpPageEntry *page = getGeneratedPage();
 
   if (page) {
     switch (key) {
@@ -308,7 +349,7 @@ insertKey_HelpScreen (ScreenKey key) {
 
 static int
 routeCursor_HelpScreen (int column, int row, int screen) {
-  HelpPageEntry *page = getPage();
+  HelpPageEntry *page = getGeneratedPage();
   if (!page) return 0;
 
   if (row != -1) {
@@ -343,6 +384,7 @@ initializeHelpScreen (HelpScreen *help) {
   help->setPageNumber = setPageNumber_HelpScreen;
 
   help->clearPage = clearPage_HelpScreen;
+  help->setPageGenerator = setPageGenerator_HelpScreen;
   help->addLine = addLine_HelpScreen;
   help->getLineCount = getLineCount_HelpScreen;
 }
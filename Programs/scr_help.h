@@ -25,6 +25,8 @@
 extern "C" {
 #endif /* __cplusplus */
 
+typedef int HelpPageGenerator (void *data);
+
 typedef struct {
   BaseScreen base;
   int (*construct) (void);
@@ -36,6 +38,7 @@ typedef struct {
   int (*setPageNumber) (unsigned int number);
 
   int (*clearPage) (void);
+  int (*setPageGenerator) (HelpPageGenerator *generator, void *data);
   int (*addLine) (const wchar_t *characters);
   unsigned int (*getLineCount) (void);
 } HelpScreen;
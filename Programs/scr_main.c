@@ -70,6 +70,7 @@ initializeMainScreen (MainScreen *main) {
 void
 mainScreenUpdated (void) {
   if (isMainScreen()) {
+    markUpdateLatency(UPDATE_LATENCY_SCREEN);
     scheduleUpdateIn("main screen updated", SCREEN_UPDATE_SCHEDULE_DELAY);
   }
 }
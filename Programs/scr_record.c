@@ -0,0 +1,198 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2017 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+#include "prologue.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "log.h"
+#include "file.h"
+#include "timing.h"
+#include "charset.h"
+#include "scr.h"
+#include "scr_record.h"
+#include "scr_internal.h"
+
+static FILE *recordingStream = NULL;
+static TimeValue recordingStart;
+
+static ScreenDescription recordedDescription;
+static ScreenCharacter *recordedCharacters = NULL;
+static ScreenCharacter *currentCharacters = NULL;
+static size_t recordedSize = 0;
+
+static long int
+getRecordingTime (void) {
+  return getMonotonicElapsed(&recordingStart);
+}
+
+static void
+flushRecording (void) {
+  if (fflush(recordingStream) == EOF) {
+    logMessage(LOG_WARNING, "screen recording error: %s", strerror(errno));
+    stopScreenRecording();
+  }
+}
+
+static void
+writeRecordedRow (unsigned int index, const ScreenCharacter *characters, unsigned int count) {
+  FILE *stream = recordingStream;
+
+  fprintf(stream, "row %u ", index);
+  for (unsigned int column=0; column<count; column+=1) {
+    fprintf(stream, "%02X", characters[column].attributes);
+  }
+
+  fputs(" \"", stream);
+  for (unsigned int column=0; column<count; column+=1) {
+    wchar_t character = characters[column].text;
+
+    if ((character == WC_C('\\')) || (character == WC_C('"'))) {
+      fputc('\\', stream);
+      fputc(character, stream);
+    } else if ((character < WC_C(' ')) || (character == 0X7F)) {
+      fprintf(stream, "\\X%02X", (unsigned int)character);
+    } else {
+      Utf8Buffer utf8;
+      size_t length = convertWcharToUtf8(character, utf8);
+
+      if (length) {
+        fwrite(utf8, 1, length, stream);
+      } else {
+        fprintf(stream, "\\U%08X", (uint32_t)character);
+      }
+    }
+  }
+
+  fputs("\"\n", stream);
+}
+
+void
+recordScreen (void) {
+  if (recordingStream && (screen != &noScreen)) {
+    /* Always the main screen - not whichever (help, menu, etc) is current. */
+    BaseScreen *screen = &mainScreen.base;
+    ScreenDescription description;
+
+    describeBaseScreen(screen, &description);
+    if (description.unreadable) return;
+
+    {
+      size_t count = description.cols * description.rows;
+      int resized = (description.cols != recordedDescription.cols) ||
+                    (description.rows != recordedDescription.rows);
+
+      if (count > recordedSize) {
+        ScreenCharacter *recorded = realloc(recordedCharacters, ARRAY_SIZE(recorded, count));
+        ScreenCharacter *current = recorded? realloc(currentCharacters, ARRAY_SIZE(current, count)): NULL;
+
+        if (recorded) recordedCharacters = recorded;
+        if (current) currentCharacters = current;
+
+        if (!(recorded && current)) {
+          logMallocError();
+          return;
+        }
+
+        recordedSize = count;
+      }
+
+      {
+        ScreenBox box = {
+          .left = 0, .width = description.cols,
+          .top = 0, .height = description.rows
+        };
+
+        if (!screen->readCharacters(&box, currentCharacters)) return;
+      }
+
+      if (!resized &&
+          (description.number == recordedDescription.number) &&
+          (description.posx == recordedDescription.posx) &&
+          (description.posy == recordedDescription.posy) &&
+          (description.cursor == recordedDescription.cursor) &&
+          (memcmp(currentCharacters, recordedCharacters, ARRAY_SIZE(currentCharacters, count)) == 0)) {
+        return;
+      }
+
+      fprintf(recordingStream, "screen %ld %d %d %d %d %d %d\n",
+              getRecordingTime(), description.number,
+              description.cols, description.rows,
+              description.posx, description.posy, description.cursor);
+
+      for (unsigned int row=0; row<description.rows; row+=1) {
+        size_t offset = row * description.cols;
+        const ScreenCharacter *characters = &currentCharacters[offset];
+
+        if (resized || (memcmp(characters, &recordedCharacters[offset], ARRAY_SIZE(characters, description.cols)) != 0)) {
+          writeRecordedRow(row, characters, description.cols);
+        }
+      }
+
+      memcpy(recordedCharacters, currentCharacters, ARRAY_SIZE(currentCharacters, count));
+      recordedDescription = description;
+      flushRecording();
+    }
+  }
+}
+
+void
+recordScreenCommand (int command) {
+  if (recordingStream) {
+    fprintf(recordingStream, "command %ld %X\n", getRecordingTime(), command);
+    flushRecording();
+  }
+}
+
+int
+startScreenRecording (const char *path) {
+  stopScreenRecording();
+
+  if ((recordingStream = openFile(path, "w", 0))) {
+    getMonotonicTime(&recordingStart);
+    memset(&recordedDescription, 0, sizeof(recordedDescription));
+
+    fprintf(recordingStream, "%s\n", SCREEN_RECORDING_HEADER);
+    logMessage(LOG_INFO, "screen recording: %s", path);
+    return 1;
+  }
+
+  return 0;
+}
+
+void
+stopScreenRecording (void) {
+  if (recordingStream) {
+    fclose(recordingStream);
+    recordingStream = NULL;
+  }
+
+  if (recordedCharacters) {
+    free(recordedCharacters);
+    recordedCharacters = NULL;
+  }
+
+  if (currentCharacters) {
+    free(currentCharacters);
+    currentCharacters = NULL;
+  }
+
+  recordedSize = 0;
+}
@@ -148,6 +148,8 @@ endSpecialScreens (void) {
     destructSpecialScreen(sse);
     sse += 1;
   }
+
+  frozenScreen.discardHistory();
 }
 
 static void
@@ -218,6 +220,18 @@ isSpecialScreen (SpecialScreenType type) {
   return currentScreen == getSpecialScreenEntry(type)->base;
 }
 
+void
+captureScreenHistory (void) {
+  if (isSpecialScreen(SCR_FROZEN)) {
+    /* the main screen isn't refreshed while it's hidden by the frozen one */
+    if (!mainScreen.base.refresh()) return;
+  } else if (!isMainScreen()) {
+    return;
+  }
+
+  frozenScreen.capture(&mainScreen.base);
+}
+
 int
 constructHelpScreen (void) {
   SpecialScreenEntry *sse = getSpecialScreenEntry(SCR_HELP);
@@ -250,6 +264,11 @@ clearHelpPage (void) {
   return helpScreen.clearPage();
 }
 
+int
+setHelpPageGenerator (HelpPageGenerator *generator, void *data) {
+  return helpScreen.setPageGenerator(generator, data);
+}
+
 int
 addHelpLine (const wchar_t *characters) {
   return helpScreen.addLine(characters);
@@ -344,6 +344,34 @@ serialFlushAttributes (SerialDevice *serial) {
   return 1;
 }
 
+static void
+serialCountInput (SerialDevice *serial, size_t count) {
+  serial->statistics.inputBytes += count;
+  serial->statistics.inputReads += 1;
+}
+
+static void
+serialResetStatistics (SerialDevice *serial) {
+  getMonotonicTime(&serial->statistics.opened);
+  serial->statistics.inputBytes = 0;
+  serial->statistics.inputReads = 0;
+  serial->statistics.outputBytes = 0;
+  serial->statistics.outputWrites = 0;
+}
+
+static void
+serialLogStatistics (SerialDevice *serial) {
+  long int elapsed = getMonotonicElapsed(&serial->statistics.opened);
+  unsigned long int seconds = (elapsed > MSECS_PER_SEC)? elapsed / MSECS_PER_SEC: 1;
+
+  logMessage(LOG_CATEGORY(SERIAL_IO),
+             "statistics: input: %lu bytes in %lu reads (%lu B/s), output: %lu bytes in %lu writes (%lu B/s)",
+             serial->statistics.inputBytes, serial->statistics.inputReads,
+             (serial->statistics.inputBytes / seconds),
+             serial->statistics.outputBytes, serial->statistics.outputWrites,
+             (serial->statistics.outputBytes / seconds));
+}
+
 int
 serialAwaitInput (SerialDevice *serial, int timeout) {
   if (!serialFlushAttributes(serial)) return 0;
@@ -363,6 +391,7 @@ serialReadData (
     ssize_t result = serialGetData(serial, buffer, size, initialTimeout, subsequentTimeout);
 
     if (result > 0) {
+      serialCountInput(serial, result);
       logBytes(LOG_CATEGORY(SERIAL_IO), "input", buffer, result);
     }
 
@@ -385,28 +414,37 @@ serialReadChunk (
   byte += *offset;
 
   while (byte < end) {
-    ssize_t result = serialGetData(serial, byte, 1, timeout, subsequentTimeout);
-
-    if (!result) {
-      result = -1;
-      errno = EAGAIN;
-    }
+    size_t size = end - byte;
+    ssize_t result = serialGetData(serial, byte, size, timeout, subsequentTimeout);
 
     if (result == -1) {
       if (errno == EINTR) continue;
-      return 0;
+      break;
+    }
+
+    if (result > 0) {
+      serialCountInput(serial, result);
+      byte += result;
+      *offset += result;
+    }
+
+    if (result < size) {
+      /* the timeout for the next byte has already expired */
+      errno = EAGAIN;
+      break;
     }
 
-    byte += 1;
-    *offset += 1;
     timeout = subsequentTimeout;
   }
 
   if (byte > first) {
+    int error = errno;
+
     logBytes(LOG_CATEGORY(SERIAL_IO), "input", first, (byte - first));
+    errno = error;
   }
 
-  return 1;
+  return byte == end;
 }
 
 ssize_t
@@ -416,7 +454,17 @@ serialWriteData (
 ) {
   if (!serialFlushAttributes(serial)) return -1;
   if (size > 0) logBytes(LOG_CATEGORY(SERIAL_IO), "output", data, size);
-  return serialPutData(serial, data, size);
+
+  {
+    ssize_t result = serialPutData(serial, data, size);
+
+    if (result > 0) {
+      serial->statistics.outputBytes += result;
+      serial->statistics.outputWrites += 1;
+    }
+
+    return result;
+  }
 }
 
 static int
@@ -715,6 +763,7 @@ serialOpenDevice (const char *identifier) {
 
         serial->fileDescriptor = -1;
         serial->stream = NULL;
+        serialResetStatistics(serial);
 
         connected = serialConnectDevice(serial, path);
         free(path);
@@ -755,6 +804,7 @@ serialCloseDevice (SerialDevice *serial) {
 #endif /* HAVE_POSIX_THREADS */
 
   serialWriteAttributes(serial, &serial->originalAttributes);
+  serialLogStatistics(serial);
 
   if (serial->stream) {
     fclose(serial->stream);
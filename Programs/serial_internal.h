@@ -25,6 +25,7 @@
 
 #include "io_serial.h"
 #include "thread.h"
+#include "timing.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -51,6 +52,14 @@ struct SerialDeviceStruct {
   unsigned flowControlStop:1;
 #endif /* HAVE_POSIX_THREADS */
 
+  struct {
+    TimeValue opened;
+    unsigned long inputBytes;
+    unsigned long inputReads;
+    unsigned long outputBytes;
+    unsigned long outputWrites;
+  } statistics;
+
   SerialPackageFields package;
 };
 
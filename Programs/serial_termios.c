@@ -160,6 +160,12 @@ serialPutInitialAttributes (SerialAttributes *attributes) {
   attributes->c_lflag |= IEXTEN;
 #endif /* IEXTEN */
 
+  /* The descriptor is nonblocking and reads are driven by polling for
+   * input, so ask for whatever is available without any interbyte timer.
+   */
+  attributes->c_cc[VMIN] = 0;
+  attributes->c_cc[VTIME] = 0;
+
 #ifdef _POSIX_VDISABLE
   if (_POSIX_VDISABLE) {
     unsigned int i;
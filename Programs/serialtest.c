@@ -0,0 +1,290 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2017 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+/* This program opens the slave side of a pseudo-terminal as a serial device
+ * and reads chunks from it (see serialReadChunk) while a subprocess writes
+ * scripted pieces into the master side. Each scenario checks whether the
+ * chunk was completed, how far it got, that a short chunk fails with EAGAIN
+ * (and can then be resumed), and that the bytes arrived intact.
+ */
+
+#include "prologue.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_POSIX_OPENPT
+#include <fcntl.h>
+#include <sys/wait.h>
+#endif /* HAVE_POSIX_OPENPT */
+
+#include "program.h"
+#include "options.h"
+#include "log.h"
+#include "timing.h"
+#include "io_serial.h"
+
+static char *opt_scenarioName;
+
+BEGIN_OPTION_TABLE(programOptions)
+  { .letter = 's',
+    .word = "scenario",
+    .argument = "name",
+    .setting.string = &opt_scenarioName,
+    .description = "Only run this scenario."
+  },
+END_OPTION_TABLE
+
+#define CHUNK_SIZE 16
+#define PIECE_LIMIT 4
+
+typedef struct {
+  int delay; /* before the piece is written */
+  size_t count;
+} WritePiece;
+
+typedef struct {
+  const char *name;
+  WritePiece pieces[PIECE_LIMIT];
+
+  int initialTimeout;
+  int subsequentTimeout;
+  unsigned int retries; /* calls allowed to resume after EAGAIN */
+
+  unsigned complete:1;
+  size_t offset;
+} ReadScenario;
+
+static const ReadScenario readScenarios[] = {
+  { .name = "whole",
+    .pieces = {{.count = 16}},
+    .initialTimeout = 200, .subsequentTimeout = 50,
+    .complete = 1, .offset = 16
+  },
+
+  { .name = "pieces",
+    .pieces = {{.count = 5}, {.delay = 20, .count = 11}},
+    .initialTimeout = 200, .subsequentTimeout = 100,
+    .complete = 1, .offset = 16
+  },
+
+  { .name = "trickle",
+    .pieces = {{.count = 4}, {.delay = 10, .count = 4}, {.delay = 10, .count = 4}, {.delay = 10, .count = 4}},
+    .initialTimeout = 200, .subsequentTimeout = 100,
+    .complete = 1, .offset = 16
+  },
+
+  { .name = "silent",
+    .initialTimeout = 50, .subsequentTimeout = 50,
+    .complete = 0, .offset = 0
+  },
+
+  { .name = "short",
+    .pieces = {{.count = 6}},
+    .initialTimeout = 200, .subsequentTimeout = 50,
+    .complete = 0, .offset = 6
+  },
+
+  { .name = "gap",
+    .pieces = {{.count = 4}, {.delay = 200, .count = 12}},
+    .initialTimeout = 200, .subsequentTimeout = 50,
+    .complete = 0, .offset = 4
+  },
+
+  { .name = "resume",
+    .pieces = {{.count = 6}, {.delay = 150, .count = 10}},
+    .initialTimeout = 200, .subsequentTimeout = 100, .retries = 1,
+    .complete = 1, .offset = 16
+  },
+};
+
+#ifdef HAVE_POSIX_OPENPT
+static int
+openPseudoTerminal (int *master, char **slave) {
+  int descriptor = posix_openpt(O_RDWR | O_NOCTTY);
+
+  if (descriptor != -1) {
+    if ((grantpt(descriptor) != -1) && (unlockpt(descriptor) != -1)) {
+      const char *name = ptsname(descriptor);
+
+      if (name) {
+        if ((*slave = strdup(name))) {
+          *master = descriptor;
+          return 1;
+        } else {
+          logMallocError();
+        }
+      } else {
+        logSystemError("ptsname");
+      }
+    } else {
+      logSystemError("grantpt/unlockpt");
+    }
+
+    close(descriptor);
+  } else {
+    logSystemError("posix_openpt");
+  }
+
+  return 0;
+}
+
+static pid_t
+startWriter (const ReadScenario *scenario, int master, const unsigned char *data) {
+  pid_t child = fork();
+
+  if (child == -1) {
+    logSystemError("fork");
+  } else if (!child) {
+    const unsigned char *byte = data;
+
+    for (unsigned int index=0; index<PIECE_LIMIT; index+=1) {
+      const WritePiece *piece = &scenario->pieces[index];
+
+      if (!piece->count) break;
+      if (piece->delay) approximateDelay(piece->delay);
+      if (write(master, byte, piece->count) == -1) _exit(1);
+      byte += piece->count;
+    }
+
+    _exit(0);
+  }
+
+  return child;
+}
+
+static int
+runScenario (const ReadScenario *scenario, SerialDevice *serial, int master) {
+  unsigned char data[CHUNK_SIZE];
+  unsigned char buffer[CHUNK_SIZE];
+  size_t offset = 0;
+  unsigned int calls = 0;
+  int complete;
+  int error;
+  long int time;
+  TimeValue start;
+  pid_t writer;
+
+  for (unsigned int index=0; index<CHUNK_SIZE; index+=1) data[index] = index + 1;
+  memset(buffer, 0, sizeof(buffer));
+  if ((writer = startWriter(scenario, master, data)) == -1) return 0;
+  getMonotonicTime(&start);
+
+  while (1) {
+    calls += 1;
+    errno = 0;
+
+    complete = serialReadChunk(serial, buffer, &offset, CHUNK_SIZE,
+                               scenario->initialTimeout, scenario->subsequentTimeout);
+    error = errno;
+
+    if (complete) break;
+    if (error != EAGAIN) break;
+    if (calls > scenario->retries) break;
+  }
+
+  time = getMonotonicElapsed(&start);
+
+  {
+    int status;
+
+    if (waitpid(writer, &status, 0) == -1) logSystemError("waitpid");
+  }
+
+  serialDiscardInput(serial);
+
+  {
+    int ok = (!complete == !scenario->complete) &&
+             (complete || (error == EAGAIN)) &&
+             (offset == scenario->offset) &&
+             (memcmp(buffer, data, offset) == 0);
+
+    printf("%-8s %-8s offset:%2u calls:%u %4ldms %s\n",
+           scenario->name, (complete? "complete": (error == EAGAIN)? "EAGAIN": strerror(error)),
+           (unsigned int)offset, calls, time, (ok? "ok": "FAILED"));
+
+    return ok;
+  }
+}
+#endif /* HAVE_POSIX_OPENPT */
+
+int
+main (int argc, char *argv[]) {
+  {
+    static const OptionsDescriptor descriptor = {
+      OPTION_TABLE(programOptions),
+      .applicationName = "serialtest"
+    };
+
+    PROCESS_OPTIONS(descriptor, argc, argv);
+  }
+
+  if (argc) {
+    logMessage(LOG_ERR, "too many parameters");
+    return PROG_EXIT_SYNTAX;
+  }
+
+#ifdef HAVE_POSIX_OPENPT
+  {
+    ProgramExitStatus exitStatus = PROG_EXIT_FATAL;
+    int master;
+    char *slave;
+
+    if (openPseudoTerminal(&master, &slave)) {
+      SerialDevice *serial = serialOpenDevice(slave);
+
+      if (serial) {
+        unsigned int failures = 0;
+        unsigned int count = 0;
+
+        for (unsigned int index=0; index<ARRAY_COUNT(readScenarios); index+=1) {
+          const ReadScenario *scenario = &readScenarios[index];
+
+          if (opt_scenarioName && *opt_scenarioName) {
+            if (strcmp(scenario->name, opt_scenarioName) != 0) continue;
+          }
+
+          if (!runScenario(scenario, serial, master)) failures += 1;
+          count += 1;
+        }
+
+        if (!count) {
+          logMessage(LOG_ERR, "unknown scenario: %s", opt_scenarioName);
+          exitStatus = PROG_EXIT_SYNTAX;
+        } else if (failures) {
+          logMessage(LOG_ERR, "serial read scenarios failed: %u", failures);
+          exitStatus = PROG_EXIT_SEMANTIC;
+        } else {
+          exitStatus = PROG_EXIT_SUCCESS;
+        }
+
+        serialCloseDevice(serial);
+      }
+
+      close(master);
+      free(slave);
+    }
+
+    return exitStatus;
+  }
+#else /* HAVE_POSIX_OPENPT */
+  logMessage(LOG_WARNING, "pseudo-terminals not supported");
+  return PROG_EXIT_SUCCESS;
+#endif /* HAVE_POSIX_OPENPT */
+}
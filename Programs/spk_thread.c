@@ -24,6 +24,7 @@
 #include "parameters.h"
 #include "log.h"
 #include "strfmt.h"
+#include "timing.h"
 #include "prefs.h"
 #include "spk_thread.h"
 #include "spk.h"
@@ -73,6 +74,14 @@ getThreadStateEntry (ThreadState state) {
   return &threadStateTable[state];
 }
 
+#ifdef __GNUC__
+#define SAY_GENERATION_ADVANCE(generation) __sync_add_and_fetch((generation), 1)
+#define SAY_GENERATION_GET(generation) __sync_fetch_and_add((generation), 0)
+#else /* __GNUC__ */
+#define SAY_GENERATION_ADVANCE(generation) (*(generation) += 1)
+#define SAY_GENERATION_GET(generation) (*(generation))
+#endif /* __GNUC__ */
+
 typedef enum {
   RSP_PENDING,
   RSP_INTEGER
@@ -85,6 +94,25 @@ struct SpeechDriverThreadStruct {
   volatile SpeechSynthesizer *speechSynthesizer;
   char **driverParameters;
 
+  /* Advanced whenever pending speech is muted so that a say request which
+   * has already been sent to the driver thread can tell that it's been
+   * superseded. It's advanced on the main thread and read on the driver
+   * thread, so it's only accessed via getSayGeneration/advanceSayGeneration.
+   */
+  unsigned int sayGeneration;
+
+  struct {
+    TimeValue requestTime;
+    unsigned awaitingSpeech:1;
+
+    /* Only drivers which report location or finished can be measured. */
+    unsigned driverReports:1;
+
+    unsigned long count;
+    unsigned long total;
+    long int maximum;
+  } latency;
+
 #ifdef GOT_PTHREADS
   pthread_t threadIdentifier;
   AsyncEvent *requestEvent;
@@ -133,6 +161,7 @@ typedef struct {
       size_t count;
       const unsigned char *attributes;
       SayOptions options;
+      unsigned int generation;
     } sayText;
 
     struct {
@@ -326,6 +355,35 @@ awaitSpeechResponse (volatile SpeechDriverThread *sdt, int timeout) {
 
 static void sendSpeechRequest (volatile SpeechDriverThread *sdt);
 
+static inline unsigned int
+getSayGeneration (volatile SpeechDriverThread *sdt) {
+  return SAY_GENERATION_GET(&sdt->sayGeneration);
+}
+
+static inline void
+advanceSayGeneration (volatile SpeechDriverThread *sdt) {
+  SAY_GENERATION_ADVANCE(&sdt->sayGeneration);
+}
+
+static void
+measureSpeechLatency (volatile SpeechDriverThread *sdt) {
+  sdt->latency.driverReports = 1;
+
+  if (sdt->latency.awaitingSpeech) {
+    long int latency = getMonotonicElapsed((const TimeValue *)&sdt->latency.requestTime);
+
+    sdt->latency.awaitingSpeech = 0;
+    sdt->latency.count += 1;
+    sdt->latency.total += latency;
+    if (latency > sdt->latency.maximum) sdt->latency.maximum = latency;
+
+    logMessage(LOG_CATEGORY(SPEECH_EVENTS),
+               "speech latency: %ld ms (average:%lu maximum:%ld count:%lu)",
+               latency, (sdt->latency.total / sdt->latency.count),
+               sdt->latency.maximum, sdt->latency.count);
+  }
+}
+
 static void
 handleSpeechMessage (volatile SpeechDriverThread *sdt, SpeechMessage *msg) {
   logSpeechMessage(msg, "handling");
@@ -341,6 +399,8 @@ handleSpeechMessage (volatile SpeechDriverThread *sdt, SpeechMessage *msg) {
         volatile SpeechSynthesizer *spk = sdt->speechSynthesizer;
         SetSpeechFinishedMethod *setFinished = spk->setFinished;
 
+        measureSpeechLatency(sdt);
+
         if (setFinished) setFinished(spk);
         break;
       }
@@ -349,6 +409,8 @@ handleSpeechMessage (volatile SpeechDriverThread *sdt, SpeechMessage *msg) {
         volatile SpeechSynthesizer *spk = sdt->speechSynthesizer;
         SetSpeechLocationMethod *setLocation = spk->setLocation;
 
+        measureSpeechLatency(sdt);
+
         if (setLocation) setLocation(spk, msg->arguments.speechLocation.location);
         break;
       }
@@ -458,6 +520,12 @@ handleSpeechRequest (volatile SpeechDriverThread *sdt, SpeechRequest *req) {
         int restorePitch = 0;
         int restorePunctuation = 0;
 
+        if (req->arguments.sayText.generation != getSayGeneration(sdt)) {
+          logMessage(LOG_CATEGORY(SPEECH_EVENTS), "superseded speech discarded");
+          sendIntegerResponse(sdt, 1);
+          break;
+        }
+
         if (options & SAY_OPT_MUTE_FIRST) speech->mute(spk);
 
         if (options & SAY_OPT_HIGHER_PITCH) {
@@ -584,6 +652,28 @@ static void
 muteSpeechRequestQueue (volatile SpeechDriverThread *sdt) {
   removeSpeechRequests(sdt, REQ_SAY_TEXT);
   removeSpeechRequests(sdt, REQ_MUTE_SPEECH);
+
+  advanceSayGeneration(sdt);
+  sdt->latency.awaitingSpeech = 0;
+}
+
+static void
+replaceSpeechRequest (volatile SpeechDriverThread *sdt, SpeechRequestType type) {
+  /* Only the most recent request can be replaced so that a setting still
+   * applies to any speech which has been queued after it.
+   */
+  if (testThreadValidity(sdt)) {
+    Element *element = getStackHead(sdt->requestQueue);
+
+    if (element) {
+      const SpeechRequest *req = getElementItem(element);
+
+      if (req && (req->type == type)) {
+        logSpeechRequest((SpeechRequest *)req, "replacing");
+        deleteElement(element);
+      }
+    }
+  }
 }
 
 static void
@@ -666,7 +756,16 @@ speechRequest_sayText (
     req->arguments.sayText.options = options;
 
     if (options & SAY_OPT_MUTE_FIRST) muteSpeechRequestQueue(sdt);
-    if (enqueueSpeechRequest(sdt, req)) return 1;
+    req->arguments.sayText.generation = getSayGeneration(sdt);
+
+    if (enqueueSpeechRequest(sdt, req)) {
+      if (sdt->latency.driverReports && !sdt->latency.awaitingSpeech) {
+        getMonotonicTime((TimeValue *)&sdt->latency.requestTime);
+        sdt->latency.awaitingSpeech = 1;
+      }
+
+      return 1;
+    }
 
     free(req);
   }
@@ -717,6 +816,7 @@ speechRequest_setVolume (
 
   if ((req = newSpeechRequest(REQ_SET_VOLUME, NULL))) {
     req->arguments.setVolume.setting = setting;
+    replaceSpeechRequest(sdt, REQ_SET_VOLUME);
     if (enqueueSpeechRequest(sdt, req)) return 1;
 
     free(req);
@@ -734,6 +834,7 @@ speechRequest_setRate (
 
   if ((req = newSpeechRequest(REQ_SET_RATE, NULL))) {
     req->arguments.setRate.setting = setting;
+    replaceSpeechRequest(sdt, REQ_SET_RATE);
     if (enqueueSpeechRequest(sdt, req)) return 1;
 
     free(req);
@@ -751,6 +852,7 @@ speechRequest_setPitch (
 
   if ((req = newSpeechRequest(REQ_SET_PITCH, NULL))) {
     req->arguments.setPitch.setting = setting;
+    replaceSpeechRequest(sdt, REQ_SET_PITCH);
     if (enqueueSpeechRequest(sdt, req)) return 1;
 
     free(req);
@@ -768,6 +870,7 @@ speechRequest_setPunctuation (
 
   if ((req = newSpeechRequest(REQ_SET_PUNCTUATION, NULL))) {
     req->arguments.setPunctuation.setting = setting;
+    replaceSpeechRequest(sdt, REQ_SET_PUNCTUATION);
     if (enqueueSpeechRequest(sdt, req)) return 1;
 
     free(req);
@@ -0,0 +1,293 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2017 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+/* This program runs the speech driver thread (see spk_thread.c) with a stub
+ * driver which takes a while to say anything, and queues requests behind it
+ * the way the core does. Each scenario checks what the driver was actually
+ * asked to do: that muting first discards the speech which was still queued,
+ * that only the latest of several settings is applied, and that speech is
+ * still handled, in order, whether or not the driver reports having finished.
+ */
+
+#include "prologue.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "program.h"
+#include "options.h"
+#include "log.h"
+#include "spk.h"
+#include "spk_base.h"
+#include "async_wait.h"
+
+static char *opt_scenarioName;
+
+BEGIN_OPTION_TABLE(programOptions)
+  { .letter = 's',
+    .word = "scenario",
+    .argument = "name",
+    .setting.string = &opt_scenarioName,
+    .description = "Only run this scenario."
+  },
+END_OPTION_TABLE
+
+#define SAY_DELAY 100
+#define SAY_LIMIT 8
+#define TEXT_SIZE 0X10
+#define DRAIN_TIMEOUT 2000
+
+typedef struct {
+  const char *text;
+  SayOptions options;
+} SayItem;
+
+typedef struct {
+  const char *name;
+  unsigned reports:1;
+
+  SayItem say[SAY_LIMIT];
+  int volumes[SAY_LIMIT]; /* queued after the first say */
+
+  const char *spoken[SAY_LIMIT];
+  int volume;
+  unsigned int volumeCount;
+} QueueScenario;
+
+static const QueueScenario queueScenarios[] = {
+  { .name = "supersede",
+    .say = {{"one"}, {"two"}, {"three"}, {"four", SAY_OPT_MUTE_FIRST}},
+    .spoken = {"one", "four"}
+  },
+
+  { .name = "settings",
+    .say = {{"one"}, {"two"}},
+    .volumes = {5, 6, 7},
+    .spoken = {"one", "two"},
+    .volume = 7, .volumeCount = 1
+  },
+
+  { .name = "reporting", .reports = 1,
+    .say = {{"one"}, {"two"}, {"three"}},
+    .spoken = {"one", "two", "three"}
+  },
+
+  { .name = "silent",
+    .say = {{"one"}, {"two"}, {"three"}},
+    .spoken = {"one", "two", "three"}
+  },
+};
+
+/* written by the driver thread, read by the main thread once it's drained */
+static volatile struct {
+  unsigned reports:1;
+  unsigned saying:1;
+  unsigned drained:1;
+
+  char spoken[SAY_LIMIT][TEXT_SIZE];
+  unsigned int spokenCount;
+
+  int volume;
+  unsigned int volumeCount;
+} stub;
+
+static unsigned int finishedCount;
+
+static void
+stubSay (volatile SpeechSynthesizer *spk, const unsigned char *text, size_t length, size_t count, const unsigned char *attributes) {
+  stub.saying = 1;
+  approximateDelay(SAY_DELAY);
+
+  if (stub.spokenCount < SAY_LIMIT) {
+    volatile char *spoken = stub.spoken[stub.spokenCount++];
+
+    if (length >= TEXT_SIZE) length = TEXT_SIZE - 1;
+    memcpy((char *)spoken, text, length);
+    spoken[length] = 0;
+  }
+
+  if (stub.reports) tellSpeechFinished(spk);
+}
+
+static void
+stubMute (volatile SpeechSynthesizer *spk) {
+}
+
+static void
+stubSetVolume (volatile SpeechSynthesizer *spk, unsigned char setting) {
+  stub.volume = setting;
+  stub.volumeCount += 1;
+}
+
+static void
+stubDrain (volatile SpeechSynthesizer *spk) {
+  stub.drained = 1;
+}
+
+static int
+stubConstruct (volatile SpeechSynthesizer *spk, char **parameters) {
+  spk->setVolume = stubSetVolume;
+  spk->drain = stubDrain;
+  return 1;
+}
+
+static void
+stubDestruct (volatile SpeechSynthesizer *spk) {
+}
+
+static const SpeechDriver stubSpeechDriver = {
+  .definition = {
+    .name = "Stub",
+    .code = "st",
+    .comment = "queue test"
+  },
+
+  .construct = stubConstruct,
+  .destruct = stubDestruct,
+
+  .say = stubSay,
+  .mute = stubMute
+};
+
+static void
+setStubFinished (volatile SpeechSynthesizer *spk) {
+  finishedCount += 1;
+}
+
+ASYNC_CONDITION_TESTER(testStubDrained) {
+  return stub.drained;
+}
+
+static int
+runScenario (const QueueScenario *scenario) {
+  volatile SpeechSynthesizer spk;
+  unsigned int expectedCount = 0;
+  int ok = 0;
+
+  memset((void *)&stub, 0, sizeof(stub));
+  stub.reports = scenario->reports;
+  finishedCount = 0;
+
+  constructSpeechSynthesizer(&spk);
+  spk.setFinished = setStubFinished;
+
+  if (startSpeechDriverThread(&spk, NULL)) {
+    for (unsigned int index=0; index<SAY_LIMIT; index+=1) {
+      const SayItem *say = &scenario->say[index];
+
+      if (!say->text) break;
+      sayString(&spk, say->text, say->options);
+
+      /* everything else is queued while the first one is being said */
+      if (!index) {
+        /* nothing wakes this thread up when the driver thread starts */
+        for (int time=0; !stub.saying && (time<DRAIN_TIMEOUT); time+=1) approximateDelay(1);
+
+        for (unsigned int volume=0; volume<SAY_LIMIT; volume+=1) {
+          int setting = scenario->volumes[volume];
+
+          if (!setting) break;
+          setSpeechVolume(&spk, setting, 0);
+        }
+      }
+    }
+
+    drainSpeech(&spk);
+
+    if (asyncAwaitCondition(DRAIN_TIMEOUT, testStubDrained, NULL)) {
+      /* let the last messages from the driver thread be handled */
+      asyncWait(SAY_DELAY);
+      ok = 1;
+    } else {
+      logMessage(LOG_ERR, "%s: speech not drained", scenario->name);
+    }
+
+    stopSpeechDriverThread(&spk);
+  }
+
+  while ((expectedCount < SAY_LIMIT) && scenario->spoken[expectedCount]) expectedCount += 1;
+
+  if (ok) {
+    if (stub.spokenCount != expectedCount) {
+      ok = 0;
+    } else {
+      for (unsigned int index=0; index<expectedCount; index+=1) {
+        if (strcmp((const char *)stub.spoken[index], scenario->spoken[index]) != 0) {
+          ok = 0;
+          break;
+        }
+      }
+    }
+
+    if (stub.volumeCount != scenario->volumeCount) ok = 0;
+    if (scenario->volumeCount && (stub.volume != scenario->volume)) ok = 0;
+    if (finishedCount != (scenario->reports? expectedCount: 0)) ok = 0;
+  }
+
+  printf("%-10s spoken:%u/%u volume:%d/%u finished:%u %s\n",
+         scenario->name, stub.spokenCount, expectedCount,
+         stub.volume, stub.volumeCount, finishedCount,
+         (ok? "ok": "FAILED"));
+
+  return ok;
+}
+
+int
+main (int argc, char *argv[]) {
+  unsigned int failures = 0;
+  unsigned int count = 0;
+
+  {
+    static const OptionsDescriptor descriptor = {
+      OPTION_TABLE(programOptions),
+      .applicationName = "spkqueuetest"
+    };
+
+    PROCESS_OPTIONS(descriptor, argc, argv);
+  }
+
+  if (argc) {
+    logMessage(LOG_ERR, "too many parameters");
+    return PROG_EXIT_SYNTAX;
+  }
+
+  speech = &stubSpeechDriver;
+
+  for (unsigned int index=0; index<ARRAY_COUNT(queueScenarios); index+=1) {
+    const QueueScenario *scenario = &queueScenarios[index];
+
+    if (opt_scenarioName && *opt_scenarioName) {
+      if (strcmp(scenario->name, opt_scenarioName) != 0) continue;
+    }
+
+    if (!runScenario(scenario)) failures += 1;
+    count += 1;
+  }
+
+  if (!count) {
+    logMessage(LOG_ERR, "unknown scenario: %s", opt_scenarioName);
+    return PROG_EXIT_SYNTAX;
+  }
+
+  if (failures) {
+    logMessage(LOG_ERR, "speech queue scenarios failed: %u", failures);
+    return PROG_EXIT_SEMANTIC;
+  }
+
+  return PROG_EXIT_SUCCESS;
+}
@@ -27,6 +27,7 @@
 #include <linux/major.h>
 
 #include "log.h"
+#include "parameters.h"
 #include "file.h"
 #include "device.h"
 #include "async_wait.h"
@@ -709,6 +710,13 @@ const unsigned char linuxKeyMapCount = ARRAY_COUNT(linuxKeyMapDescriptors);
 struct UinputObjectStruct {
   int fileDescriptor;
   BITMASK(pressedKeys, KEY_MAX+1, char);
+
+  struct {
+    /* each forwarded key is written as its event followed by a SYN_REPORT */
+    struct input_event buffer[LINUX_INPUT_EVENT_READ_COUNT * 2];
+    unsigned int count;
+    unsigned active:1;
+  } batch;
 };
 #endif /* HAVE_LINUX_UINPUT_H */
 
@@ -920,6 +928,7 @@ newUinputObject (const char *name) {
 void
 destroyUinputObject (UinputObject *uinput) {
 #ifdef HAVE_LINUX_UINPUT_H
+  endUinputBatch(uinput);
   releasePressedKeys(uinput);
   close(uinput->fileDescriptor);
   free(uinput);
@@ -951,6 +960,50 @@ enableUinputEventType (UinputObject *uinput, int type) {
   return 0;
 }
 
+#ifdef HAVE_LINUX_UINPUT_H
+static int
+writeBatchedInputEvents (UinputObject *uinput) {
+  unsigned int count = uinput->batch.count;
+
+  if (count) {
+    uinput->batch.count = 0;
+
+    if (write(uinput->fileDescriptor, uinput->batch.buffer,
+              (count * sizeof(uinput->batch.buffer[0]))) == -1) {
+      logSystemError("write(struct input_event[])");
+      return 0;
+    }
+  }
+
+  return 1;
+}
+#endif /* HAVE_LINUX_UINPUT_H */
+
+void
+beginUinputBatch (UinputObject *uinput) {
+#ifdef HAVE_LINUX_UINPUT_H
+  uinput->batch.active = 1;
+#endif /* HAVE_LINUX_UINPUT_H */
+}
+
+int
+flushUinputBatch (UinputObject *uinput) {
+#ifdef HAVE_LINUX_UINPUT_H
+  return writeBatchedInputEvents(uinput);
+#else /* HAVE_LINUX_UINPUT_H */
+  return 1;
+#endif /* HAVE_LINUX_UINPUT_H */
+}
+
+int
+endUinputBatch (UinputObject *uinput) {
+#ifdef HAVE_LINUX_UINPUT_H
+  uinput->batch.active = 0;
+#endif /* HAVE_LINUX_UINPUT_H */
+
+  return flushUinputBatch(uinput);
+}
+
 int
 writeInputEvent (UinputObject *uinput, uint16_t type, uint16_t code, int32_t value) {
 #ifdef HAVE_LINUX_UINPUT_H
@@ -962,6 +1015,17 @@ writeInputEvent (UinputObject *uinput, uint16_t type, uint16_t code, int32_t val
   event.code = code;
   event.value = value;
 
+  if (uinput->batch.active) {
+    if (uinput->batch.count == ARRAY_COUNT(uinput->batch.buffer)) {
+      if (!writeBatchedInputEvents(uinput)) {
+        return 0;
+      }
+    }
+
+    uinput->batch.buffer[uinput->batch.count++] = event;
+    return 1;
+  }
+
   if (write(uinput->fileDescriptor, &event, sizeof(event)) != -1) return 1;
   logSystemError("write(struct input_event)");
 #endif /* HAVE_LINUX_UINPUT_H */
@@ -144,6 +144,13 @@ handleTuneRequest_playNotes (const NoteElement *tune) {
 
 static void
 handleTuneRequest_playTones (const ToneElement *tune) {
+  if (noteMethods && noteMethods->tune) {
+    if (!openTuneDevice()) return;
+    if (!noteMethods->tune(noteDevice, tune)) return;
+    flushNoteDevice();
+    return;
+  }
+
   while (tune->duration) {
     if (!openTuneDevice()) return;
     if (!noteMethods->tone(noteDevice, tune->duration, tune->frequency)) return;
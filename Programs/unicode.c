@@ -20,7 +20,9 @@
 
 #include "log.h"
 #include "unicode.h"
-#include "ascii.h"
+#include "lock.h"
+#include "get_pthreads.h"
+#include "unicode_widths.h"
 
 #ifdef HAVE_ICU
 #include <unicode/uchar.h>
@@ -65,67 +67,13 @@ getCharacterByName (wchar_t *character, const char *name) {
   return 0;
 }
 
-int
-getCharacterWidth (wchar_t character) {
-#if defined(HAVE_WCWIDTH)
-  return wcwidth(character);
-#elif defined(HAVE_ICU)
-  UCharCategory category = u_getIntPropertyValue(character, UCHAR_GENERAL_CATEGORY);
-  UEastAsianWidth width = u_getIntPropertyValue(character, UCHAR_EAST_ASIAN_WIDTH);
-
-  if (character == 0) return 0;
-  if (category == U_CONTROL_CHAR) return -1;
-
-  if (category == U_NON_SPACING_MARK) return 0;
-  if (category == U_ENCLOSING_MARK) return 0;
-
-  /* Hangul Jamo medial vowels and final consonants */
-  if ((character >= 0X1160) && (character <= 0X11FF) && (category == U_OTHER_LETTER)) return 0;
-
-  /*  */
-  if (character == 0XAD) return 1; /* soft hyphen */
-  if (category == U_FORMAT_CHAR) return 0;
-
-  if (width == U_EA_FULLWIDTH) return 2;
-  if (width == U_EA_HALFWIDTH) return 1;
-
-  if (width == U_EA_WIDE) return 2;
-  if (width == U_EA_NARROW) return 1;
-
-  if (width == U_EA_AMBIGUOUS) {
-    /* CJK Unified Ideographs block */
-    if ((character >= 0X4E00) && (character <= 0X9FFF)) return 2;
-
-    /* CJK Unified Ideographs Externsion A block */
-    if ((character >= 0X3400) && (character <= 0X4DBF)) return 2;
-
-    /* CJK Compatibility Ideographs block */
-    if ((character >= 0XF900) && (character <= 0XFAFF)) return 2;
-
-    /* Supplementary Ideographic Plane */
-  //if ((character >= 0X20000) && (character <= 0X2FFFF)) return 2;
-
-    /* Tertiary Ideographic Plane */
-  //if ((character >= 0X30000) && (character <= 0X3FFFF)) return 2;
-  }
-
-  if (category == U_UNASSIGNED) return -1;
-  return 1;
-#else /* character width */
-  if (character == NUL) return 0;
-  if (character == DEL) return -1;
-  if (!(character & 0X60)) return -1;
-  return 1;
-#endif /* character width */
-}
-
 int
 isBrailleCharacter (wchar_t character) {
   return (character & ~UNICODE_CELL_MASK) == UNICODE_BRAILLE_ROW;
 }
 
-wchar_t
-getBaseCharacter (wchar_t character) {
+static wchar_t
+translateBaseCharacter (wchar_t character) {
 #ifdef HAVE_ICU
   if (isUcharCompatible(character)) {
     UChar source[] = {character};
@@ -147,8 +95,8 @@ getBaseCharacter (wchar_t character) {
   return 0;
 }
 
-wchar_t
-getTransliteratedCharacter (wchar_t character) {
+static wchar_t
+translateTransliteratedCharacter (wchar_t character) {
 #ifdef HAVE_ICONV_H
   static iconv_t handle = NULL;
   if (!handle) handle = iconv_open("ASCII//TRANSLIT", "WCHAR_T");
@@ -171,11 +119,157 @@ getTransliteratedCharacter (wchar_t character) {
   return 0;
 }
 
+typedef wchar_t CharacterTranslator (wchar_t character);
+#define CHARACTER_CACHE_UNSET ((wchar_t)-1)
+#define CHARACTER_CACHE_SPARSE_SIZE 0X100
+
+typedef struct {
+  wchar_t character;
+  wchar_t alternate;
+} SparseCacheEntry;
+
+typedef struct {
+  CharacterTranslator *const translateCharacter;
+
+  /* The BMP is indexed directly, one lazily allocated row at a time. */
+  wchar_t *rows[UNICODE_ROWS_PER_PLANE];
+
+  /* The rest of the code space is rarely seen, so it's only memoized
+   * within a small direct-mapped table.
+   */
+  SparseCacheEntry sparse[CHARACTER_CACHE_SPARSE_SIZE];
+} CharacterCache;
+
+static CharacterCache baseCharacterCache = {
+  .translateCharacter = translateBaseCharacter
+};
+
+static CharacterCache transliteratedCharacterCache = {
+  .translateCharacter = translateTransliteratedCharacter
+};
+
+static LockDescriptor *characterCacheLock = NULL;
+
+#ifdef GOT_PTHREADS
+static pthread_once_t characterCacheLockOnce = PTHREAD_ONCE_INIT;
+
+static void
+initializeCharacterCacheLock (void) {
+  getLockDescriptor(&characterCacheLock, "unicode-cache");
+}
+#endif /* GOT_PTHREADS */
+
+static LockDescriptor *
+getCharacterCacheLock (void) {
+  /* once it's been created, this doesn't take getLockDescriptor's mutex */
+#ifdef GOT_PTHREADS
+  pthread_once(&characterCacheLockOnce, initializeCharacterCacheLock);
+#endif /* GOT_PTHREADS */
+
+  return characterCacheLock;
+}
+
+static int
+isSparseCharacter (wchar_t character) {
+  return (character & ~(UNICODE_ROW_MASK | UNICODE_CELL_MASK)) != 0;
+}
+
+static wchar_t *
+getCachedAlternate (CharacterCache *cache, wchar_t character, int allocate) {
+  if (isSparseCharacter(character)) {
+    SparseCacheEntry *entry = &cache->sparse[character % CHARACTER_CACHE_SPARSE_SIZE];
+
+    if (entry->character != character) {
+      if (!allocate) return NULL;
+      entry->character = character;
+      entry->alternate = CHARACTER_CACHE_UNSET;
+    }
+
+    return &entry->alternate;
+  }
+
+  {
+    wchar_t **row = &cache->rows[UNICODE_ROW_NUMBER(character)];
+
+    if (!*row) {
+      if (!allocate) return NULL;
+
+      if (!(*row = malloc(UNICODE_CELLS_PER_ROW * sizeof(**row)))) {
+        logMallocError();
+        return NULL;
+      }
+
+      for (unsigned int cell=0; cell<UNICODE_CELLS_PER_ROW; cell+=1) {
+        (*row)[cell] = CHARACTER_CACHE_UNSET;
+      }
+    }
+
+    return &(*row)[UNICODE_CELL_NUMBER(character)];
+  }
+}
+
+static wchar_t
+getAlternateCharacter (CharacterCache *cache, wchar_t character) {
+  LockDescriptor *lock = getCharacterCacheLock();
+  wchar_t alternate = CHARACTER_CACHE_UNSET;
+
+  if (lock) obtainSharedLock(lock);
+  {
+    const wchar_t *cached = getCachedAlternate(cache, character, 0);
+    if (cached) alternate = *cached;
+  }
+  if (lock) releaseLock(lock);
+
+  if (alternate == CHARACTER_CACHE_UNSET) {
+    if (lock) obtainExclusiveLock(lock);
+
+    {
+      wchar_t *cached = getCachedAlternate(cache, character, 1);
+
+      if (cached && (*cached != CHARACTER_CACHE_UNSET)) {
+        alternate = *cached;
+      } else {
+        /* The translators aren't reentrant (the iconv handle is shared),
+         * so they're only called while holding the exclusive lock.
+         */
+        alternate = cache->translateCharacter(character);
+        if (cached) *cached = alternate;
+      }
+    }
+
+    if (lock) releaseLock(lock);
+  }
+
+  return alternate;
+}
+
+wchar_t
+getBaseCharacter (wchar_t character) {
+  return getAlternateCharacter(&baseCharacterCache, character);
+}
+
+wchar_t
+getTransliteratedCharacter (wchar_t character) {
+  return getAlternateCharacter(&transliteratedCharacterCache, character);
+}
+
+int
+getCharacterWidth (wchar_t character) {
+  uint32_t value = character;
+
+  if (value < CHARACTER_WIDTH_LIMIT) {
+    unsigned int block = characterWidthIndexes[value >> CHARACTER_WIDTH_BLOCK_SHIFT];
+
+    return characterWidthBlocks[block][value & CHARACTER_WIDTH_BLOCK_MASK];
+  }
+
+  return -1;
+}
+
 int
 handleBestCharacter (wchar_t character, CharacterHandler handleCharacter, void *data) {
   if (isBrailleCharacter(character)) return 0;
 
-  typedef wchar_t CharacterTranslator (wchar_t character);
   static CharacterTranslator *const characterTranslators[] = {
     getBaseCharacter,
     getTransliteratedCharacter,
@@ -23,6 +23,7 @@
 
 #include "parameters.h"
 #include "log.h"
+#include "program.h"
 #include "report.h"
 #include "strfmt.h"
 #include "update.h"
@@ -37,10 +38,14 @@
 #include "scr.h"
 #include "scr_special.h"
 #include "scr_utils.h"
+#include "scr_export.h"
+#include "scr_record.h"
 #include "prefs.h"
 #include "status.h"
 #include "blink.h"
+#include "update_cells.h"
 #include "routing.h"
+#include "diff.h"
 #include "api_control.h"
 #include "core.h"
 
@@ -158,35 +163,27 @@ getScreenCursorPosition (int x, int y) {
   return position;
 }
 
-static void
-overlayAttributesUnderline (unsigned char *cell, unsigned char attributes) {
-  unsigned char dots;
-
-  switch (attributes) {
-    case SCR_COLOUR_FG_DARK_GREY | SCR_COLOUR_BG_BLACK:
-    case SCR_COLOUR_FG_LIGHT_GREY | SCR_COLOUR_BG_BLACK:
-    case SCR_COLOUR_FG_LIGHT_GREY | SCR_COLOUR_BG_BLUE:
-    case SCR_COLOUR_FG_BLACK | SCR_COLOUR_BG_CYAN:
-      return;
-
-    case SCR_COLOUR_FG_BLACK | SCR_COLOUR_BG_LIGHT_GREY:
-      dots = BRL_DOT_7 | BRL_DOT_8;
-      break;
+static int
+isUppercaseLettersVisible (void) {
+  BlinkDescriptor *blink = &uppercaseLettersBlinkDescriptor;
 
-    case SCR_COLOUR_FG_WHITE | SCR_COLOUR_BG_BLACK:
-    default:
-      dots = BRL_DOT_8;
-      break;
-  }
+  requireBlinkDescriptor(blink);
+  return isBlinkVisible(blink);
+}
 
-  {
-    BlinkDescriptor *blink = &attributesUnderlineBlinkDescriptor;
+static int
+isAttributesUnderlineVisible (void) {
+  BlinkDescriptor *blink = &attributesUnderlineBlinkDescriptor;
 
-    requireBlinkDescriptor(blink);
-    if (isBlinkVisible(blink)) *cell |= dots;
-  }
+  requireBlinkDescriptor(blink);
+  return isBlinkVisible(blink);
 }
 
+static const CellsBlinkTesters cellsBlinkTesters = {
+  .uppercaseLetters = isUppercaseLettersVisible,
+  .attributesUnderline = isAttributesUnderlineVisible
+};
+
 static int
 writeStatusCells (void) {
   if (braille->writeStatus) {
@@ -308,6 +305,296 @@ showInfo (void) {
 #ifdef ENABLE_SPEECH_SUPPORT
 static int wasAutospeaking;
 
+typedef struct {
+  const ScreenCharacter *oldCharacters;
+  const ScreenCharacter *newCharacters;
+  unsigned int oldCount;
+  unsigned int newCount;
+
+  unsigned int spanCount;
+  DifferenceSpan firstSpan;
+  DifferenceSpan lastSpan;
+} AutospeakLineDifferences;
+
+static int
+isSameAutospeakCharacter (unsigned int oldIndex, unsigned int newIndex, void *data) {
+  const AutospeakLineDifferences *ald = data;
+
+  return isSameText(&ald->oldCharacters[oldIndex], &ald->newCharacters[newIndex]);
+}
+
+static int
+handleAutospeakLineSpan (const DifferenceSpan *span, void *data) {
+  AutospeakLineDifferences *ald = data;
+
+  if (!ald->spanCount++) ald->firstSpan = *span;
+  ald->lastSpan = *span;
+  return 1;
+}
+
+static int
+findAutospeakLineDifferences (
+  AutospeakLineDifferences *ald,
+  const ScreenCharacter *oldCharacters, unsigned int oldCount,
+  const ScreenCharacter *newCharacters, unsigned int newCount
+) {
+  ald->oldCharacters = oldCharacters;
+  ald->newCharacters = newCharacters;
+  ald->oldCount = oldCount;
+  ald->newCount = newCount;
+  ald->spanCount = 0;
+
+  return findDifferences(oldCount, newCount,
+                         isSameAutospeakCharacter, AUTOSPEAK_MAXIMUM_EDITS,
+                         handleAutospeakLineSpan, ald);
+}
+
+static int
+isAutospeakTailSpan (const AutospeakLineDifferences *ald, const DifferenceSpan *span) {
+  /* Text which has been pushed off (or pulled in from) the end of the line. */
+  return ((span->oldOffset + span->oldCount) == ald->oldCount)
+      && ((span->newOffset + span->newCount) == ald->newCount);
+}
+
+static int
+getAutospeakCursorEdit (const AutospeakLineDifferences *ald, int *inserted, int *deleted) {
+  const DifferenceSpan *span = &ald->firstSpan;
+
+  *inserted = *deleted = 0;
+  if (!ald->spanCount) return 0;
+  if ((ald->spanCount > 2) || ((ald->spanCount == 2) && !isAutospeakTailSpan(ald, &ald->lastSpan))) return 0;
+
+  /* The difference algorithm places an edit after any text which it has in
+   * common with the old line, so an edit which could also have been at the
+   * cursor needs to be slid back to it.
+   */
+  if (!span->oldCount) {
+    if (!isSameRow(ald->newCharacters+span->newCount, ald->oldCharacters, span->newOffset, isSameText)) return 0;
+    *inserted = span->newCount;
+    return 1;
+  }
+
+  if (!span->newCount) {
+    if (!isSameRow(ald->newCharacters, ald->oldCharacters+span->oldCount, span->oldOffset, isSameText)) return 0;
+    *deleted = span->oldCount;
+    return 1;
+  }
+
+  return 0;
+}
+
+static int
+findAutospeakCursorShift (
+  const ScreenCharacter *oldCharacters, int oldWidth, int oldLength,
+  const ScreenCharacter *newCharacters, int newWidth, int newLength,
+  int column, int *inserted, int *deleted
+) {
+  /* Used when the edit is too large for the difference algorithm:
+   * try every possible shift of the rest of the line.
+   */
+  int x = column;
+
+  *inserted = *deleted = 0;
+
+  while (1) {
+    int done = 1;
+
+    if (x < newLength) {
+      if (isSameRow(newCharacters+x, oldCharacters+column, newWidth-x, isSameText)) {
+        *inserted = x - column;
+        return 1;
+      }
+
+      done = 0;
+    }
+
+    if (x < oldLength) {
+      if (isSameRow(newCharacters+column, oldCharacters+x, oldWidth-x, isSameText)) {
+        *deleted = x - column;
+        return 1;
+      }
+
+      done = 0;
+    }
+
+    if (done) return 0;
+    x += 1;
+  }
+}
+
+typedef struct {
+  int screen;
+  int top;
+  int rows;
+  int columns;
+  ScreenCharacter *characters;
+} AutospeakRegionSnapshot;
+
+static AutospeakRegionSnapshot autospeakRegionSnapshot = {
+  .screen = -1
+};
+
+typedef struct {
+  const AutospeakRegionSnapshot *oldRegion;
+  const AutospeakRegionSnapshot *newRegion;
+  int cursorRow;
+  int onlyCursorRow;
+
+  ScreenCharacter *buffer;
+  unsigned int length;
+} AutospeakRegionDifferences;
+
+static int
+getAutospeakRegion (int *top, int *rows) {
+  switch (prefs.autospeakRegion) {
+    case arWindow:
+      *top = ses->winy;
+      *rows = MIN(brl.textRows, scr.rows-ses->winy);
+      return 1;
+
+    case arScreen:
+      *top = 0;
+      *rows = scr.rows;
+      return 1;
+
+    default:
+      return 0;
+  }
+}
+
+static int
+isSameAutospeakRow (unsigned int oldIndex, unsigned int newIndex, void *data) {
+  const AutospeakRegionDifferences *ard = data;
+  int columns = ard->newRegion->columns;
+
+  return isSameRow(&ard->oldRegion->characters[oldIndex * columns],
+                   &ard->newRegion->characters[newIndex * columns],
+                   columns, isSameText);
+}
+
+static void
+addAutospeakRegionText (AutospeakRegionDifferences *ard, const ScreenCharacter *characters, int count) {
+  while (count > 0) {
+    if (!iswspace(characters[count-1].text)) break;
+    count -= 1;
+  }
+
+  if (count > 0) {
+    if (ard->length) {
+      static const ScreenCharacter separator = {.text=WC_C('\n')};
+
+      ard->buffer[ard->length++] = separator;
+    }
+
+    memcpy(&ard->buffer[ard->length], characters, (count * sizeof(*characters)));
+    ard->length += count;
+  }
+}
+
+static int
+handleAutospeakRegionSpan (const DifferenceSpan *span, void *data) {
+  AutospeakRegionDifferences *ard = data;
+  int columns = ard->newRegion->columns;
+
+  if ((span->oldCount != 1) || (span->newCount != 1) ||
+      ((ard->newRegion->top + span->newOffset) != ard->cursorRow)) {
+    ard->onlyCursorRow = 0;
+  }
+
+  for (unsigned int index=0; index<span->newCount; index+=1) {
+    const ScreenCharacter *newRow = &ard->newRegion->characters[(span->newOffset + index) * columns];
+
+    if (span->oldCount == span->newCount) {
+      /* This row has been changed in place - only say what's different. */
+      const ScreenCharacter *oldRow = &ard->oldRegion->characters[(span->oldOffset + index) * columns];
+      AutospeakLineDifferences ald;
+
+      if (findAutospeakLineDifferences(&ald, oldRow, columns, newRow, columns)) {
+        if (ald.spanCount) {
+          int first = ald.firstSpan.newOffset;
+          int last = ald.lastSpan.newOffset + ald.lastSpan.newCount;
+
+          addAutospeakRegionText(ard, &newRow[first], (last - first));
+        }
+
+        continue;
+      }
+    }
+
+    addAutospeakRegionText(ard, newRow, columns);
+  }
+
+  return 1;
+}
+
+static int
+autospeakRegion (const AutospeakRegionSnapshot *oldRegion, const AutospeakRegionSnapshot *newRegion) {
+  if (oldRegion->screen != newRegion->screen) return 0;
+  if (oldRegion->top != newRegion->top) return 0;
+  if (oldRegion->rows != newRegion->rows) return 0;
+  if (oldRegion->columns != newRegion->columns) return 0;
+
+  {
+    ScreenCharacter buffer[newRegion->rows * (newRegion->columns + 1)];
+
+    AutospeakRegionDifferences ard = {
+      .oldRegion = oldRegion,
+      .newRegion = newRegion,
+      .cursorRow = ses->winy,
+      .onlyCursorRow = 1,
+
+      .buffer = buffer,
+      .length = 0
+    };
+
+    if (!findDifferences(oldRegion->rows, newRegion->rows,
+                         isSameAutospeakRow, newRegion->rows,
+                         handleAutospeakRegionSpan, &ard)) {
+      return 0;
+    }
+
+    /* Changes to the current line are handled by the line logic. */
+    if (ard.onlyCursorRow) return 0;
+    if (!ard.length) return 0;
+
+    logMessage(LOG_CATEGORY(SPEECH_EVENTS),
+               "autospeak: region changed: [%d,%d] %u",
+               newRegion->top, newRegion->rows, ard.length);
+
+    speakCharacters(buffer, ard.length, 0);
+    return 1;
+  }
+}
+
+static int
+readAutospeakRegion (AutospeakRegionSnapshot *region) {
+  if (!getAutospeakRegion(&region->top, &region->rows)) return 0;
+  if (region->rows < 1) return 0;
+
+  region->screen = scr.number;
+  region->columns = scr.cols;
+
+  if (!(region->characters = malloc(ARRAY_SIZE(region->characters, (region->rows * region->columns))))) {
+    logMallocError();
+    return 0;
+  }
+
+  if (!readScreen(0, region->top, region->columns, region->rows, region->characters)) {
+    free(region->characters);
+    region->characters = NULL;
+    return 0;
+  }
+
+  return 1;
+}
+
+static void
+saveAutospeakRegion (AutospeakRegionSnapshot *region) {
+  if (autospeakRegionSnapshot.characters) free(autospeakRegionSnapshot.characters);
+  autospeakRegionSnapshot = *region;
+  if (!region->characters) autospeakRegionSnapshot.screen = -1;
+}
+
 void
 autospeak (AutospeakMode mode) {
   static int oldScreen = -1;
@@ -324,7 +611,13 @@ autospeak (AutospeakMode mode) {
   int newWidth = scr.cols;
   ScreenCharacter newCharacters[newWidth];
 
+  AutospeakRegionSnapshot newRegion = {
+    .screen = -1,
+    .characters = NULL
+  };
+
   readScreen(0, ses->winy, newWidth, 1, newCharacters);
+  readAutospeakRegion(&newRegion);
 
   if (!spk.track.isActive) {
     const ScreenCharacter *characters = newCharacters;
@@ -352,6 +645,7 @@ autospeak (AutospeakMode mode) {
 	  if ((newX == oldX) && !cursorAssumedStable) {
 	    scheduleUpdate("autospeak cursor stability check");
 	    cursorAssumedStable = 1;
+	    if (newRegion.characters) free(newRegion.characters);
 	    return;
 	  }
 
@@ -359,7 +653,6 @@ autospeak (AutospeakMode mode) {
               isSameRow(newCharacters, oldCharacters, newX, isSameText)) {
             int oldLength = oldWidth;
             int newLength = newWidth;
-            int x = newX;
 
             while (oldLength > oldX) {
               if (!iswspace(oldCharacters[oldLength-1].text)) break;
@@ -373,34 +666,33 @@ autospeak (AutospeakMode mode) {
             }
             if (newLength < newWidth) newLength += 1;
 
-            while (1) {
-              int done = 1;
-
-              if (x < newLength) {
-                if (isSameRow(newCharacters+x, oldCharacters+oldX, newWidth-x, isSameText)) {
+            {
+              AutospeakLineDifferences ald;
+              int inserted;
+              int deleted;
+
+              if (findAutospeakLineDifferences(&ald,
+                                               oldCharacters+oldX, oldLength-oldX,
+                                               newCharacters+newX, newLength-newX)?
+                  getAutospeakCursorEdit(&ald, &inserted, &deleted):
+                  findAutospeakCursorShift(oldCharacters, oldWidth, oldLength,
+                                           newCharacters, newWidth, newLength,
+                                           newX, &inserted, &deleted)) {
+                if (inserted) {
                   column = newX;
-                  count = prefs.autospeakInsertedCharacters? (x - newX): 0;
+                  count = prefs.autospeakInsertedCharacters? inserted: 0;
                   reason = "characters inserted after cursor";
                   goto autospeak;
                 }
 
-                done = 0;
-              }
-
-              if (x < oldLength) {
-                if (isSameRow(newCharacters+newX, oldCharacters+x, oldWidth-x, isSameText)) {
+                if (deleted) {
                   characters = oldCharacters;
                   column = oldX;
-                  count = prefs.autospeakDeletedCharacters? (x - oldX): 0;
+                  count = prefs.autospeakDeletedCharacters? deleted: 0;
                   reason = "characters deleted after cursor";
                   goto autospeak;
                 }
-
-                done = 0;
               }
-
-              if (done) break;
-              x += 1;
             }
           }
 
@@ -505,6 +797,10 @@ autospeak (AutospeakMode mode) {
   autospeak:
     if (mode == AUTOSPEAK_SILENT) count = 0;
 
+    if ((mode == AUTOSPEAK_CHANGES) && newRegion.characters) {
+      if (autospeakRegion(&autospeakRegionSnapshot, &newRegion)) count = 0;
+    }
+
     if (count) {
       characters += column;
 
@@ -525,6 +821,7 @@ autospeak (AutospeakMode mode) {
 
       if (!newBuffer) {
         logMallocError();
+        if (newRegion.characters) free(newRegion.characters);
         return;
       }
 
@@ -535,6 +832,8 @@ autospeak (AutospeakMode mode) {
     memcpy(oldCharacters, newCharacters, newSize);
   }
 
+  saveAutospeakRegion(&newRegion);
+
   oldScreen = newScreen;
   oldX = newX;
   oldY = newY;
@@ -579,6 +878,30 @@ writeBrailleWindow (BrailleDisplay *brl, const wchar_t *text) {
   return braille->writeWindow(brl, text);
 }
 
+static wchar_t *shownText = NULL;
+static size_t shownTextSize = 0;
+static unsigned char shownTextChanged = 0;
+
+static void
+checkShownText (const wchar_t *text, size_t count) {
+  if ((count != shownTextSize) || (wmemcmp(text, shownText, count) != 0)) {
+    if (count != shownTextSize) {
+      wchar_t *newText = realloc(shownText, ARRAY_SIZE(newText, count));
+
+      if (!newText) {
+        logMallocError();
+        return;
+      }
+
+      shownText = newText;
+      shownTextSize = count;
+    }
+
+    wmemcpy(shownText, text, count);
+    shownTextChanged = 1;
+  }
+}
+
 static void
 doUpdate (void) {
   int screenPointerMoved = 0;
@@ -586,7 +909,10 @@ doUpdate (void) {
   logMessage(LOG_CATEGORY(UPDATE_EVENTS), "starting");
   unrequireAllBlinkDescriptors();
   refreshScreen();
+  captureScreenHistory();
   updateSessionAttributes();
+  exportScreen(&scr);
+  recordScreen();
   api.flush();
 
   if (scr.unreadable) {
@@ -777,34 +1103,19 @@ doUpdate (void) {
           isContracted = 1;
 
           if (ses->displayMode || prefs.showAttributes) {
-            int inputOffset;
-            int outputOffset = 0;
-            unsigned char attributes = 0;
             unsigned char attributesBuffer[outputLength];
 
-            for (inputOffset=0; inputOffset<contractedLength; ++inputOffset) {
-              int offset = contractedOffsets[inputOffset];
-
-              if (offset != CTB_NO_OFFSET) {
-                while (outputOffset < offset) attributesBuffer[outputOffset++] = attributes;
-                attributes = 0;
-              }
-
-              attributes |= inputCharacters[inputOffset].attributes;
-            }
-
-            while (outputOffset < outputLength) attributesBuffer[outputOffset++] = attributes;
+            mergeContractedAttributes(attributesBuffer, outputLength,
+                                      inputCharacters, contractedOffsets, contractedLength);
 
             if (ses->displayMode) {
+              int outputOffset;
+
               for (outputOffset=0; outputOffset<outputLength; ++outputOffset) {
                 outputBuffer[outputOffset] = convertAttributesToDots(attributesTable, attributesBuffer[outputOffset]);
               }
             } else {
-              unsigned int i;
-
-              for (i=0; i<outputLength; i+=1) {
-                overlayAttributesUnderline(&outputBuffer[i], attributesBuffer[i]);
-              }
+              overlayContractedAttributes(outputBuffer, attributesBuffer, outputLength, &cellsBlinkTesters);
             }
           }
 
@@ -850,11 +1161,8 @@ doUpdate (void) {
             unsigned int start = (row * brl.textColumns) + textStart;
             unsigned char *target = &brl.buffer[start];
             wchar_t *text = &textBuffer[start];
-            int column;
 
-            for (column=0; column<textCount; column+=1) {
-              text[column] = UNICODE_BRAILLE_ROW | (target[column] = convertAttributesToDots(attributesTable, source[column].attributes));
-            }
+            translateScreenAttributes(target, text, source, textCount);
           }
         } else {
           unsigned int row;
@@ -864,26 +1172,8 @@ doUpdate (void) {
             unsigned int start = (row * brl.textColumns) + textStart;
             unsigned char *target = &brl.buffer[start];
             wchar_t *text = &textBuffer[start];
-            unsigned int column;
-
-            for (column=0; column<textCount; column+=1) {
-              const ScreenCharacter *character = &source[column];
-              unsigned char *dots = &target[column];
-
-              *dots = convertCharacterToDots(textTable, character->text);
-
-              if (iswupper(character->text)) {
-                BlinkDescriptor *blink = &uppercaseLettersBlinkDescriptor;
 
-                requireBlinkDescriptor(blink);
-                if (!isBlinkVisible(blink)) *dots = 0;
-              }
-
-              if (prefs.textStyle) *dots &= ~(BRL_DOT_7 | BRL_DOT_8);
-              if (prefs.showAttributes) overlayAttributesUnderline(dots, character->attributes);
-
-              text[column] = character->text;
-            }
+            translateScreenText(target, text, source, textCount, &cellsBlinkTesters);
           }
         }
       }
@@ -926,6 +1216,7 @@ doUpdate (void) {
         fillStatusSeparator(textBuffer, brl.buffer);
       }
 
+      checkShownText(textBuffer, windowLength);
       if (!(writeStatusCells() && writeBrailleWindow(&brl, textBuffer))) brl.hasFailed = 1;
     }
 
@@ -943,6 +1234,95 @@ static int updateSuspendCount;
 static TimeValue updateTime;
 static TimeValue earliestTime;
 
+static struct {
+  unsigned int requests;
+  unsigned long int frames;
+  unsigned long int coalesced;
+} updateStatistics;
+
+typedef struct {
+  const char *name;
+  TimeValue since;
+  unsigned char pending;
+
+  unsigned long int count;
+  long int maximum;
+  unsigned int histogram[UPDATE_LATENCY_LIMIT + 1];
+} UpdateLatency;
+
+static UpdateLatency updateLatencies[] = {
+  [UPDATE_LATENCY_COMMAND] = { .name = "command" },
+  [UPDATE_LATENCY_SCREEN] = { .name = "screen" }
+};
+
+static void
+markUpdateLatencySince (UpdateLatencyOrigin origin, const TimeValue *since) {
+  UpdateLatency *latency = &updateLatencies[origin];
+
+  /* Measure from the earliest event that the next frame will show. */
+  if (!latency->pending) {
+    latency->since = *since;
+    latency->pending = 1;
+  }
+}
+
+void
+markUpdateLatency (UpdateLatencyOrigin origin) {
+  TimeValue now;
+
+  getMonotonicTime(&now);
+  markUpdateLatencySince(origin, &now);
+}
+
+static void
+measureUpdateLatencies (void) {
+  for (unsigned int index=0; index<ARRAY_COUNT(updateLatencies); index+=1) {
+    UpdateLatency *latency = &updateLatencies[index];
+
+    if (latency->pending) {
+      long int elapsed = getMonotonicElapsed(&latency->since);
+
+      if (elapsed > latency->maximum) latency->maximum = elapsed;
+      latency->histogram[MIN(elapsed, UPDATE_LATENCY_LIMIT)] += 1;
+      latency->count += 1;
+      latency->pending = 0;
+
+      logMessage(LOG_CATEGORY(UPDATE_EVENTS),
+                 "%s-to-display latency: %ldms", latency->name, elapsed);
+    }
+  }
+}
+
+static unsigned int
+getLatencyPercentile (const UpdateLatency *latency, unsigned int percent) {
+  unsigned long int threshold = ((latency->count * percent) + 99) / 100;
+  unsigned long int sum = 0;
+  unsigned int milliseconds;
+
+  for (milliseconds=0; milliseconds<UPDATE_LATENCY_LIMIT; milliseconds+=1) {
+    if ((sum += latency->histogram[milliseconds]) >= threshold) break;
+  }
+
+  return milliseconds;
+}
+
+static void
+logUpdateLatencies (void *data) {
+  for (unsigned int index=0; index<ARRAY_COUNT(updateLatencies); index+=1) {
+    const UpdateLatency *latency = &updateLatencies[index];
+
+    if (latency->count) {
+      logMessage(LOG_DEBUG,
+                 "%s-to-display latency: Count:%lu P50:%u P90:%u P99:%u Max:%ld",
+                 latency->name, latency->count,
+                 getLatencyPercentile(latency, 50),
+                 getLatencyPercentile(latency, 90),
+                 getLatencyPercentile(latency, 99),
+                 latency->maximum);
+    }
+  }
+}
+
 static void
 enforceEarliestTime (void) {
   if (compareTimeValues(&updateTime, &earliestTime) < 0) {
@@ -979,6 +1359,7 @@ void
 scheduleUpdateIn (const char *reason, int delay) {
   setUpdateTime(delay, NULL, 1);
   if (updateAlarm) asyncResetAlarmTo(updateAlarm, &updateTime);
+  updateStatistics.requests += 1;
   logMessage(LOG_CATEGORY(UPDATE_EVENTS), "scheduled: %s", reason);
 }
 
@@ -991,22 +1372,69 @@ ASYNC_ALARM_CALLBACK(handleUpdateAlarm) {
   asyncDiscardHandle(updateAlarm);
   updateAlarm = NULL;
 
+  int polling = pollScreen();
+
   suspendUpdates();
-  setUpdateTime((pollScreen()? SCREEN_UPDATE_POLL_INTERVAL: (SECS_PER_DAY * MSECS_PER_SEC)),
+  setUpdateTime((polling? SCREEN_UPDATE_POLL_INTERVAL: (SECS_PER_DAY * MSECS_PER_SEC)),
                 parameters->now, 0);
 
   {
     int oldColumn = ses->winx;
     int oldRow = ses->winy;
+    long int duration;
+
+    {
+      static TimeValue previousStart;
+      static unsigned char havePreviousStart = 0;
+      TimeValue start;
+
+      getMonotonicTime(&start);
+      shownTextChanged = 0;
+      doUpdate();
+      duration = getMonotonicElapsed(&start);
+
+      if (polling && shownTextChanged && havePreviousStart &&
+          !updateLatencies[UPDATE_LATENCY_COMMAND].pending) {
+        /* A polling screen driver never says when its screen has changed so
+         * assume the worst - just after the previous frame read it.
+         */
+        markUpdateLatencySince(UPDATE_LATENCY_SCREEN, &previousStart);
+      }
+
+      previousStart = start;
+      havePreviousStart = 1;
+    }
 
-    doUpdate();
+    measureUpdateLatencies();
 
     if ((ses->winx != oldColumn) || (ses->winy != oldRow)) {
       reportBrailleWindowMoved();
     }
+
+    updateStatistics.frames += 1;
+
+    if (updateStatistics.requests > 1) {
+      updateStatistics.coalesced += updateStatistics.requests - 1;
+    }
+
+    logMessage(LOG_CATEGORY(UPDATE_EVENTS),
+               "frame: %ldms, %u requests, %lu frames, %lu coalesced",
+               duration, updateStatistics.requests,
+               updateStatistics.frames, updateStatistics.coalesced);
+    updateStatistics.requests = 0;
+
+    {
+      /* Don't start the next frame until the display can take it, nor
+       * before enough idle time has passed to keep updating within its
+       * share of the main loop.
+       */
+      int delay = MAX((brl.writeDelay + 1), UPDATE_SCHEDULE_DELAY);
+      int budget = (duration * (100 - UPDATE_FRAME_BUDGET)) / UPDATE_FRAME_BUDGET;
+
+      setUpdateDelay(MAX(delay, budget));
+    }
   }
 
-  setUpdateDelay(MAX((brl.writeDelay + 1), UPDATE_SCHEDULE_DELAY));
   brl.writeDelay = 0;
 
   resumeUpdates(0);
@@ -1035,6 +1463,19 @@ beginUpdates (void) {
   updateAlarm = NULL;
   updateSuspendCount = 0;
 
+  updateStatistics.requests = 0;
+  updateStatistics.frames = 0;
+  updateStatistics.coalesced = 0;
+
+  {
+    static int firstTime = 1;
+
+    if (firstTime) {
+      firstTime = 0;
+      onProgramExit("update-latencies", logUpdateLatencies, NULL);
+    }
+  }
+
   oldwinx = -1;
   oldwiny = -1;
 
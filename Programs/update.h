@@ -31,6 +31,13 @@ extern void reportBrailleWindowMoved (void);
 extern void scheduleUpdate (const char *reason);
 extern void scheduleUpdateIn (const char *reason, int delay);
 
+typedef enum {
+  UPDATE_LATENCY_COMMAND,
+  UPDATE_LATENCY_SCREEN
+} UpdateLatencyOrigin;
+
+extern void markUpdateLatency (UpdateLatencyOrigin origin);
+
 extern void beginUpdates (void);
 extern void suspendUpdates (void);
 extern void resumeUpdates (int refresh);
@@ -0,0 +1,128 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2017 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+#include "prologue.h"
+
+#include <wctype.h>
+
+#include "update_cells.h"
+#include "ttb.h"
+#include "atb.h"
+#include "ctb.h"
+#include "brl_dots.h"
+#include "unicode.h"
+#include "prefs.h"
+
+void
+overlayAttributesUnderline (
+  unsigned char *cell, unsigned char attributes,
+  const CellsBlinkTesters *blink
+) {
+  unsigned char dots;
+
+  switch (attributes) {
+    case SCR_COLOUR_FG_DARK_GREY | SCR_COLOUR_BG_BLACK:
+    case SCR_COLOUR_FG_LIGHT_GREY | SCR_COLOUR_BG_BLACK:
+    case SCR_COLOUR_FG_LIGHT_GREY | SCR_COLOUR_BG_BLUE:
+    case SCR_COLOUR_FG_BLACK | SCR_COLOUR_BG_CYAN:
+      return;
+
+    case SCR_COLOUR_FG_BLACK | SCR_COLOUR_BG_LIGHT_GREY:
+      dots = BRL_DOT_7 | BRL_DOT_8;
+      break;
+
+    case SCR_COLOUR_FG_WHITE | SCR_COLOUR_BG_BLACK:
+    default:
+      dots = BRL_DOT_8;
+      break;
+  }
+
+  if (blink->attributesUnderline()) *cell |= dots;
+}
+
+void
+translateScreenText (
+  unsigned char *cells, wchar_t *text,
+  const ScreenCharacter *characters, unsigned int count,
+  const CellsBlinkTesters *blink
+) {
+  unsigned int column;
+
+  for (column=0; column<count; column+=1) {
+    const ScreenCharacter *character = &characters[column];
+    unsigned char *dots = &cells[column];
+
+    *dots = convertCharacterToDots(textTable, character->text);
+
+    if (iswupper(character->text)) {
+      if (!blink->uppercaseLetters()) *dots = 0;
+    }
+
+    if (prefs.textStyle) *dots &= ~(BRL_DOT_7 | BRL_DOT_8);
+    if (prefs.showAttributes) overlayAttributesUnderline(dots, character->attributes, blink);
+
+    text[column] = character->text;
+  }
+}
+
+void
+translateScreenAttributes (
+  unsigned char *cells, wchar_t *text,
+  const ScreenCharacter *characters, unsigned int count
+) {
+  unsigned int column;
+
+  for (column=0; column<count; column+=1) {
+    text[column] = UNICODE_BRAILLE_ROW | (cells[column] = convertAttributesToDots(attributesTable, characters[column].attributes));
+  }
+}
+
+void
+mergeContractedAttributes (
+  unsigned char *attributes, unsigned int outputLength,
+  const ScreenCharacter *characters, const int *offsets, unsigned int inputLength
+) {
+  unsigned int inputOffset;
+  unsigned int outputOffset = 0;
+  unsigned char merged = 0;
+
+  for (inputOffset=0; inputOffset<inputLength; inputOffset+=1) {
+    int offset = offsets[inputOffset];
+
+    if (offset != CTB_NO_OFFSET) {
+      while (outputOffset < offset) attributes[outputOffset++] = merged;
+      merged = 0;
+    }
+
+    merged |= characters[inputOffset].attributes;
+  }
+
+  while (outputOffset < outputLength) attributes[outputOffset++] = merged;
+}
+
+void
+overlayContractedAttributes (
+  unsigned char *cells, const unsigned char *attributes, unsigned int count,
+  const CellsBlinkTesters *blink
+) {
+  unsigned int i;
+
+  for (i=0; i<count; i+=1) {
+    overlayAttributesUnderline(&cells[i], attributes[i], blink);
+  }
+}
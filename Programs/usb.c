@@ -28,6 +28,10 @@
 #include <regex.h>
 #endif /* HAVE_REGEX_H */
 
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif /* HAVE_SYS_EVENTFD_H */
+
 #include "log.h"
 #include "strfmt.h"
 #include "parameters.h"
@@ -595,27 +599,64 @@ usbEndpointDescriptor (
 
 static void
 usbCancelInputMonitor (UsbEndpoint *endpoint) {
-  if (endpoint->direction.input.pipe.monitor) {
-    asyncCancelRequest(endpoint->direction.input.pipe.monitor);
-    endpoint->direction.input.pipe.monitor = NULL;
+  if (endpoint->direction.input.ring.monitor) {
+    asyncCancelRequest(endpoint->direction.input.ring.monitor);
+    endpoint->direction.input.ring.monitor = NULL;
   }
 }
 
 static inline int
-usbHaveInputPipe (UsbEndpoint *endpoint) {
-  return endpoint->direction.input.pipe.output != INVALID_FILE_DESCRIPTOR;
+usbHaveInputRing (UsbEndpoint *endpoint) {
+  return endpoint->direction.input.ring.event != INVALID_FILE_DESCRIPTOR;
 }
 
 static inline int
 usbHaveInputError (UsbEndpoint *endpoint) {
-  return endpoint->direction.input.pipe.input == INVALID_FILE_DESCRIPTOR;
+  return endpoint->direction.input.ring.error != 0;
+}
+
+/* The event descriptor is readable whenever the ring holds data or has
+ * failed. It's only signalled when the ring stops being empty, and only
+ * cleared when it becomes empty again, so a burst of completed requests
+ * costs one notification no matter how many packets it carries.
+ */
+static void
+usbSignalInputRing (UsbInputRing *ring) {
+#ifdef HAVE_SYS_EVENTFD_H
+  const uint64_t value = 1;
+  FileDescriptor descriptor = ring->event;
+#else /* HAVE_SYS_EVENTFD_H */
+  const unsigned char value = 0;
+  FileDescriptor descriptor = ring->notifier;
+#endif /* HAVE_SYS_EVENTFD_H */
+
+  if (writeFileDescriptor(descriptor, &value, sizeof(value)) == -1) {
+    if (errno != EAGAIN) logSystemError("USB input ring signal");
+  }
+}
+
+static void
+usbClearInputRing (UsbInputRing *ring) {
+#ifdef HAVE_SYS_EVENTFD_H
+  uint64_t value;
+#else /* HAVE_SYS_EVENTFD_H */
+  unsigned char value[0X10];
+#endif /* HAVE_SYS_EVENTFD_H */
+
+  if (readFileDescriptor(ring->event, &value, sizeof(value)) == -1) {
+    if (errno != EAGAIN) logSystemError("USB input ring clear");
+  }
 }
 
 void
 usbSetEndpointInputError (UsbEndpoint *endpoint, int error) {
-  if (!usbHaveInputError(endpoint)) {
-    endpoint->direction.input.pipe.error = error;
-    closeFile(&endpoint->direction.input.pipe.input);
+  if (usbHaveInputRing(endpoint)) {
+    if (!usbHaveInputError(endpoint)) {
+      UsbInputRing *ring = &endpoint->direction.input.ring;
+
+      ring->error = error? error: EIO;
+      if (!ring->count) usbSignalInputRing(ring);
+    }
   }
 }
 
@@ -624,10 +665,7 @@ usbSetInputError (void *item, void *data) {
   UsbEndpoint *endpoint = item;
   const int *error = data;
 
-  if (usbHaveInputPipe(endpoint)) {
-    usbSetEndpointInputError(endpoint, *error);
-  }
-
+  usbSetEndpointInputError(endpoint, *error);
   return 0;
 }
 
@@ -636,52 +674,156 @@ usbSetDeviceInputError (UsbDevice *device, int error) {
   processQueue(device->endpoints, usbSetInputError, &error);
 }
 
+static int
+usbResizeInputRing (UsbInputRing *ring, size_t size) {
+  size_t newSize = ring->size? ring->size: USB_INPUT_RING_SIZE_INITIAL;
+  unsigned char *newBuffer;
+
+  while (newSize < size) newSize <<= 1;
+
+  if (newSize > USB_INPUT_RING_SIZE_MAXIMUM) {
+    errno = ENOSPC;
+    return 0;
+  }
+
+  if (!(newBuffer = malloc(newSize))) {
+    logMallocError();
+    return 0;
+  }
+
+  if (ring->count) {
+    size_t count = MIN(ring->count, (ring->size - ring->start));
+
+    memcpy(newBuffer, &ring->buffer[ring->start], count);
+    memcpy(&newBuffer[count], ring->buffer, (ring->count - count));
+  }
+
+  if (ring->buffer) free(ring->buffer);
+  ring->buffer = newBuffer;
+  ring->size = newSize;
+  ring->start = 0;
+  return 1;
+}
+
 int
 usbEnqueueInput (UsbEndpoint *endpoint, const void *buffer, size_t length) {
+  UsbInputRing *ring = &endpoint->direction.input.ring;
+
   if (usbHaveInputError(endpoint)) {
     errno = EIO;
     return 0;
   }
 
-  return writeFile(endpoint->direction.input.pipe.input, buffer, length) != -1;
+  if (!length) return 1;
+
+  if (length > (ring->size - ring->count)) {
+    if (!usbResizeInputRing(ring, (ring->count + length))) {
+      return 0;
+    }
+  }
+
+  {
+    const unsigned char *bytes = buffer;
+    size_t end = (ring->start + ring->count) % ring->size;
+    size_t count = MIN(length, (ring->size - end));
+
+    memcpy(&ring->buffer[end], bytes, count);
+    memcpy(ring->buffer, &bytes[count], (length - count));
+  }
+
+  if (!ring->count) usbSignalInputRing(ring);
+  ring->count += length;
+  return 1;
+}
+
+static size_t
+usbDequeueInput (UsbEndpoint *endpoint, unsigned char *buffer, size_t length) {
+  UsbInputRing *ring = &endpoint->direction.input.ring;
+  size_t count = MIN(length, ring->count);
+
+  if (count) {
+    size_t first = MIN(count, (ring->size - ring->start));
+
+    memcpy(buffer, &ring->buffer[ring->start], first);
+    memcpy(&buffer[first], ring->buffer, (count - first));
+
+    if ((ring->count -= count)) {
+      ring->start = (ring->start + count) % ring->size;
+    } else {
+      ring->start = 0;
+      if (!usbHaveInputError(endpoint)) usbClearInputRing(ring);
+    }
+  }
+
+  return count;
+}
+
+static void
+usbInitializeInputRing (UsbInputRing *ring) {
+  ring->buffer = NULL;
+  ring->size = 0;
+  ring->start = 0;
+  ring->count = 0;
+
+  ring->event = INVALID_FILE_DESCRIPTOR;
+  ring->notifier = INVALID_FILE_DESCRIPTOR;
+  ring->monitor = NULL;
+  ring->error = 0;
 }
 
 void
-usbDestroyInputPipe (UsbEndpoint *endpoint) {
+usbDestroyInputRing (UsbEndpoint *endpoint) {
+  UsbInputRing *ring = &endpoint->direction.input.ring;
+
   usbCancelInputMonitor(endpoint);
-  closeFile(&endpoint->direction.input.pipe.input);
-  closeFile(&endpoint->direction.input.pipe.output);
+  closeFile(&ring->notifier);
+  closeFile(&ring->event);
+
+  if (ring->buffer) free(ring->buffer);
+  usbInitializeInputRing(ring);
 }
 
 int
-usbMakeInputPipe (UsbEndpoint *endpoint) {
-  if (usbHaveInputPipe(endpoint)) return 1;
+usbMakeInputRing (UsbEndpoint *endpoint) {
+  UsbInputRing *ring = &endpoint->direction.input.ring;
 
-  if (createAnonymousPipe(&endpoint->direction.input.pipe.input,
-                          &endpoint->direction.input.pipe.output)) {
-    if (setBlockingIo(endpoint->direction.input.pipe.output, 0)) {
-      return 1;
+  if (usbHaveInputRing(endpoint)) return 1;
+
+#ifdef HAVE_SYS_EVENTFD_H
+  if ((ring->event = eventfd(0, (EFD_NONBLOCK | EFD_CLOEXEC))) != -1) {
+    return 1;
+  } else {
+    logSystemError("eventfd");
+    ring->event = INVALID_FILE_DESCRIPTOR;
+  }
+#else /* HAVE_SYS_EVENTFD_H */
+  if (createAnonymousPipe(&ring->notifier, &ring->event)) {
+    if (setBlockingIo(ring->event, 0)) {
+      if (setBlockingIo(ring->notifier, 0)) {
+        return 1;
+      }
     }
   }
+#endif /* HAVE_SYS_EVENTFD_H */
 
-  usbDestroyInputPipe(endpoint);
+  usbDestroyInputRing(endpoint);
   return 0;
 }
 
 int
-usbMonitorInputPipe (
+usbMonitorInputRing (
   UsbDevice *device, unsigned char endpointNumber,
   AsyncMonitorCallback *callback, void *data
 ) {
   UsbEndpoint *endpoint = usbGetInputEndpoint(device, endpointNumber);
 
   if (endpoint) {
-    if (usbHaveInputPipe(endpoint)) {
+    if (usbHaveInputRing(endpoint)) {
       usbCancelInputMonitor(endpoint);
       if (!callback) return 1;
 
-      if (asyncMonitorFileInput(&endpoint->direction.input.pipe.monitor,
-                                endpoint->direction.input.pipe.output,
+      if (asyncMonitorFileInput(&endpoint->direction.input.ring.monitor,
+                                endpoint->direction.input.ring.event,
                                 callback, data)) {
         return 1;
       }
@@ -725,7 +867,7 @@ usbDeallocateEndpoint (void *item, void *data) {
 
   switch (USB_ENDPOINT_DIRECTION(endpoint->descriptor)) {
     case UsbEndpointDirection_Input:
-      usbDestroyInputPipe(endpoint);
+      usbDestroyInputRing(endpoint);
       break;
 
     default:
@@ -791,10 +933,7 @@ usbGetEndpoint (UsbDevice *device, unsigned char endpointAddress) {
           endpoint->direction.input.completed.buffer = NULL;
           endpoint->direction.input.completed.length = 0;
 
-          endpoint->direction.input.pipe.input = INVALID_FILE_DESCRIPTOR;
-          endpoint->direction.input.pipe.output = INVALID_FILE_DESCRIPTOR;
-          endpoint->direction.input.pipe.monitor = NULL;
-          endpoint->direction.input.pipe.error = 0;
+          usbInitializeInputRing(&endpoint->direction.input.ring);
 
           break;
       }
@@ -812,7 +951,15 @@ usbGetEndpoint (UsbDevice *device, unsigned char endpointAddress) {
         }
 
         usbDeallocateEndpointExtension(endpoint->extension);
-        usbDestroyInputPipe(endpoint);
+
+        switch (USB_ENDPOINT_DIRECTION(endpoint->descriptor)) {
+          case UsbEndpointDirection_Input:
+            usbDestroyInputRing(endpoint);
+            break;
+
+          default:
+            break;
+        }
       }
 
       free(endpoint);
@@ -1180,13 +1327,14 @@ usbAwaitInput (
     return 0;
   }
 
-  if (usbHaveInputPipe(endpoint)) {
+  if (usbHaveInputRing(endpoint)) {
     if (usbHaveInputError(endpoint)) {
-      errno = endpoint->direction.input.pipe.error;
+      errno = endpoint->direction.input.ring.error;
       return 0;
     }
 
-    return awaitFileInput(endpoint->direction.input.pipe.output, timeout);
+    if (endpoint->direction.input.ring.count) return 1;
+    return awaitFileInput(endpoint->direction.input.ring.event, timeout);
   }
 
   if (endpoint->direction.input.completed.request) {
@@ -1286,14 +1434,40 @@ usbReadData (
     unsigned char *bytes = buffer;
     unsigned char *target = bytes;
 
-    if (usbHaveInputPipe(endpoint)) {
-      if (usbHaveInputError(endpoint)) {
-        errno = endpoint->direction.input.pipe.error;
-        endpoint->direction.input.pipe.error = EAGAIN;
-        return -1;
+    if (usbHaveInputRing(endpoint)) {
+      UsbInputRing *ring = &endpoint->direction.input.ring;
+
+      while (length > 0) {
+        size_t count;
+        int timeout;
+
+        if (usbHaveInputError(endpoint)) {
+          if (target != bytes) break;
+
+          errno = ring->error;
+          ring->error = EAGAIN;
+          return -1;
+        }
+
+        if ((count = usbDequeueInput(endpoint, target, length))) {
+          target += count;
+          length -= count;
+          continue;
+        }
+
+        if (!(timeout = (target != bytes)? subsequentTimeout: initialTimeout)) {
+          errno = EAGAIN;
+          break;
+        }
+
+        if (!awaitFileInput(ring->event, timeout)) {
+          logMessage(LOG_WARNING, "input byte missing at offset %u",
+                     (unsigned int)(target - bytes));
+          break;
+        }
       }
 
-      return readFile(endpoint->direction.input.pipe.output, buffer, length, initialTimeout, subsequentTimeout);
+      return target - bytes;
     }
 
     while (length > 0) {
@@ -1410,7 +1584,7 @@ usbPrepareChannel (UsbChannel *channel) {
           if (!endpoint) {
             ok = 0;
           } else if ((USB_ENDPOINT_TRANSFER(endpoint->descriptor) == UsbEndpointTransfer_Interrupt) ||
-                     usbHaveInputPipe(endpoint)) {
+                     usbHaveInputRing(endpoint)) {
             usbBeginInput(device, definition->inputEndpoint);
           }
         }
@@ -1477,6 +1651,21 @@ struct UsbChooseChannelDataStruct {
   unsigned genericDevices:1;
 };
 
+int
+usbIsCandidateDevice (const UsbDeviceDescriptor *descriptor, const UsbChooseChannelData *data) {
+  const UsbChannelDefinition *definition = data->definition;
+
+  if (!usbVerifyVendorIdentifier(descriptor, data->vendorIdentifier)) return 0;
+  if (!usbVerifyProductIdentifier(descriptor, data->productIdentifier)) return 0;
+
+  while (definition->vendor) {
+    if (USB_IS_PRODUCT(descriptor, definition->vendor, definition->product)) return 1;
+    definition += 1;
+  }
+
+  return 0;
+}
+
 static int
 usbChooseChannel (UsbDevice *device, UsbChooseChannelData *data) {
   const UsbDeviceDescriptor *descriptor = &device->descriptor;
@@ -34,6 +34,18 @@ typedef struct UsbDeviceExtensionStruct UsbDeviceExtension;
 typedef struct UsbEndpointStruct UsbEndpoint;
 typedef struct UsbEndpointExtensionStruct UsbEndpointExtension;
 
+typedef struct {
+  unsigned char *buffer;
+  size_t size;
+  size_t start;
+  size_t count;
+
+  FileDescriptor event;
+  FileDescriptor notifier;
+  AsyncHandle monitor;
+  int error;
+} UsbInputRing;
+
 struct UsbEndpointStruct {
   UsbDevice *device;
   const UsbEndpointDescriptor *descriptor;
@@ -54,12 +66,7 @@ struct UsbEndpointStruct {
         size_t length;
       } completed;
 
-      struct {
-        FileDescriptor input;
-        FileDescriptor output;
-        AsyncHandle monitor;
-        int error;
-      } pipe;
+      UsbInputRing ring;
     } input;
 
     struct {
@@ -90,6 +97,11 @@ extern UsbDevice *usbTestDevice (
   UsbDeviceChooser *chooser,
   UsbChooseChannelData *data
 );
+extern int usbIsCandidateDevice (
+  const UsbDeviceDescriptor *descriptor,
+  const UsbChooseChannelData *data
+);
+
 extern UsbEndpoint *usbGetEndpoint (UsbDevice *device, unsigned char endpointAddress);
 extern UsbEndpoint *usbGetInputEndpoint (UsbDevice *device, unsigned char endpointNumber);
 extern UsbEndpoint *usbGetOutputEndpoint (UsbDevice *device, unsigned char endpointNumber);
@@ -112,14 +124,14 @@ extern int usbSetAlternative (
   unsigned char alternative
 );
 
-extern int usbMakeInputPipe (UsbEndpoint *endpoint);
-extern void usbDestroyInputPipe (UsbEndpoint *endpoint);
+extern int usbMakeInputRing (UsbEndpoint *endpoint);
+extern void usbDestroyInputRing (UsbEndpoint *endpoint);
 extern int usbEnqueueInput (UsbEndpoint *endpoint, const void *buffer, size_t length);
 
 extern void usbSetEndpointInputError (UsbEndpoint *endpoint, int error);
 extern void usbSetDeviceInputError (UsbDevice *device, int error);
 
-extern int usbMonitorInputPipe (
+extern int usbMonitorInputRing (
   UsbDevice *device, unsigned char endpointNumber,
   AsyncMonitorCallback *callback, void *data
 );
@@ -21,12 +21,15 @@
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
 #include <errno.h>
 #include <dirent.h>
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/vfs.h>
 #include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
 #include <linux/usbdevice_fs.h>
 
 #ifndef USBDEVFS_DISCONNECT
@@ -48,6 +51,7 @@
 #include "async_io.h"
 #include "async_signal.h"
 #include "mntpt.h"
+#include "program.h"
 #include "io_usb.h"
 #include "usb_internal.h"
 
@@ -55,18 +59,24 @@ typedef struct {
   char *sysfsPath;
   char *usbfsPath;
   UsbDeviceDescriptor usbDescriptor;
+
+  unsigned int references;
+  unsigned removed:1;
 } UsbHostDevice;
 
 static Queue *usbHostDevices = NULL;
+static char *usbHostDevicesRoot = NULL;
+static int usbHostDevicesStale = 0;
 
 struct UsbDeviceExtensionStruct {
-  const UsbHostDevice *host;
+  UsbHostDevice *host;
   int usbfsFile;
   AsyncHandle usbfsMonitorHandle;
 };
 
 struct UsbEndpointExtensionStruct {
   Queue *completedRequests;
+  Queue *recycledRequests;
 
   struct {
     struct {
@@ -534,6 +544,46 @@ usbLogURB (const struct usbdevfs_urb *urb, const char *action) {
   logData(LOG_CATEGORY(USB_IO), usbFormatURB, &fud);
 }
 
+static void
+usbInitializeURB (
+  struct usbdevfs_urb *urb,
+  const UsbEndpointDescriptor *endpoint,
+  void *buffer,
+  size_t length,
+  void *context
+) {
+  memset(urb, 0, sizeof(*urb));
+  urb->endpoint = endpoint->bEndpointAddress;
+  urb->flags = 0;
+  urb->signr = 0;
+  urb->usercontext = context;
+
+  if (!(urb->buffer_length = length)) {
+    urb->buffer = NULL;
+  } else {
+    urb->buffer = urb + 1;
+    if (buffer) memcpy(urb->buffer, buffer, length);
+  }
+
+  switch (USB_ENDPOINT_TRANSFER(endpoint)) {
+    case UsbEndpointTransfer_Control:
+      urb->type = USBDEVFS_URB_TYPE_CONTROL;
+      break;
+
+    case UsbEndpointTransfer_Isochronous:
+      urb->type = USBDEVFS_URB_TYPE_ISO;
+      break;
+
+    case UsbEndpointTransfer_Interrupt:
+      urb->type = USBDEVFS_URB_TYPE_INTERRUPT;
+      break;
+
+    case UsbEndpointTransfer_Bulk:
+      urb->type = USBDEVFS_URB_TYPE_BULK;
+      break;
+  }
+}
+
 static struct usbdevfs_urb *
 usbMakeURB (
   const UsbEndpointDescriptor *endpoint,
@@ -544,43 +594,60 @@ usbMakeURB (
   struct usbdevfs_urb *urb;
 
   if ((urb = malloc(sizeof(*urb) + length))) {
-    memset(urb, 0, sizeof(*urb));
-    urb->endpoint = endpoint->bEndpointAddress;
-    urb->flags = 0;
-    urb->signr = 0;
-    urb->usercontext = context;
-
-    if (!(urb->buffer_length = length)) {
-      urb->buffer = NULL;
-    } else {
-      urb->buffer = urb + 1;
-      if (buffer) memcpy(urb->buffer, buffer, length);
-    }
+    usbInitializeURB(urb, endpoint, buffer, length, context);
+    return urb;
+  } else {
+    logMallocError();
+  }
 
-    switch (USB_ENDPOINT_TRANSFER(endpoint)) {
-      case UsbEndpointTransfer_Control:
-        urb->type = USBDEVFS_URB_TYPE_CONTROL;
-        break;
+  return NULL;
+}
 
-      case UsbEndpointTransfer_Isochronous:
-        urb->type = USBDEVFS_URB_TYPE_ISO;
-        break;
+static inline size_t
+usbGetRecyclableLength (const UsbEndpoint *endpoint) {
+  return getLittleEndian16(endpoint->descriptor->wMaxPacketSize);
+}
 
-      case UsbEndpointTransfer_Interrupt:
-        urb->type = USBDEVFS_URB_TYPE_INTERRUPT;
-        break;
+static struct usbdevfs_urb *
+usbAllocateURB (
+  UsbEndpoint *endpoint,
+  void *buffer,
+  size_t length,
+  void *context
+) {
+  UsbEndpointExtension *eptx = endpoint->extension;
 
-      case UsbEndpointTransfer_Bulk:
-        urb->type = USBDEVFS_URB_TYPE_BULK;
-        break;
+  if (length == usbGetRecyclableLength(endpoint)) {
+    struct usbdevfs_urb *urb = dequeueItem(eptx->recycledRequests);
+
+    if (urb) {
+      usbInitializeURB(urb, endpoint->descriptor, buffer, length, context);
+      return urb;
     }
+  }
 
-    return urb;
-  } else {
-    logMallocError();
+  return usbMakeURB(endpoint->descriptor, buffer, length, context);
+}
+
+/* Input endpoints keep submitting requests of the same (maximum packet) size,
+ * so completed ones are kept for reuse rather than being freed and allocated
+ * again for every packet.
+ */
+static void
+usbRecycleURB (UsbEndpoint *endpoint, struct usbdevfs_urb *urb) {
+  UsbEndpointExtension *eptx = endpoint->extension;
+
+  if (USB_ENDPOINT_DIRECTION(endpoint->descriptor) == UsbEndpointDirection_Input) {
+    if (urb->buffer_length == usbGetRecyclableLength(endpoint)) {
+      if (getQueueSize(eptx->recycledRequests) < USB_INPUT_INTERRUPT_REQUESTS_MAXIMUM) {
+        if (enqueueItem(eptx->recycledRequests, urb)) {
+          return;
+        }
+      }
+    }
   }
 
-  return NULL;
+  free(urb);
 }
 
 static int
@@ -632,7 +699,7 @@ usbSubmitRequest (
       UsbEndpointExtension *eptx = endpoint->extension;
       struct usbdevfs_urb *urb;
 
-      if ((urb = usbMakeURB(endpoint->descriptor, buffer, length, context))) {
+      if ((urb = usbAllocateURB(endpoint, buffer, length, context))) {
         urb->actual_length = 0;
         urb->signr = eptx->monitor.signal.number;
 
@@ -640,7 +707,7 @@ usbSubmitRequest (
           return urb;
         }
 
-        free(urb);
+        usbRecycleURB(endpoint, urb);
       } else {
         logSystemError("USB URB allocate");
       }
@@ -683,7 +750,7 @@ usbCancelRequest (UsbDevice *device, void *request) {
         }
 
         if (found) {
-          free(request);
+          usbRecycleURB(endpoint, urb);
           return 1;
         }
 
@@ -798,7 +865,7 @@ usbInterruptTransfer (
           deleteItem(eptx->completedRequests, urb)) {
         if (!urb->status) return urb;
         if ((errno = urb->status) < 0) errno = -errno;
-        free(urb);
+        usbRecycleURB(endpoint, urb);
         break;
       }
 
@@ -820,7 +887,7 @@ usbMonitorInputEndpoint (
   UsbDevice *device, unsigned char endpointNumber,
   AsyncMonitorCallback *callback, void *data
 ) {
-  return usbMonitorInputPipe(device, endpointNumber, callback, data);
+  return usbMonitorInputRing(device, endpointNumber, callback, data);
 }
 
 ssize_t
@@ -848,7 +915,7 @@ usbReadEndpoint (
             count = urb->actual_length;
             if (count > length) count = length;
             memcpy(buffer, urb->buffer, count);
-            free(urb);
+            usbRecycleURB(endpoint, urb);
           }
 
           break;
@@ -979,7 +1046,7 @@ ASYNC_SIGNAL_CALLBACK(usbHandleInputSignal) {
         usbStopSignalMonitor(eptx);
       }
 
-      free(urb);
+      usbRecycleURB(endpoint, urb);
       if (!handled) return 0;
     }
   }
@@ -1023,7 +1090,7 @@ usbStopUsbfsMonitor (UsbDeviceExtension *devx) {
   }
 }
 
-static int
+int
 usbHandleCompletedInputRequest (UsbEndpoint *endpoint, struct usbdevfs_urb *urb) {
   ssize_t count = urb->actual_length;
   int error = urb->status;
@@ -1070,7 +1137,7 @@ ASYNC_MONITOR_CALLBACK(usbHandleCompletedInputRequests) {
         int handled = usbHandleCompletedInputRequest(endpoint, urb);
         if (!handled) usbSetEndpointInputError(endpoint, errno);
 
-        free(urb);
+        usbRecycleURB(endpoint, urb);
         if (!handled) return 0;
       }
     }
@@ -1107,7 +1174,7 @@ static int
 usbPrepareInputEndpoint (UsbEndpoint *endpoint) {
   UsbDevice *device = endpoint->device;
 
-  if (LINUX_USB_INPUT_PIPE_DISABLE) return 1;
+  if (LINUX_USB_INPUT_RING_DISABLE) return 1;
 
   switch (USB_ENDPOINT_TRANSFER(endpoint->descriptor)) {
     case UsbEndpointTransfer_Bulk:
@@ -1118,7 +1185,7 @@ usbPrepareInputEndpoint (UsbEndpoint *endpoint) {
       return 1;
   }
 
-  if (usbMakeInputPipe(endpoint)) {
+  if (usbMakeInputRing(endpoint)) {
     int monitorStarted = LINUX_USB_INPUT_USE_SIGNAL_MONITOR?
                          usbStartSignalMonitor(endpoint):
                          usbStartUsbfsMonitor(device);
@@ -1129,14 +1196,21 @@ usbPrepareInputEndpoint (UsbEndpoint *endpoint) {
       usbLogInputProblem(endpoint, "monitor not started");
     }
 
-    usbDestroyInputPipe(endpoint);
+    usbDestroyInputRing(endpoint);
   } else {
-    usbLogInputProblem(endpoint, "pipe not created");
+    usbLogInputProblem(endpoint, "ring not created");
   }
 
   return 0;
 }
 
+static void
+usbDeallocateRecycledRequest (void *item, void *data) {
+  struct usbdevfs_urb *urb = item;
+
+  free(urb);
+}
+
 int
 usbAllocateEndpointExtension (UsbEndpoint *endpoint) {
   UsbEndpointExtension *eptx;
@@ -1146,14 +1220,20 @@ usbAllocateEndpointExtension (UsbEndpoint *endpoint) {
     usbInitializeSignalMonitor(eptx);
 
     if ((eptx->completedRequests = newQueue(NULL, NULL))) {
-      switch (USB_ENDPOINT_DIRECTION(endpoint->descriptor)) {
-        case UsbEndpointDirection_Input:
-          endpoint->prepare = usbPrepareInputEndpoint;
-          break;
+      if ((eptx->recycledRequests = newQueue(usbDeallocateRecycledRequest, NULL))) {
+        switch (USB_ENDPOINT_DIRECTION(endpoint->descriptor)) {
+          case UsbEndpointDirection_Input:
+            endpoint->prepare = usbPrepareInputEndpoint;
+            break;
+        }
+
+        endpoint->extension = eptx;
+        return 1;
+      } else {
+        logSystemError("USB endpoint recycled request queue allocate");
       }
 
-      endpoint->extension = eptx;
-      return 1;
+      deallocateQueue(eptx->completedRequests);
     } else {
       logSystemError("USB endpoint completed request queue allocate");
     }
@@ -1175,23 +1255,47 @@ usbDeallocateEndpointExtension (UsbEndpointExtension *eptx) {
     eptx->completedRequests = NULL;
   }
 
+  if (eptx->recycledRequests) {
+    deallocateQueue(eptx->recycledRequests);
+    eptx->recycledRequests = NULL;
+  }
+
   free(eptx);
 }
 
-void
-usbDeallocateDeviceExtension (UsbDeviceExtension *devx) {
-  usbStopUsbfsMonitor(devx);
-  usbCloseUsbfsFile(devx);
-  free(devx);
+static void
+usbDeallocateHostDevice (UsbHostDevice *host) {
+  if (host->sysfsPath) free(host->sysfsPath);
+  if (host->usbfsPath) free(host->usbfsPath);
+  free(host);
 }
 
 static void
-usbDeallocateHostDevice (void *item, void *data) {
+usbRemoveHostDevice (void *item, void *data) {
   UsbHostDevice *host = item;
 
-  if (host->sysfsPath) free(host->sysfsPath);
-  if (host->usbfsPath) free(host->usbfsPath);
-  free(host);
+  if (host->references) {
+    host->removed = 1;
+  } else {
+    usbDeallocateHostDevice(host);
+  }
+}
+
+static void
+usbReleaseHostDevice (UsbHostDevice *host) {
+  if (!--host->references) {
+    if (host->removed) {
+      usbDeallocateHostDevice(host);
+    }
+  }
+}
+
+void
+usbDeallocateDeviceExtension (UsbDeviceExtension *devx) {
+  usbStopUsbfsMonitor(devx);
+  usbCloseUsbfsFile(devx);
+  usbReleaseHostDevice(devx->host);
+  free(devx);
 }
 
 typedef struct {
@@ -1202,13 +1306,16 @@ typedef struct {
 
 static int
 usbTestHostDevice (void *item, void *data) {
-  const UsbHostDevice *host = item;
+  UsbHostDevice *host = item;
   UsbTestHostDeviceData *test = data;
   UsbDeviceExtension *devx;
 
+  if (!usbIsCandidateDevice(&host->usbDescriptor, test->data)) return 0;
+
   if ((devx = malloc(sizeof(*devx)))) {
     memset(devx, 0, sizeof(*devx));
     devx->host = host;
+    host->references += 1;
     devx->usbfsFile = -1;
     usbInitializeUsbfsMonitor(devx);
 
@@ -1321,12 +1428,24 @@ usbReadHostDeviceDescriptor (UsbHostDevice *host) {
   return ok;
 }
 
+static int
+usbTestHostDevicePath (const void *item, void *data) {
+  const UsbHostDevice *host = item;
+  const char *path = data;
+
+  return strcmp(host->usbfsPath, path) == 0;
+}
+
 static int
 usbAddHostDevice (const char *path) {
   int ok = 0;
   UsbHostDevice *host;
 
+  if (findItem(usbHostDevices, usbTestHostDevicePath, (void *)path)) return 1;
+
   if ((host = malloc(sizeof(*host)))) {
+    memset(host, 0, sizeof(*host));
+
     if ((host->usbfsPath = strdup(path))) {
       host->sysfsPath = usbMakeSysfsPath(host->usbfsPath);
 
@@ -1479,31 +1598,235 @@ usbGetUsbfs (void) {
   return usbGetFileSystem("usbfs", usbfsCandidates, usbTestUsbfs, usbVerifyUsbfs);
 }
 
-UsbDevice *
-usbFindDevice (UsbDeviceChooser *chooser, UsbChooseChannelData *data) {
-  if (!usbHostDevices) {
-    int ok = 0;
+#ifdef NETLINK_KOBJECT_UEVENT
+typedef enum {
+  USB_UEVENT_OTHER,
+  USB_UEVENT_ADD,
+  USB_UEVENT_REMOVE
+} UsbUeventAction;
+
+static struct {
+  int socket;
+  AsyncHandle monitor;
+  UsbUeventAction action;
+} usbUevents = {
+  .socket = -1,
+  .monitor = NULL,
+  .action = USB_UEVENT_OTHER
+};
 
-    if ((usbHostDevices = newQueue(usbDeallocateHostDevice, NULL))) {
-      char *root;
+static void
+usbHandleHostDeviceUevent (const char *name) {
+  static const char prefix[] = "bus/usb/";
+  const size_t length = sizeof(prefix) - 1;
 
-      if ((root = usbGetUsbfs())) {
-        logMessage(LOG_CATEGORY(USB_IO), "USBFS root: %s", root);
-        if (usbAddHostDevices(root)) ok = 1;
+  if (strncmp(name, prefix, length) == 0) {
+    char *path;
 
-        free(root);
-      } else {
-        logMessage(LOG_CATEGORY(USB_IO), "USBFS not mounted");
+    if ((path = makePath(usbHostDevicesRoot, &name[length]))) {
+      switch (usbUevents.action) {
+        case USB_UEVENT_ADD:
+          logMessage(LOG_CATEGORY(USB_IO), "host device added: %s", path);
+
+          if (!usbAddHostDevice(path) ||
+              !findItem(usbHostDevices, usbTestHostDevicePath, path)) {
+            usbHostDevicesStale = 1;
+          }
+
+          break;
+
+        case USB_UEVENT_REMOVE: {
+          Element *element = findElement(usbHostDevices, usbTestHostDevicePath, path);
+
+          logMessage(LOG_CATEGORY(USB_IO), "host device removed: %s", path);
+          if (element) deleteElement(element);
+          break;
+        }
+
+        default:
+          break;
+      }
+
+      free(path);
+    }
+  }
+}
+
+static void
+usbStopUeventMonitor (void) {
+  if (usbUevents.monitor) {
+    asyncCancelRequest(usbUevents.monitor);
+    usbUevents.monitor = NULL;
+  }
+
+  if (usbUevents.socket != -1) {
+    close(usbUevents.socket);
+    usbUevents.socket = -1;
+  }
+}
+
+ASYNC_INPUT_CALLBACK(usbHandleUeventString) {
+  static const char label[] = "USB uevent";
+
+  if (parameters->error) {
+    logMessage(LOG_DEBUG, "%s read error: %s", label, strerror(parameters->error));
+  } else if (parameters->end) {
+    logMessage(LOG_DEBUG, "%s end-of-file", label);
+  } else {
+    const char *string = parameters->buffer;
+    const char *end = memchr(string, 0, parameters->length);
+
+    if (!end) return 0;
+
+    {
+      const char *delimiter = strpbrk(string, "@=");
+
+      if (!delimiter) {
+        logMessage(LOG_DEBUG, "unrecognized %s segment: %s", label, string);
+      } else if (*delimiter == '@') {
+        const char *action = string;
+        size_t actionLength = delimiter - action;
+
+        if (strncmp(action, "add", actionLength) == 0) {
+          usbUevents.action = USB_UEVENT_ADD;
+        } else if (strncmp(action, "remove", actionLength) == 0) {
+          usbUevents.action = USB_UEVENT_REMOVE;
+        } else {
+          usbUevents.action = USB_UEVENT_OTHER;
+        }
+      } else if (strncmp(string, "DEVNAME=", (delimiter - string + 1)) == 0) {
+        usbHandleHostDeviceUevent(delimiter + 1);
       }
+    }
 
-      if (!ok) {
-        deallocateQueue(usbHostDevices);
-        usbHostDevices = NULL;
+    return end - string + 1;
+  }
+
+  asyncDiscardHandle(usbUevents.monitor);
+  usbUevents.monitor = NULL;
+  usbStopUeventMonitor();
+  return 0;
+}
+
+static int
+usbStartUeventMonitor (void) {
+  const struct sockaddr_nl socketAddress = {
+    .nl_family = AF_NETLINK,
+    .nl_pid = 0,
+    .nl_groups = 1
+  };
+
+  if ((usbUevents.socket = socket(PF_NETLINK, SOCK_DGRAM, NETLINK_KOBJECT_UEVENT)) != -1) {
+    if (bind(usbUevents.socket, (const struct sockaddr *)&socketAddress, sizeof(socketAddress)) != -1) {
+      if (asyncReadSocket(&usbUevents.monitor, usbUevents.socket, 6+1+PATH_MAX+1,
+                          usbHandleUeventString, NULL)) {
+        logMessage(LOG_CATEGORY(USB_IO), "uevent monitor started");
+        return 1;
       }
+    } else {
+      logSystemError("bind");
     }
+
+    close(usbUevents.socket);
+    usbUevents.socket = -1;
+  } else {
+    logSystemError("socket");
   }
 
+  return 0;
+}
+
+static inline int
+usbHaveUeventMonitor (void) {
+  return usbUevents.monitor != NULL;
+}
+#else /* NETLINK_KOBJECT_UEVENT */
+static void
+usbStopUeventMonitor (void) {
+}
+
+static int
+usbStartUeventMonitor (void) {
+  return 0;
+}
+
+static inline int
+usbHaveUeventMonitor (void) {
+  return 0;
+}
+#endif /* NETLINK_KOBJECT_UEVENT */
+
+static void
+usbDeallocateHostDevices (void) {
+  usbStopUeventMonitor();
+
   if (usbHostDevices) {
+    deallocateQueue(usbHostDevices);
+    usbHostDevices = NULL;
+  }
+
+  if (usbHostDevicesRoot) {
+    free(usbHostDevicesRoot);
+    usbHostDevicesRoot = NULL;
+  }
+
+  usbHostDevicesStale = 0;
+}
+
+static void
+exitHostDevices (void *data) {
+  usbDeallocateHostDevices();
+}
+
+/* The host device index is built by scanning usbfs. When kobject uevents
+ * can be monitored it's then kept current by them, and survives
+ * usbForgetDevices, so that reconnecting to (or autodetecting) a device
+ * doesn't have to walk the whole tree and reread every descriptor again.
+ */
+static int
+usbPrepareHostDevices (void) {
+  if (usbHostDevices) {
+    if (!usbHostDevicesStale) return 1;
+
+    logMessage(LOG_CATEGORY(USB_IO), "rescanning USBFS: %s", usbHostDevicesRoot);
+    usbHostDevicesStale = 0;
+    if (usbAddHostDevices(usbHostDevicesRoot)) return 1;
+
+    usbDeallocateHostDevices();
+    return 0;
+  }
+
+  {
+    static int registered = 0;
+
+    if (!registered) {
+      onProgramExit("usb-host-devices", exitHostDevices, NULL);
+      registered = 1;
+    }
+  }
+
+  if ((usbHostDevices = newQueue(usbRemoveHostDevice, NULL))) {
+    if ((usbHostDevicesRoot = usbGetUsbfs())) {
+      logMessage(LOG_CATEGORY(USB_IO), "USBFS root: %s", usbHostDevicesRoot);
+
+      /* Start listening first so that nothing plugged in during the scan
+       * is missed. A device reported twice is only added once.
+       */
+      usbStartUeventMonitor();
+      if (usbAddHostDevices(usbHostDevicesRoot)) return 1;
+    } else {
+      logMessage(LOG_CATEGORY(USB_IO), "USBFS not mounted");
+    }
+
+    usbDeallocateHostDevices();
+  }
+
+  return 0;
+}
+
+UsbDevice *
+usbFindDevice (UsbDeviceChooser *chooser, UsbChooseChannelData *data) {
+  if (usbPrepareHostDevices()) {
     UsbTestHostDeviceData test = {
       .chooser = chooser,
       .data = data,
@@ -1518,8 +1841,7 @@ usbFindDevice (UsbDeviceChooser *chooser, UsbChooseChannelData *data) {
 
 void
 usbForgetDevices (void) {
-  if (usbHostDevices) {
-    deallocateQueue(usbHostDevices);
-    usbHostDevices = NULL;
+  if (!usbHaveUeventMonitor()) {
+    usbDeallocateHostDevices();
   }
 }